@@ -2,7 +2,10 @@
 #define BENCHMARKS_H
 
 #include "../utils/utils.h"
+#include "../include/Paged_interval_skip_list.h"
 
+#include <algorithm>
+#include <chrono>
 #include <random>
 
 #include <benchmark/benchmark.h>
@@ -37,6 +40,55 @@ void BM_Delete(benchmark::State& st) {
   }
 }
 
+template<class Interval_t, template<class> class ISL_t, template<class, template<class> class> class Data_t>
+void BM_DeleteByHandle(benchmark::State& st) {
+  for (auto _ : st) {
+    st.PauseTiming();
+    Data_t<Interval_t, ISL_t> data(st.range());
+    std::vector<Interval_t> intervals(data.isl.begin(), data.isl.end());
+    data.isl.clear();
+    std::vector<typename ISL_t<Interval_t>::Interval_handle> handles;
+    handles.reserve(intervals.size());
+    for (auto const& interval : intervals) {
+      handles.push_back(data.isl.insert(interval));
+    }
+    std::shuffle(handles.begin(), handles.end(), std::mt19937(std::random_device()()));
+    st.ResumeTiming();
+
+    for (auto const& handle : handles) {
+      data.isl.remove(handle);
+    }
+  }
+}
+
+// slowest single updates while the data is inserted one by one and removed in random order,
+// with a migration budget of st.range(1) handles per update
+template<class Interval_t, template<class> class ISL_t, template<class, template<class> class> class Data_t>
+void BM_UpdateTail(benchmark::State& st) {
+  Data_t<Interval_t, ISL_t> data(st.range(0));
+  std::vector<Interval_t> intervals(data.isl.begin(), data.isl.end());
+  std::vector<double> times;
+  times.reserve(2 * intervals.size());
+  for (auto _ : st) {
+    ISL_t<Interval_t> isl;
+    isl.set_migration_budget(st.range(1));
+    for (auto const& interval : intervals) {
+      auto start = std::chrono::steady_clock::now();
+      isl.insert(interval);
+      times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+    std::shuffle(intervals.begin(), intervals.end(), std::mt19937(1));
+    for (auto const& interval : intervals) {
+      auto start = std::chrono::steady_clock::now();
+      isl.remove(interval);
+      times.push_back(std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count());
+    }
+  }
+  std::sort(times.begin(), times.end());
+  st.counters["p999_us"] = times[times.size() * 999 / 1000];
+  st.counters["max_us"] = times.back();
+}
+
 template<class Interval_t, template<class> class ISL_t, template<class, template<class> class> class Data_t>
 void BM_Search(benchmark::State& st) {
   Data_t<Interval_t, ISL_t> data(st.range());
@@ -60,6 +112,170 @@ void BM_Search(benchmark::State& st) {
   }
 }
 
+template<class Interval_t, template<class> class ISL_t, template<class, template<class> class> class Data_t>
+void BM_SearchSorted(benchmark::State& st) {
+  Data_t<Interval_t, ISL_t> data(st.range());
+  std::vector<typename Interval_t::Value> endpoints;
+  endpoints.reserve(2 * st.range());
+  for (auto it = data.isl.begin(); it != data.isl.end(); ++it) {
+    endpoints.push_back(it->inf());
+    endpoints.push_back(it->sup());
+  }
+  std::sort(endpoints.begin(), endpoints.end());
+  endpoints.erase(std::unique(endpoints.begin(), endpoints.end()), endpoints.end());
+  for (auto _ : st) {
+    Noop_iterator it;
+    benchmark::DoNotOptimize(it);
+    data.isl.find_intervals_sorted(endpoints.begin(), endpoints.end(), it);
+  }
+}
+
+// queries in random order, one lookup at a time
+template<class Interval_t, template<class> class ISL_t, template<class, template<class> class> class Data_t>
+void BM_SearchShuffled(benchmark::State& st) {
+  Data_t<Interval_t, ISL_t> data(st.range());
+  std::vector<typename Interval_t::Value> endpoints;
+  endpoints.reserve(2 * st.range());
+  for (auto it = data.isl.begin(); it != data.isl.end(); ++it) {
+    endpoints.push_back(it->inf());
+    endpoints.push_back(it->sup());
+  }
+  std::shuffle(endpoints.begin(), endpoints.end(), std::mt19937(1));
+  for (auto _ : st) {
+    // counted so that the lookups are not optimized away
+    std::size_t cnt = 0;
+    for (auto const& q : endpoints) {
+      data.isl.find_intervals(q, count_iterator<std::size_t>(cnt));
+    }
+    benchmark::DoNotOptimize(cnt);
+  }
+}
+
+// the same queries as BM_SearchShuffled with the lookups interleaved
+template<class Interval_t, template<class> class ISL_t, template<class, template<class> class> class Data_t>
+void BM_SearchBatch(benchmark::State& st) {
+  Data_t<Interval_t, ISL_t> data(st.range());
+  std::vector<typename Interval_t::Value> endpoints;
+  endpoints.reserve(2 * st.range());
+  for (auto it = data.isl.begin(); it != data.isl.end(); ++it) {
+    endpoints.push_back(it->inf());
+    endpoints.push_back(it->sup());
+  }
+  std::shuffle(endpoints.begin(), endpoints.end(), std::mt19937(1));
+  for (auto _ : st) {
+    std::size_t cnt = 0;
+    data.isl.find_intervals_batch(endpoints.begin(), endpoints.end(), count_iterator<std::size_t>(cnt));
+    benchmark::DoNotOptimize(cnt);
+  }
+}
+
+// queries in random order against a frozen copy
+template<class Interval_t, template<class> class ISL_t, template<class, template<class> class> class Data_t>
+void BM_SearchFrozen(benchmark::State& st) {
+  Data_t<Interval_t, ISL_t> data(st.range());
+  auto frozen = data.isl.freeze();
+  std::vector<typename Interval_t::Value> endpoints;
+  endpoints.reserve(2 * st.range());
+  for (auto it = frozen.begin(); it != frozen.end(); ++it) {
+    endpoints.push_back(it->inf());
+    endpoints.push_back(it->sup());
+  }
+  std::shuffle(endpoints.begin(), endpoints.end(), std::mt19937(1));
+  for (auto _ : st) {
+    std::size_t cnt = 0;
+    for (auto const& q : endpoints) {
+      frozen.find_intervals(q, count_iterator<std::size_t>(cnt));
+    }
+    benchmark::DoNotOptimize(cnt);
+  }
+}
+
+// the intervals of the data in a paged list whose cache holds 16 MB
+template<class Interval_t, template<class> class ISL_t, template<class, template<class> class> class Data_t>
+void BM_SearchPaged(benchmark::State& st) {
+  Data_t<Interval_t, ISL_t> data(st.range());
+  Paged_interval_skip_list<Interval_t> paged(Page_cache::scratch_dir(), 16 << 20);
+  paged.insert(data.isl.begin(), data.isl.end());
+  std::vector<typename Interval_t::Value> endpoints;
+  endpoints.reserve(2 * st.range());
+  for (auto it = data.isl.begin(); it != data.isl.end(); ++it) {
+    endpoints.push_back(it->inf());
+    endpoints.push_back(it->sup());
+  }
+  std::shuffle(endpoints.begin(), endpoints.end(), std::mt19937(1));
+  paged.reset_page_statistics();
+  for (auto _ : st) {
+    std::size_t cnt = 0;
+    for (auto const& q : endpoints) {
+      paged.find_intervals(q, count_iterator<std::size_t>(cnt));
+    }
+    benchmark::DoNotOptimize(cnt);
+  }
+  st.counters["page_reads"] = benchmark::Counter(static_cast<double>(paged.page_statistics().reads),
+                                                 benchmark::Counter::kAvgIterations);
+  st.counters["file_MB"] = static_cast<double>(paged.file_size()) / (1 << 20);
+}
+
+template<class Interval_t, template<class> class ISL_t, template<class, template<class> class> class Data_t>
+void BM_FindOverlapping(benchmark::State& st) {
+  Data_t<Interval_t, ISL_t> data(st.range());
+  std::vector<typename Interval_t::Value> endpoints;
+  endpoints.reserve(2 * st.range());
+  for (auto it = data.isl.begin(); it != data.isl.end(); ++it) {
+    endpoints.push_back(it->inf());
+    endpoints.push_back(it->sup());
+  }
+  std::sort(endpoints.begin(), endpoints.end());
+  endpoints.erase(std::unique(endpoints.begin(), endpoints.end()), endpoints.end());
+  for (auto _ : st) {
+    // windows between consecutive endpoints
+    for (size_t i = 1; i < endpoints.size(); ++i) {
+      Noop_iterator it;
+      benchmark::DoNotOptimize(it);
+      data.isl.find_overlapping(endpoints[i - 1], endpoints[i], true, true, it);
+    }
+  }
+}
+
+template<class Interval_t, template<class> class ISL_t, template<class, template<class> class> class Data_t>
+void BM_CountIntervals(benchmark::State& st) {
+  Data_t<Interval_t, ISL_t> data(st.range());
+  std::vector<typename Interval_t::Value> endpoints;
+  endpoints.reserve(2 * st.range());
+  for (auto it = data.isl.begin(); it != data.isl.end(); ++it) {
+    endpoints.push_back(it->inf());
+    endpoints.push_back(it->sup());
+  }
+  std::sort(endpoints.begin(), endpoints.end());
+  endpoints.erase(std::unique(endpoints.begin(), endpoints.end()), endpoints.end());
+  for (auto _ : st) {
+    for (auto const& q : endpoints) {
+      benchmark::DoNotOptimize(data.isl.count_intervals(q));
+    }
+  }
+}
+
+// stops at the first interval containing each query
+template<class Interval_t, template<class> class ISL_t, template<class, template<class> class> class Data_t>
+void BM_FirstMatch(benchmark::State& st) {
+  Data_t<Interval_t, ISL_t> data(st.range());
+  std::vector<typename Interval_t::Value> endpoints;
+  endpoints.reserve(2 * st.range());
+  for (auto it = data.isl.begin(); it != data.isl.end(); ++it) {
+    endpoints.push_back(it->inf());
+    endpoints.push_back(it->sup());
+  }
+  std::sort(endpoints.begin(), endpoints.end());
+  endpoints.erase(std::unique(endpoints.begin(), endpoints.end()), endpoints.end());
+  for (auto _ : st) {
+    for (auto const& q : endpoints) {
+      const Interval_t* first = nullptr;
+      data.isl.for_each_interval(q, [&](const Interval_t& i) { first = &i; return false; });
+      benchmark::DoNotOptimize(first);
+    }
+  }
+}
+
 template<int N>
 void DecimalArgs(benchmark::internal::Benchmark* b) {
   for (int i = 10; i * 10 < N; i *= 10) {
@@ -86,6 +86,32 @@ BENCHMARK(BM_Delete<Interval_skip_list_interval<double>, Interval_cartesian_tree
     ->Iterations(DELETE_ITERATIONS)
     ->Unit(DELETE_TIME_UNIT);
 
+BENCHMARK(BM_DeleteByHandle<Interval_skip_list_interval<double>, Interval_skip_list, Random_data>)
+    ->Name("DeleteByHandleRandomISL")
+    ->Apply(DecimalArgs<DELETE_N>)
+    ->Iterations(DELETE_ITERATIONS)
+    ->Unit(DELETE_TIME_UNIT);
+
+BENCHMARK(BM_DeleteByHandle<Interval_skip_list_interval<double>, Interval_cartesian_tree, Random_data>)
+    ->Name("DeleteByHandleRandomCartesian")
+    ->Apply(DecimalArgs<DELETE_N>)
+    ->Iterations(DELETE_ITERATIONS)
+    ->Unit(DELETE_TIME_UNIT);
+
+BENCHMARK(BM_UpdateTail<Interval_skip_list_interval<double>, Interval_skip_list, Dense_data>)
+    ->Name("UpdateTailDenseISL")
+    ->Args({DELETE_N, 0})
+    ->Args({DELETE_N, 16})
+    ->Iterations(1)
+    ->Unit(DELETE_TIME_UNIT);
+
+BENCHMARK(BM_UpdateTail<Interval_skip_list_interval<double>, Interval_skip_list, Random_data>)
+    ->Name("UpdateTailRandomISL")
+    ->Args({DELETE_N, 0})
+    ->Args({DELETE_N, 16})
+    ->Iterations(1)
+    ->Unit(DELETE_TIME_UNIT);
+
 static const int SEARCH_N = 100000;
 static const uint64_t SEARCH_ITERATIONS = 100;
 static const benchmark::TimeUnit SEARCH_TIME_UNIT = benchmark::kMicrosecond;
@@ -126,4 +152,274 @@ BENCHMARK(BM_Search<Interval_skip_list_interval<double>, Interval_cartesian_tree
     ->Iterations(SEARCH_ITERATIONS)
     ->Unit(SEARCH_TIME_UNIT);
 
+BENCHMARK(BM_SearchSorted<Interval_skip_list_interval<double>, Interval_skip_list, Sparse_data>)
+    ->Name("SearchSortedSparseISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchSorted<Interval_skip_list_interval<double>, Interval_cartesian_tree, Sparse_data>)
+    ->Name("SearchSortedSparseCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchSorted<Interval_skip_list_interval<double>, Interval_skip_list, Dense_data>)
+    ->Name("SearchSortedDenseISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchSorted<Interval_skip_list_interval<double>, Interval_cartesian_tree, Dense_data>)
+    ->Name("SearchSortedDenseCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchSorted<Interval_skip_list_interval<double>, Interval_skip_list, Random_data>)
+    ->Name("SearchSortedRandomISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchSorted<Interval_skip_list_interval<double>, Interval_cartesian_tree, Random_data>)
+    ->Name("SearchSortedRandomCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchShuffled<Interval_skip_list_interval<double>, Interval_skip_list, Sparse_data>)
+    ->Name("SearchShuffledSparseISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchShuffled<Interval_skip_list_interval<double>, Interval_cartesian_tree, Sparse_data>)
+    ->Name("SearchShuffledSparseCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchShuffled<Interval_skip_list_interval<double>, Interval_skip_list, Dense_data>)
+    ->Name("SearchShuffledDenseISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchShuffled<Interval_skip_list_interval<double>, Interval_cartesian_tree, Dense_data>)
+    ->Name("SearchShuffledDenseCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchShuffled<Interval_skip_list_interval<double>, Interval_skip_list, Random_data>)
+    ->Name("SearchShuffledRandomISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchShuffled<Interval_skip_list_interval<double>, Interval_cartesian_tree, Random_data>)
+    ->Name("SearchShuffledRandomCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchBatch<Interval_skip_list_interval<double>, Interval_skip_list, Sparse_data>)
+    ->Name("SearchBatchSparseISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchBatch<Interval_skip_list_interval<double>, Interval_cartesian_tree, Sparse_data>)
+    ->Name("SearchBatchSparseCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchBatch<Interval_skip_list_interval<double>, Interval_skip_list, Dense_data>)
+    ->Name("SearchBatchDenseISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchBatch<Interval_skip_list_interval<double>, Interval_cartesian_tree, Dense_data>)
+    ->Name("SearchBatchDenseCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchBatch<Interval_skip_list_interval<double>, Interval_skip_list, Random_data>)
+    ->Name("SearchBatchRandomISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchBatch<Interval_skip_list_interval<double>, Interval_cartesian_tree, Random_data>)
+    ->Name("SearchBatchRandomCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchFrozen<Interval_skip_list_interval<double>, Interval_skip_list, Sparse_data>)
+    ->Name("SearchFrozenSparseISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchFrozen<Interval_skip_list_interval<double>, Interval_cartesian_tree, Sparse_data>)
+    ->Name("SearchFrozenSparseCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchFrozen<Interval_skip_list_interval<double>, Interval_skip_list, Dense_data>)
+    ->Name("SearchFrozenDenseISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchFrozen<Interval_skip_list_interval<double>, Interval_cartesian_tree, Dense_data>)
+    ->Name("SearchFrozenDenseCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchFrozen<Interval_skip_list_interval<double>, Interval_skip_list, Random_data>)
+    ->Name("SearchFrozenRandomISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchFrozen<Interval_skip_list_interval<double>, Interval_cartesian_tree, Random_data>)
+    ->Name("SearchFrozenRandomCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchPaged<Interval_skip_list_interval<double>, Interval_skip_list, Sparse_data>)
+    ->Name("SearchPagedSparse")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchPaged<Interval_skip_list_interval<double>, Interval_skip_list, Dense_data>)
+    ->Name("SearchPagedDense")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_SearchPaged<Interval_skip_list_interval<double>, Interval_skip_list, Random_data>)
+    ->Name("SearchPagedRandom")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_FindOverlapping<Interval_skip_list_interval<double>, Interval_skip_list, Sparse_data>)
+    ->Name("FindOverlappingSparseISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_FindOverlapping<Interval_skip_list_interval<double>, Interval_cartesian_tree, Sparse_data>)
+    ->Name("FindOverlappingSparseCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_FindOverlapping<Interval_skip_list_interval<double>, Interval_skip_list, Dense_data>)
+    ->Name("FindOverlappingDenseISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_FindOverlapping<Interval_skip_list_interval<double>, Interval_cartesian_tree, Dense_data>)
+    ->Name("FindOverlappingDenseCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_FindOverlapping<Interval_skip_list_interval<double>, Interval_skip_list, Random_data>)
+    ->Name("FindOverlappingRandomISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_FindOverlapping<Interval_skip_list_interval<double>, Interval_cartesian_tree, Random_data>)
+    ->Name("FindOverlappingRandomCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_CountIntervals<Interval_skip_list_interval<double>, Interval_skip_list, Sparse_data>)
+    ->Name("CountIntervalsSparseISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_CountIntervals<Interval_skip_list_interval<double>, Interval_cartesian_tree, Sparse_data>)
+    ->Name("CountIntervalsSparseCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_CountIntervals<Interval_skip_list_interval<double>, Interval_skip_list, Dense_data>)
+    ->Name("CountIntervalsDenseISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_CountIntervals<Interval_skip_list_interval<double>, Interval_cartesian_tree, Dense_data>)
+    ->Name("CountIntervalsDenseCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_CountIntervals<Interval_skip_list_interval<double>, Interval_skip_list, Random_data>)
+    ->Name("CountIntervalsRandomISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_CountIntervals<Interval_skip_list_interval<double>, Interval_cartesian_tree, Random_data>)
+    ->Name("CountIntervalsRandomCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_FirstMatch<Interval_skip_list_interval<double>, Interval_skip_list, Dense_data>)
+    ->Name("FirstMatchDenseISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_FirstMatch<Interval_skip_list_interval<double>, Interval_cartesian_tree, Dense_data>)
+    ->Name("FirstMatchDenseCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_FirstMatch<Interval_skip_list_interval<double>, Interval_skip_list, Random_data>)
+    ->Name("FirstMatchRandomISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_FirstMatch<Interval_skip_list_interval<double>, Interval_cartesian_tree, Random_data>)
+    ->Name("FirstMatchRandomCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_CountIntervals<Interval_skip_list_interval<double, Closed_bounds>, Interval_skip_list, Dense_data>)
+    ->Name("CountIntervalsDenseClosedISL")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
+BENCHMARK(BM_CountIntervals<Interval_skip_list_interval<double, Closed_bounds>, Interval_cartesian_tree, Dense_data>)
+    ->Name("CountIntervalsDenseClosedCartesian")
+    ->Apply(DecimalArgs<SEARCH_N>)
+    ->Iterations(SEARCH_ITERATIONS)
+    ->Unit(SEARCH_TIME_UNIT);
+
 BENCHMARK_MAIN();
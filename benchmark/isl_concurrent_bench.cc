@@ -0,0 +1,99 @@
+#include "benchmarks.h"
+
+#include <benchmark/benchmark.h>
+
+#include "../include/Concurrent_interval_skip_list.h"
+#include "../include/Interval_skip_list_interval.h"
+#include "../include/Sharded_interval_index.h"
+
+typedef Interval_skip_list_interval<double> Interval_t;
+
+static const int CONCURRENT_N = 100000;
+static const int MAX_THREADS = 32;
+
+static Sparse_data<Interval_t, Concurrent_interval_skip_list>* shared_data = nullptr;
+
+// every thread stabs the shared list at random points
+void BM_ConcurrentSearch(benchmark::State& st) {
+  if (st.thread_index() == 0) {
+    shared_data = new Sparse_data<Interval_t, Concurrent_interval_skip_list>(CONCURRENT_N);
+  }
+  std::mt19937 gen(st.thread_index());
+  std::uniform_int_distribution<int> uniform(-CONCURRENT_N, CONCURRENT_N);
+  for (auto _ : st) {
+    Noop_iterator it;
+    benchmark::DoNotOptimize(it);
+    shared_data->isl.find_intervals(uniform(gen), it);
+  }
+  st.SetItemsProcessed(st.iterations());
+  if (st.thread_index() == 0) {
+    delete shared_data;
+  }
+}
+
+// thread 0 keeps inserting and removing intervals while the others search
+void BM_ConcurrentSearchWithWriter(benchmark::State& st) {
+  if (st.thread_index() == 0) {
+    shared_data = new Sparse_data<Interval_t, Concurrent_interval_skip_list>(CONCURRENT_N);
+  }
+  std::mt19937 gen(st.thread_index());
+  std::uniform_int_distribution<int> uniform(-CONCURRENT_N, CONCURRENT_N);
+  for (auto _ : st) {
+    if (st.thread_index() == 0 && st.threads() > 1) {
+      int inf = uniform(gen);
+      shared_data->isl.remove(shared_data->isl.insert(Interval_t(inf, inf + 1)));
+    } else {
+      Noop_iterator it;
+      benchmark::DoNotOptimize(it);
+      shared_data->isl.find_intervals(uniform(gen), it);
+    }
+  }
+  if (st.thread_index() != 0 || st.threads() == 1) {
+    st.SetItemsProcessed(st.iterations());
+  }
+  if (st.thread_index() == 0) {
+    delete shared_data;
+  }
+}
+
+// every thread inserts short random intervals into a sharded index loaded with CONCURRENT_N of them
+template<template<class> class Sharded_t>
+void BM_ShardedInsert(benchmark::State& st) {
+  static Random_data<Interval_t, Sharded_t>* data = nullptr;
+  if (st.thread_index() == 0) {
+    data = new Random_data<Interval_t, Sharded_t>(CONCURRENT_N);
+    data->isl.rebalance();
+  }
+  std::mt19937 gen(st.thread_index());
+  std::uniform_int_distribution<int> uniform(-CONCURRENT_N, CONCURRENT_N);
+  for (auto _ : st) {
+    int inf = uniform(gen);
+    data->isl.insert(Interval_t(inf, inf + gen() % 100));
+  }
+  st.SetItemsProcessed(st.iterations());
+  if (st.thread_index() == 0) {
+    delete data;
+  }
+}
+
+BENCHMARK(BM_ConcurrentSearch)
+    ->Name("ConcurrentSearchSparse")
+    ->ThreadRange(1, MAX_THREADS)
+    ->UseRealTime();
+
+BENCHMARK(BM_ConcurrentSearchWithWriter)
+    ->Name("ConcurrentSearchWithWriterSparse")
+    ->ThreadRange(1, MAX_THREADS)
+    ->UseRealTime();
+
+BENCHMARK(BM_ShardedInsert<Sharded_interval_skip_list>)
+    ->Name("ShardedInsertRandomISL")
+    ->ThreadRange(1, MAX_THREADS)
+    ->UseRealTime();
+
+BENCHMARK(BM_ShardedInsert<Sharded_interval_cartesian_tree>)
+    ->Name("ShardedInsertRandomCartesian")
+    ->ThreadRange(1, MAX_THREADS)
+    ->UseRealTime();
+
+BENCHMARK_MAIN();
@@ -0,0 +1,184 @@
+#ifndef BUFFERED_INTERVAL_INDEX_H
+#define BUFFERED_INTERVAL_INDEX_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <set>
+#include <vector>
+
+#include "Interval_skip_list.h"
+
+#ifndef ISL_WRITE_BUFFER_MIN
+#define ISL_WRITE_BUFFER_MIN 4096 // updates buffered before a merge, for small indexes
+#endif
+
+#ifndef ISL_WRITE_BUFFER_RATIO
+#define ISL_WRITE_BUFFER_RATIO 16 // larger indexes buffer up to 1 / ratio of their size
+#endif
+
+// Index_ with a write buffer in front of it for bursts of updates. Inserts go to a second Index_,
+// small enough to stay in the cache, removes of intervals of the main index are kept as tombstones.
+// Queries look at the main index, the buffer and the tombstones, so updates are visible at once.
+// Once the buffer fills up, merge() removes the tombstoned intervals and inserts the buffered ones
+// as a batch, which Index_ takes in order of inf with each search continuing the previous one,
+// or as a rebuild once the batch is as large as the index.
+// The index is not synchronized, the same as Index_.
+template <class Interval_, template <class> class Index_ = Interval_skip_list>
+class Buffered_interval_index
+{
+public:
+  typedef Interval_ Interval;
+  typedef typename Interval::Value Value;
+  typedef Index_<Interval> Index;
+
+private:
+  struct interval_less {
+    bool operator()(const Interval& a, const Interval& b) const {
+      if (a.inf() != b.inf())
+        return a.inf() < b.inf();
+      if (a.sup() != b.sup())
+        return a.sup() < b.sup();
+      if (a.inf_closed() != b.inf_closed())
+        return a.inf_closed() < b.inf_closed();
+      return a.sup_closed() < b.sup_closed();
+    }
+  };
+
+  Index engine; // the main index
+  Index buffer;
+  std::multiset<Interval, interval_less> tombstones; // intervals of engine to be removed from it
+
+  std::size_t capacity() const {
+    return std::max<std::size_t>(ISL_WRITE_BUFFER_MIN, engine.size() / ISL_WRITE_BUFFER_RATIO);
+  }
+  void maybe_merge() {
+    if (buffer.size() + tombstones.size() >= capacity())
+      merge();
+  }
+  // intervals of engine containing value that are not tombstoned
+  void find_live(const Value& value, std::vector<Interval>& out) const;
+
+public:
+  Buffered_interval_index() = default;
+  Buffered_interval_index(const Buffered_interval_index&) = delete;
+  Buffered_interval_index& operator=(const Buffered_interval_index&) = delete;
+
+  void insert(const Interval& i) {
+    buffer.insert(i);
+    maybe_merge();
+  }
+  template <class InputIterator>
+  void insert(InputIterator b, InputIterator e) {
+    merge();
+    engine.insert(b, e);
+  }
+  bool remove(const Interval& i);
+
+  // applies the buffered updates to the main index
+  void merge();
+
+  bool is_contained(const Value& value) const;
+  template <class OutputIterator>
+  OutputIterator find_intervals(const Value& value, OutputIterator out) const;
+  std::size_t count_intervals(const Value& value) const;
+
+  void clear() {
+    engine.clear();
+    buffer.clear();
+    tombstones.clear();
+  }
+  int size() const {
+    return engine.size() + buffer.size() - static_cast<int>(tombstones.size());
+  }
+  // updates not merged yet
+  std::size_t pending() const {
+    return buffer.size() + tombstones.size();
+  }
+};
+
+template <class Interval_, template <class> class Index_>
+bool Buffered_interval_index<Interval_, Index_>::remove(const Interval& i)
+{
+  if (buffer.remove(i))
+    return true;
+  auto t = tombstones.find(i);
+  if (t != tombstones.end()) {
+    // contains() does not count the copies, one of them goes now
+    engine.remove(*t);
+    tombstones.erase(t);
+  }
+  if (!engine.contains(i))
+    return false;
+  tombstones.insert(i);
+  maybe_merge();
+  return true;
+}
+
+template <class Interval_, template <class> class Index_>
+void Buffered_interval_index<Interval_, Index_>::merge()
+{
+  // in order of inf, the removes find their nodes close to each other as well
+  for (const Interval& i : tombstones) {
+    bool removed = engine.remove(i);
+    assert(removed);
+    (void)removed;
+  }
+  tombstones.clear();
+  std::vector<Interval> intervals(buffer.begin(), buffer.end());
+  buffer.clear();
+  engine.insert(intervals.begin(), intervals.end());
+}
+
+template <class Interval_, template <class> class Index_>
+void Buffered_interval_index<Interval_, Index_>::find_live(const Value& value, std::vector<Interval>& out) const
+{
+  std::vector<Interval> found;
+  engine.find_intervals(value, std::back_inserter(found));
+  std::sort(found.begin(), found.end(), interval_less());
+  for (auto b = found.begin(); b != found.end();) {
+    auto e = std::upper_bound(b, found.end(), *b, interval_less());
+    std::size_t dead = tombstones.count(*b);
+    if (static_cast<std::size_t>(e - b) > dead)
+      out.insert(out.end(), b + dead, e);
+    b = e;
+  }
+}
+
+template <class Interval_, template <class> class Index_>
+bool Buffered_interval_index<Interval_, Index_>::is_contained(const Value& value) const
+{
+  if (buffer.is_contained(value))
+    return true;
+  if (tombstones.empty())
+    return engine.is_contained(value);
+  std::vector<Interval> live;
+  find_live(value, live);
+  return !live.empty();
+}
+
+template <class Interval_, template <class> class Index_>
+template <class OutputIterator>
+OutputIterator Buffered_interval_index<Interval_, Index_>::find_intervals(const Value& value, OutputIterator out) const
+{
+  out = buffer.find_intervals(value, out);
+  if (tombstones.empty())
+    return engine.find_intervals(value, out);
+  std::vector<Interval> live;
+  find_live(value, live);
+  return std::copy(live.begin(), live.end(), out);
+}
+
+template <class Interval_, template <class> class Index_>
+std::size_t Buffered_interval_index<Interval_, Index_>::count_intervals(const Value& value) const
+{
+  std::size_t count = buffer.count_intervals(value);
+  if (tombstones.empty())
+    return count + engine.count_intervals(value);
+  std::vector<Interval> live;
+  find_live(value, live);
+  return count + live.size();
+}
+
+#endif // BUFFERED_INTERVAL_INDEX_H
@@ -0,0 +1,241 @@
+#ifndef CONCURRENT_INTERVAL_SKIP_LIST_H
+#define CONCURRENT_INTERVAL_SKIP_LIST_H
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "Interval_skip_list.h"
+
+#ifndef ISL_READ_INDICATOR_SLOTS
+#define ISL_READ_INDICATOR_SLOTS 64
+#endif
+
+// Interval_skip_list shared by many reading threads and one writer at a time.
+// Two copies of the list are kept (left-right scheme): readers announce themselves
+// in a striped read indicator and query the copy the writer is not touching,
+// the writer updates the other copy, switches readers over, waits until
+// the readers of the old copy leave and repeats the update there.
+// Reads take no locks and never wait for the writer, writes cost twice the plain list.
+// Handles coincide in both copies since the slabs see the same sequence of updates.
+template <class Interval_>
+class Concurrent_interval_skip_list
+{
+public:
+  typedef Interval_ Interval;
+  typedef typename Interval::Value Value;
+  typedef Interval_skip_list<Interval> List;
+  typedef typename List::Interval_handle Interval_handle;
+
+private:
+  // one cache line per counter so that readers on different cores do not share it
+  struct Read_slot {
+    std::atomic<long> readers;
+    char pad[64 - sizeof(std::atomic<long>)];
+  };
+
+  List lists[2];
+  std::atomic<int> left_right; // copy readers use
+  std::atomic<int> version;    // read indicator new readers arrive at
+  mutable Read_slot indicators[2][ISL_READ_INDICATOR_SLOTS];
+  std::mutex writer;
+
+  static std::size_t slot();
+  bool is_empty(int v) const;
+  template <class Fn>
+  auto write(Fn fn) -> decltype(fn(std::declval<List&>()));
+
+public:
+  Concurrent_interval_skip_list();
+  template <class InputIterator>
+  Concurrent_interval_skip_list(InputIterator b, InputIterator e);
+  Concurrent_interval_skip_list(const Concurrent_interval_skip_list&) = delete;
+  Concurrent_interval_skip_list& operator=(const Concurrent_interval_skip_list&) = delete;
+
+  void seed(boost::rand48::result_type x0);
+
+  // runs fn on a list no writer modifies until fn returns
+  template <class Fn>
+  auto read(Fn fn) const -> decltype(fn(std::declval<const List&>()));
+
+  Interval_handle insert(const Interval& i);
+  // the range is read once into a buffer that both copies are built from
+  template <class InputIterator>
+  int insert(InputIterator b, InputIterator e);
+  bool remove(const Interval& I);
+  void remove(Interval_handle ih);
+  void clear();
+
+  bool is_contained(const Value& value) const;
+  template <class OutputIterator>
+  OutputIterator find_intervals(const Value& value, OutputIterator out) const;
+  template <class RandomAccessIterator, class OutputIterator>
+  OutputIterator find_intervals_sorted(RandomAccessIterator qb, RandomAccessIterator qe, OutputIterator out) const;
+  template <class OutputIterator>
+  OutputIterator find_overlapping(const Value& l, const Value& r, bool lb, bool rb, OutputIterator out) const;
+  std::size_t count_intervals(const Value& value) const;
+  std::size_t count_overlapping(const Value& l, const Value& r, bool lb, bool rb) const;
+
+  int size() const;
+};
+
+template <class Interval_>
+Concurrent_interval_skip_list<Interval_>::Concurrent_interval_skip_list()
+  : left_right(0), version(0)
+{
+  for (auto& row : indicators) {
+    for (Read_slot& s : row) {
+      s.readers.store(0, std::memory_order_relaxed);
+    }
+  }
+}
+
+template <class Interval_>
+template <class InputIterator>
+Concurrent_interval_skip_list<Interval_>::Concurrent_interval_skip_list(InputIterator b, InputIterator e)
+  : Concurrent_interval_skip_list()
+{
+  insert(b, e);
+}
+
+template <class Interval_>
+void Concurrent_interval_skip_list<Interval_>::seed(boost::rand48::result_type x0)
+{
+  std::lock_guard<std::mutex> lock(writer);
+  lists[0].seed(x0);
+  lists[1].seed(x0);
+}
+
+// threads are spread over the slots round robin in the order of their first read
+template <class Interval_>
+std::size_t Concurrent_interval_skip_list<Interval_>::slot()
+{
+  static std::atomic<std::size_t> next(0);
+  thread_local std::size_t s = next.fetch_add(1, std::memory_order_relaxed) % ISL_READ_INDICATOR_SLOTS;
+  return s;
+}
+
+template <class Interval_>
+bool Concurrent_interval_skip_list<Interval_>::is_empty(int v) const
+{
+  for (const Read_slot& s : indicators[v]) {
+    if (s.readers.load() != 0)
+      return false;
+  }
+  return true;
+}
+
+template <class Interval_>
+template <class Fn>
+auto Concurrent_interval_skip_list<Interval_>::read(Fn fn) const -> decltype(fn(std::declval<const List&>()))
+{
+  struct Arrival {
+    std::atomic<long>& readers;
+    explicit Arrival(std::atomic<long>& readers) : readers(readers) { readers.fetch_add(1); }
+    ~Arrival() { readers.fetch_sub(1); }
+  };
+  Arrival arrival(indicators[version.load()][slot()].readers);
+  return fn(lists[left_right.load()]);
+}
+
+template <class Interval_>
+template <class Fn>
+auto Concurrent_interval_skip_list<Interval_>::write(Fn fn) -> decltype(fn(std::declval<List&>()))
+{
+  std::lock_guard<std::mutex> lock(writer);
+  int lr = left_right.load(std::memory_order_relaxed);
+  fn(lists[1 - lr]);
+  left_right.store(1 - lr);
+  // readers may still hold the old copy until both indicators drain
+  int v = version.load(std::memory_order_relaxed);
+  while (!is_empty(1 - v))
+    std::this_thread::yield();
+  version.store(1 - v);
+  while (!is_empty(v))
+    std::this_thread::yield();
+  return fn(lists[lr]);
+}
+
+template <class Interval_>
+typename Concurrent_interval_skip_list<Interval_>::Interval_handle
+Concurrent_interval_skip_list<Interval_>::insert(const Interval& i)
+{
+  return write([&](List& list) { return list.insert(i); });
+}
+
+template <class Interval_>
+template <class InputIterator>
+int Concurrent_interval_skip_list<Interval_>::insert(InputIterator b, InputIterator e)
+{
+  const std::vector<Interval> intervals(b, e);
+  return write([&](List& list) { return list.insert(intervals.begin(), intervals.end()); });
+}
+
+template <class Interval_>
+bool Concurrent_interval_skip_list<Interval_>::remove(const Interval& I)
+{
+  return write([&](List& list) { return list.remove(I); });
+}
+
+template <class Interval_>
+void Concurrent_interval_skip_list<Interval_>::remove(Interval_handle ih)
+{
+  write([&](List& list) { list.remove(ih); });
+}
+
+template <class Interval_>
+void Concurrent_interval_skip_list<Interval_>::clear()
+{
+  write([&](List& list) { list.clear(); });
+}
+
+template <class Interval_>
+bool Concurrent_interval_skip_list<Interval_>::is_contained(const Value& value) const
+{
+  return read([&](const List& list) { return list.is_contained(value); });
+}
+
+template <class Interval_>
+template <class OutputIterator>
+OutputIterator Concurrent_interval_skip_list<Interval_>::find_intervals(const Value& value, OutputIterator out) const
+{
+  return read([&](const List& list) { return list.find_intervals(value, out); });
+}
+
+template <class Interval_>
+template <class RandomAccessIterator, class OutputIterator>
+OutputIterator Concurrent_interval_skip_list<Interval_>::find_intervals_sorted(RandomAccessIterator qb, RandomAccessIterator qe, OutputIterator out) const
+{
+  return read([&](const List& list) { return list.find_intervals_sorted(qb, qe, out); });
+}
+
+template <class Interval_>
+template <class OutputIterator>
+OutputIterator Concurrent_interval_skip_list<Interval_>::find_overlapping(const Value& l, const Value& r, bool lb, bool rb, OutputIterator out) const
+{
+  return read([&](const List& list) { return list.find_overlapping(l, r, lb, rb, out); });
+}
+
+template <class Interval_>
+std::size_t Concurrent_interval_skip_list<Interval_>::count_intervals(const Value& value) const
+{
+  return read([&](const List& list) { return list.count_intervals(value); });
+}
+
+template <class Interval_>
+std::size_t Concurrent_interval_skip_list<Interval_>::count_overlapping(const Value& l, const Value& r, bool lb, bool rb) const
+{
+  return read([&](const List& list) { return list.count_overlapping(l, r, lb, rb); });
+}
+
+template <class Interval_>
+int Concurrent_interval_skip_list<Interval_>::size() const
+{
+  return read([&](const List& list) { return list.size(); });
+}
+
+#endif // CONCURRENT_INTERVAL_SKIP_LIST_H
@@ -0,0 +1,704 @@
+#ifndef FLAT_INDEX_H
+#define FLAT_INDEX_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <type_traits>
+
+#ifndef ISL_INDEX_INLINE_CAPACITY
+#define ISL_INDEX_INLINE_CAPACITY 4
+#endif
+
+#ifndef ISL_INDEX_LEAF_CAPACITY
+#define ISL_INDEX_LEAF_CAPACITY 128
+#endif
+
+// Sorted multiset of trivially copyable handles used as a per-node interval index.
+// Up to InlineCapacity handles are kept inside the object itself,
+// larger indexes are stored in a sequence of sorted contiguous leaves (one level B-tree).
+// The comparator is passed to every ordering operation, equal elements keep insertion order.
+// Lookups accept any key the comparator can compare with handles in both directions.
+// Leaves are taken from the allocator passed to every mutating operation
+// (anything with allocate(bytes)/deallocate(p, bytes), e.g. Node_arena),
+// so the index has no destructor: clear it with the same allocator or release the allocator.
+// Leaf sizes are mirrored in a Fenwick tree, so the length of a prefix is counted in O(log n).
+// Elements may weigh more than one, e.g. a handle shared by copies of an interval. The weights come
+// from a functor passed to every mutating operation (each element weighs 1 by default) and must not
+// change while the element is in the index except through add_weight. What the leaves weigh beyond
+// their sizes is kept in a second Fenwick tree, so the weight of a prefix is counted in O(log n) too.
+template <class T,
+          int InlineCapacity = ISL_INDEX_INLINE_CAPACITY,
+          int LeafCapacity = ISL_INDEX_LEAF_CAPACITY>
+class Flat_index
+{
+  static_assert(std::is_trivially_copyable<T>::value, "Flat_index stores trivially copyable handles only");
+  static_assert(InlineCapacity > 0 && LeafCapacity >= 2 * InlineCapacity, "bad Flat_index capacities");
+
+  struct Leaf {
+    uint32_t size;
+    uint32_t capacity;
+    uint32_t extra; // weight of the elements beyond one each
+    T* data() { return reinterpret_cast<T*>(this + 1); }
+    const T* data() const { return reinterpret_cast<const T*>(this + 1); }
+  };
+  static_assert(sizeof(Leaf) % alignof(T) == 0, "leaf header breaks handle alignment");
+
+  // the leaf pointers are followed by the Fenwick trees of leaf sizes and extra weights in the same block
+  struct Large {
+    Leaf** leaves;
+    uint32_t leaves_capacity;
+  };
+
+  union Storage {
+    typename std::aligned_storage<sizeof(T), alignof(T)>::type small[InlineCapacity];
+    Large large;
+  };
+
+  Storage storage;
+  uint32_t size_;
+  uint32_t leaf_count; // 0 while handles are stored inline
+
+  T* small_data() { return reinterpret_cast<T*>(storage.small); }
+  const T* small_data() const { return reinterpret_cast<const T*>(storage.small); }
+  bool is_small() const { return leaf_count == 0; }
+
+  static size_t leaves_bytes(uint32_t capacity) { return capacity * (sizeof(Leaf*) + 2 * sizeof(uint32_t)); }
+  uint32_t* leaf_counts() { return reinterpret_cast<uint32_t*>(storage.large.leaves + storage.large.leaves_capacity); }
+  const uint32_t* leaf_counts() const { return reinterpret_cast<const uint32_t*>(storage.large.leaves + storage.large.leaves_capacity); }
+  uint32_t* leaf_extras() { return leaf_counts() + storage.large.leaves_capacity; }
+  const uint32_t* leaf_extras() const { return leaf_counts() + storage.large.leaves_capacity; }
+  void reset_counts();
+  void add_count(uint32_t* tree, uint32_t li, int32_t delta);
+  uint32_t count_before(const uint32_t* tree, uint32_t li) const;
+
+  template <class Weight>
+  static uint32_t extra_weight(const T* first, const T* last, const Weight& weight);
+
+  template <class Alloc>
+  static Leaf* allocate_leaf(uint32_t capacity, Alloc& alloc);
+  template <class Alloc>
+  static void deallocate_leaf(Leaf* leaf, Alloc& alloc);
+  template <class Alloc>
+  void insert_leaf(uint32_t pos, Leaf* leaf, Alloc& alloc);
+  template <class Alloc>
+  void remove_leaves(uint32_t first, uint32_t last, Alloc& alloc);
+  template <class Alloc, class Weight>
+  void to_large(Alloc& alloc, const Weight& weight);
+  template <class Alloc>
+  void to_small(Alloc& alloc);
+  template <class Alloc>
+  void maybe_shrink(Alloc& alloc);
+
+  template <class Compare>
+  uint32_t find_leaf_for_insert(const T& v, const Compare& cmp) const;
+
+public:
+  struct Unit_weight {
+    uint32_t operator()(const T&) const { return 1; }
+  };
+
+  class const_iterator
+  {
+    const T* p;
+    const T* leaf_end;
+    Leaf* const* leaf;
+    Leaf* const* last_leaf;
+
+    friend class Flat_index;
+
+    const_iterator(const T* p, const T* leaf_end, Leaf* const* leaf, Leaf* const* last_leaf)
+      : p(p), leaf_end(leaf_end), leaf(leaf), last_leaf(last_leaf) {}
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T* pointer;
+    typedef const T& reference;
+
+    const_iterator() : p(nullptr), leaf_end(nullptr), leaf(nullptr), last_leaf(nullptr) {}
+
+    reference operator*() const { return *p; }
+    pointer operator->() const { return p; }
+
+    const_iterator& operator++() {
+      if (++p == leaf_end && leaf != last_leaf) {
+        ++leaf;
+        p = (*leaf)->data();
+        leaf_end = p + (*leaf)->size;
+      }
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    bool operator==(const const_iterator& other) const { return p == other.p; }
+    bool operator!=(const const_iterator& other) const { return p != other.p; }
+  };
+
+  Flat_index() : size_(0), leaf_count(0) {}
+  Flat_index(const Flat_index&) = delete;
+  Flat_index& operator=(const Flat_index&) = delete;
+
+  bool empty() const { return size_ == 0; }
+  uint32_t size() const { return size_; }
+  const T& front() const { return *begin(); }
+
+  const_iterator begin() const;
+  const_iterator end() const;
+
+  // inserts after all elements equivalent to v
+  template <class Compare, class Alloc, class Weight = Unit_weight>
+  void insert(const T& v, const Compare& cmp, Alloc& alloc, const Weight& weight = Weight());
+
+  // first element not less than v
+  template <class K, class Compare>
+  const_iterator lower_bound(const K& v, const Compare& cmp) const;
+
+  // first element equivalent to v or end()
+  template <class K, class Compare>
+  const_iterator find(const K& v, const Compare& cmp) const;
+
+  // number of leading elements satisfying pred, which must hold on a prefix of the index
+  template <class Pred>
+  uint32_t count_prefix(const Pred& pred) const;
+  // the same weighing each element, with the weights the index was built with
+  template <class Pred, class Weight>
+  uint32_t count_prefix(const Pred& pred, const Weight& weight) const;
+
+  // the weight of the element at it changed by delta
+  void add_weight(const_iterator it, int32_t delta);
+
+  // iterator to the element at position pos, end() for pos == size()
+  const_iterator nth(uint32_t pos) const;
+
+  // calls fn(first, last) on the contiguous runs of elements in order until it returns false
+  template <class Fn>
+  void for_each_run(Fn fn) const;
+
+  // fills an empty index from a range already sorted by the index comparator
+  template <class Alloc, class Weight = Unit_weight>
+  void assign_sorted(const T* first, const T* last, Alloc& alloc, const Weight& weight = Weight());
+
+  template <class Alloc, class Weight = Unit_weight>
+  void erase(const_iterator it, Alloc& alloc, const Weight& weight = Weight());
+  template <class Alloc, class Weight = Unit_weight>
+  void erase(const_iterator first, const_iterator last, Alloc& alloc, const Weight& weight = Weight());
+  template <class Alloc>
+  void clear(Alloc& alloc);
+};
+
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class Alloc>
+typename Flat_index<T, InlineCapacity, LeafCapacity>::Leaf*
+Flat_index<T, InlineCapacity, LeafCapacity>::allocate_leaf(uint32_t capacity, Alloc& alloc)
+{
+  void* mem = alloc.allocate(sizeof(Leaf) + capacity * sizeof(T));
+  Leaf* leaf = new (mem) Leaf;
+  leaf->size = 0;
+  leaf->capacity = capacity;
+  leaf->extra = 0;
+  return leaf;
+}
+
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class Alloc>
+void Flat_index<T, InlineCapacity, LeafCapacity>::deallocate_leaf(Leaf* leaf, Alloc& alloc)
+{
+  alloc.deallocate(leaf, sizeof(Leaf) + leaf->capacity * sizeof(T));
+}
+
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class Alloc>
+void Flat_index<T, InlineCapacity, LeafCapacity>::insert_leaf(uint32_t pos, Leaf* leaf, Alloc& alloc)
+{
+  Large& large = storage.large;
+  if (leaf_count == large.leaves_capacity) {
+    uint32_t new_capacity = 2 * large.leaves_capacity;
+    Leaf** leaves = static_cast<Leaf**>(alloc.allocate(leaves_bytes(new_capacity)));
+    std::copy(large.leaves, large.leaves + leaf_count, leaves);
+    alloc.deallocate(large.leaves, leaves_bytes(large.leaves_capacity));
+    large.leaves = leaves;
+    large.leaves_capacity = new_capacity;
+  }
+  std::copy_backward(large.leaves + pos, large.leaves + leaf_count, large.leaves + leaf_count + 1);
+  large.leaves[pos] = leaf;
+  ++leaf_count;
+  reset_counts();
+}
+
+// frees leaves [first, last) and closes the gap
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class Alloc>
+void Flat_index<T, InlineCapacity, LeafCapacity>::remove_leaves(uint32_t first, uint32_t last, Alloc& alloc)
+{
+  Leaf** leaves = storage.large.leaves;
+  for (uint32_t i = first; i < last; ++i) {
+    deallocate_leaf(leaves[i], alloc);
+  }
+  std::copy(leaves + last, leaves + leaf_count, leaves + first);
+  leaf_count -= last - first;
+  if (leaf_count == 0) {
+    alloc.deallocate(leaves, leaves_bytes(storage.large.leaves_capacity));
+  } else {
+    reset_counts();
+  }
+}
+
+// leaf sizes change one by one on insert and erase, whole trees are rebuilt when leaves come and go
+template <class T, int InlineCapacity, int LeafCapacity>
+void Flat_index<T, InlineCapacity, LeafCapacity>::reset_counts()
+{
+  uint32_t* counts = leaf_counts();
+  uint32_t* extras = leaf_extras();
+  for (uint32_t i = 0; i < leaf_count; ++i) {
+    counts[i] = storage.large.leaves[i]->size;
+    extras[i] = storage.large.leaves[i]->extra;
+  }
+  for (uint32_t i = 1; i <= leaf_count; ++i) {
+    uint32_t parent = i + (i & -i);
+    if (parent <= leaf_count) {
+      counts[parent - 1] += counts[i - 1];
+      extras[parent - 1] += extras[i - 1];
+    }
+  }
+}
+
+template <class T, int InlineCapacity, int LeafCapacity>
+void Flat_index<T, InlineCapacity, LeafCapacity>::add_count(uint32_t* tree, uint32_t li, int32_t delta)
+{
+  for (uint32_t i = li + 1; i <= leaf_count; i += i & -i) {
+    tree[i - 1] += delta;
+  }
+}
+
+// total of the leaves before li
+template <class T, int InlineCapacity, int LeafCapacity>
+uint32_t Flat_index<T, InlineCapacity, LeafCapacity>::count_before(const uint32_t* tree, uint32_t li) const
+{
+  uint32_t count = 0;
+  for (uint32_t i = li; i > 0; i -= i & -i) {
+    count += tree[i - 1];
+  }
+  return count;
+}
+
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class Weight>
+uint32_t Flat_index<T, InlineCapacity, LeafCapacity>::extra_weight(const T* first, const T* last, const Weight& weight)
+{
+  uint32_t extra = 0;
+  for (; first != last; ++first) {
+    extra += weight(*first) - 1;
+  }
+  return extra;
+}
+
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class Alloc, class Weight>
+void Flat_index<T, InlineCapacity, LeafCapacity>::to_large(Alloc& alloc, const Weight& weight)
+{
+  assert(is_small());
+  Leaf* leaf = allocate_leaf(2 * InlineCapacity, alloc);
+  std::copy(small_data(), small_data() + size_, leaf->data());
+  leaf->size = size_;
+  leaf->extra = extra_weight(small_data(), small_data() + size_, weight);
+  Large& large = storage.large;
+  large.leaves = static_cast<Leaf**>(alloc.allocate(leaves_bytes(2)));
+  large.leaves_capacity = 2;
+  large.leaves[0] = leaf;
+  leaf_count = 1;
+  reset_counts();
+}
+
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class Alloc>
+void Flat_index<T, InlineCapacity, LeafCapacity>::to_small(Alloc& alloc)
+{
+  assert(!is_small() && size_ <= InlineCapacity);
+  Large large = storage.large;
+  T* dst = small_data();
+  for (uint32_t i = 0; i < leaf_count; ++i) {
+    dst = std::copy(large.leaves[i]->data(), large.leaves[i]->data() + large.leaves[i]->size, dst);
+    deallocate_leaf(large.leaves[i], alloc);
+  }
+  alloc.deallocate(large.leaves, leaves_bytes(large.leaves_capacity));
+  leaf_count = 0;
+}
+
+// leave the leaf representation with some hysteresis so that
+// an index oscillating around InlineCapacity does not reallocate on every update
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class Alloc>
+void Flat_index<T, InlineCapacity, LeafCapacity>::maybe_shrink(Alloc& alloc)
+{
+  if (!is_small() && size_ <= InlineCapacity / 2) {
+    to_small(alloc);
+  }
+}
+
+template <class T, int InlineCapacity, int LeafCapacity>
+typename Flat_index<T, InlineCapacity, LeafCapacity>::const_iterator
+Flat_index<T, InlineCapacity, LeafCapacity>::begin() const
+{
+  if (is_small()) {
+    return const_iterator(small_data(), small_data() + size_, nullptr, nullptr);
+  }
+  Leaf* const* leaves = storage.large.leaves;
+  const T* data = leaves[0]->data();
+  return const_iterator(data, data + leaves[0]->size, leaves, leaves + leaf_count - 1);
+}
+
+template <class T, int InlineCapacity, int LeafCapacity>
+typename Flat_index<T, InlineCapacity, LeafCapacity>::const_iterator
+Flat_index<T, InlineCapacity, LeafCapacity>::end() const
+{
+  if (is_small()) {
+    return const_iterator(small_data() + size_, small_data() + size_, nullptr, nullptr);
+  }
+  Leaf* const* last = storage.large.leaves + leaf_count - 1;
+  const T* leaf_end = (*last)->data() + (*last)->size;
+  return const_iterator(leaf_end, leaf_end, last, last);
+}
+
+// index of the leaf which should receive v: the first one whose last element is greater than v
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class Compare>
+uint32_t Flat_index<T, InlineCapacity, LeafCapacity>::find_leaf_for_insert(const T& v, const Compare& cmp) const
+{
+  Leaf* const* leaves = storage.large.leaves;
+  Leaf* const* it = std::partition_point(leaves, leaves + leaf_count - 1, [&](const Leaf* leaf) {
+    return !cmp(v, leaf->data()[leaf->size - 1]);
+  });
+  return static_cast<uint32_t>(it - leaves);
+}
+
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class Compare, class Alloc, class Weight>
+void Flat_index<T, InlineCapacity, LeafCapacity>::insert(const T& v, const Compare& cmp, Alloc& alloc,
+                                                         const Weight& weight)
+{
+  if (is_small()) {
+    if (size_ < InlineCapacity) {
+      T* data = small_data();
+      T* pos = std::upper_bound(data, data + size_, v, cmp);
+      std::copy_backward(pos, data + size_, data + size_ + 1);
+      *pos = v;
+      ++size_;
+      return;
+    }
+    to_large(alloc, weight);
+  }
+  Large& large = storage.large;
+  uint32_t li = find_leaf_for_insert(v, cmp);
+  Leaf* leaf = large.leaves[li];
+  if (leaf->size == leaf->capacity) {
+    if (leaf->capacity < static_cast<uint32_t>(LeafCapacity)) {
+      // grow a leaf like a vector until it reaches the full leaf size
+      Leaf* grown = allocate_leaf(std::min<uint32_t>(2 * leaf->capacity, LeafCapacity), alloc);
+      std::copy(leaf->data(), leaf->data() + leaf->size, grown->data());
+      grown->size = leaf->size;
+      grown->extra = leaf->extra;
+      deallocate_leaf(leaf, alloc);
+      large.leaves[li] = leaf = grown;
+    } else {
+      // split full leaf in halves
+      Leaf* right = allocate_leaf(LeafCapacity, alloc);
+      uint32_t half = leaf->size / 2;
+      std::copy(leaf->data() + half, leaf->data() + leaf->size, right->data());
+      right->size = leaf->size - half;
+      if (leaf->extra) {
+        right->extra = extra_weight(right->data(), right->data() + right->size, weight);
+        leaf->extra -= right->extra;
+      }
+      leaf->size = half;
+      insert_leaf(li + 1, right, alloc);
+      if (!cmp(v, right->data()[0])) {
+        leaf = right;
+        ++li;
+      }
+    }
+  }
+  T* data = leaf->data();
+  T* pos = std::upper_bound(data, data + leaf->size, v, cmp);
+  std::copy_backward(pos, data + leaf->size, data + leaf->size + 1);
+  *pos = v;
+  ++leaf->size;
+  ++size_;
+  add_count(leaf_counts(), li, 1);
+  uint32_t extra = weight(v) - 1;
+  if (extra) {
+    leaf->extra += extra;
+    add_count(leaf_extras(), li, extra);
+  }
+}
+
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class K, class Compare>
+typename Flat_index<T, InlineCapacity, LeafCapacity>::const_iterator
+Flat_index<T, InlineCapacity, LeafCapacity>::lower_bound(const K& v, const Compare& cmp) const
+{
+  if (is_small()) {
+    const T* data = small_data();
+    return const_iterator(std::lower_bound(data, data + size_, v, cmp), data + size_, nullptr, nullptr);
+  }
+  Leaf* const* leaves = storage.large.leaves;
+  Leaf* const* last = leaves + leaf_count - 1;
+  Leaf* const* leaf = std::partition_point(leaves, last, [&](const Leaf* l) {
+    return cmp(l->data()[l->size - 1], v);
+  });
+  const T* data = (*leaf)->data();
+  const T* leaf_end = data + (*leaf)->size;
+  // only in the last leaf lower_bound may reach leaf_end, which is end() then
+  return const_iterator(std::lower_bound(data, leaf_end, v, cmp), leaf_end, leaf, last);
+}
+
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class K, class Compare>
+typename Flat_index<T, InlineCapacity, LeafCapacity>::const_iterator
+Flat_index<T, InlineCapacity, LeafCapacity>::find(const K& v, const Compare& cmp) const
+{
+  const_iterator it = lower_bound(v, cmp);
+  if (it != end() && !cmp(v, *it)) {
+    return it;
+  }
+  return end();
+}
+
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class Pred>
+uint32_t Flat_index<T, InlineCapacity, LeafCapacity>::count_prefix(const Pred& pred) const
+{
+  if (is_small()) {
+    const T* data = small_data();
+    return static_cast<uint32_t>(std::partition_point(data, data + size_, pred) - data);
+  }
+  Leaf* const* leaves = storage.large.leaves;
+  Leaf* const* leaf = std::partition_point(leaves, leaves + leaf_count - 1, [&](const Leaf* l) {
+    return pred(l->data()[l->size - 1]);
+  });
+  const T* data = (*leaf)->data();
+  uint32_t in_leaf = static_cast<uint32_t>(std::partition_point(data, data + (*leaf)->size, pred) - data);
+  return count_before(leaf_counts(), static_cast<uint32_t>(leaf - leaves)) + in_leaf;
+}
+
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class Pred, class Weight>
+uint32_t Flat_index<T, InlineCapacity, LeafCapacity>::count_prefix(const Pred& pred, const Weight& weight) const
+{
+  if (is_small()) {
+    const T* data = small_data();
+    const T* last = std::partition_point(data, data + size_, pred);
+    return static_cast<uint32_t>(last - data) + extra_weight(data, last, weight);
+  }
+  Leaf* const* leaves = storage.large.leaves;
+  Leaf* const* leaf = std::partition_point(leaves, leaves + leaf_count - 1, [&](const Leaf* l) {
+    return pred(l->data()[l->size - 1]);
+  });
+  uint32_t li = static_cast<uint32_t>(leaf - leaves);
+  const T* data = (*leaf)->data();
+  const T* last = std::partition_point(data, data + (*leaf)->size, pred);
+  uint32_t in_leaf = static_cast<uint32_t>(last - data);
+  if ((*leaf)->extra) {
+    in_leaf += extra_weight(data, last, weight);
+  }
+  return count_before(leaf_counts(), li) + count_before(leaf_extras(), li) + in_leaf;
+}
+
+template <class T, int InlineCapacity, int LeafCapacity>
+void Flat_index<T, InlineCapacity, LeafCapacity>::add_weight(const_iterator it, int32_t delta)
+{
+  if (is_small()) {
+    return;
+  }
+  uint32_t li = static_cast<uint32_t>(it.leaf - storage.large.leaves);
+  storage.large.leaves[li]->extra += delta;
+  add_count(leaf_extras(), li, delta);
+}
+
+// descends the Fenwick tree to the leaf holding position pos
+template <class T, int InlineCapacity, int LeafCapacity>
+typename Flat_index<T, InlineCapacity, LeafCapacity>::const_iterator
+Flat_index<T, InlineCapacity, LeafCapacity>::nth(uint32_t pos) const
+{
+  assert(pos <= size_);
+  if (is_small()) {
+    return const_iterator(small_data() + pos, small_data() + size_, nullptr, nullptr);
+  }
+  if (pos == size_) {
+    return end();
+  }
+  const uint32_t* counts = leaf_counts();
+  uint32_t li = 0;
+  uint32_t step = 1;
+  while (2 * step <= leaf_count) {
+    step *= 2;
+  }
+  for (; step > 0; step /= 2) {
+    if (li + step <= leaf_count && counts[li + step - 1] <= pos) {
+      li += step;
+      pos -= counts[li - 1];
+    }
+  }
+  Leaf* const* leaves = storage.large.leaves;
+  const T* data = leaves[li]->data();
+  return const_iterator(data + pos, data + leaves[li]->size, leaves + li, leaves + leaf_count - 1);
+}
+
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class Fn>
+void Flat_index<T, InlineCapacity, LeafCapacity>::for_each_run(Fn fn) const
+{
+  if (is_small()) {
+    if (size_ > 0) {
+      fn(small_data(), small_data() + size_);
+    }
+    return;
+  }
+  Leaf* const* leaves = storage.large.leaves;
+  for (uint32_t i = 0; i < leaf_count; ++i) {
+    if (!fn(leaves[i]->data(), leaves[i]->data() + leaves[i]->size)) {
+      return;
+    }
+  }
+}
+
+// leaves are filled evenly and allocated exactly, they grow on the next insert
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class Alloc, class Weight>
+void Flat_index<T, InlineCapacity, LeafCapacity>::assign_sorted(const T* first, const T* last, Alloc& alloc,
+                                                                const Weight& weight)
+{
+  assert(empty() && is_small());
+  uint32_t n = static_cast<uint32_t>(last - first);
+  if (n <= static_cast<uint32_t>(InlineCapacity)) {
+    std::copy(first, last, small_data());
+    size_ = n;
+    return;
+  }
+  uint32_t count = (n + LeafCapacity - 1) / LeafCapacity;
+  Large& large = storage.large;
+  large.leaves = static_cast<Leaf**>(alloc.allocate(leaves_bytes(count)));
+  large.leaves_capacity = count;
+  for (uint32_t i = 0; i < count; ++i) {
+    uint32_t size = n / count + (i < n % count ? 1 : 0);
+    Leaf* leaf = allocate_leaf(size, alloc);
+    std::copy(first, first + size, leaf->data());
+    leaf->size = size;
+    leaf->extra = extra_weight(first, first + size, weight);
+    large.leaves[i] = leaf;
+    first += size;
+  }
+  leaf_count = count;
+  size_ = n;
+  reset_counts();
+}
+
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class Alloc, class Weight>
+void Flat_index<T, InlineCapacity, LeafCapacity>::erase(const_iterator it, Alloc& alloc, const Weight& weight)
+{
+  if (is_small()) {
+    T* data = small_data();
+    T* pos = data + (it.p - data);
+    std::copy(pos + 1, data + size_, pos);
+    --size_;
+    return;
+  }
+  uint32_t li = static_cast<uint32_t>(it.leaf - storage.large.leaves);
+  Leaf* leaf = storage.large.leaves[li];
+  T* pos = leaf->data() + (it.p - leaf->data());
+  uint32_t extra = leaf->extra ? weight(*pos) - 1 : 0;
+  std::copy(pos + 1, leaf->data() + leaf->size, pos);
+  --size_;
+  if (--leaf->size == 0) {
+    remove_leaves(li, li + 1, alloc);
+  } else {
+    add_count(leaf_counts(), li, -1);
+    if (extra) {
+      leaf->extra -= extra;
+      add_count(leaf_extras(), li, -static_cast<int32_t>(extra));
+    }
+  }
+  maybe_shrink(alloc);
+}
+
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class Alloc, class Weight>
+void Flat_index<T, InlineCapacity, LeafCapacity>::erase(const_iterator first, const_iterator last, Alloc& alloc,
+                                                        const Weight& weight)
+{
+  if (first == last) {
+    return;
+  }
+  if (is_small()) {
+    T* data = small_data();
+    T* f = data + (first.p - data);
+    T* l = data + (last.p - data);
+    std::copy(l, data + size_, f);
+    size_ -= static_cast<uint32_t>(l - f);
+    return;
+  }
+  Leaf** leaves = storage.large.leaves;
+  uint32_t lf = static_cast<uint32_t>(first.leaf - leaves);
+  uint32_t ll = static_cast<uint32_t>(last.leaf - leaves);
+  uint32_t pf = static_cast<uint32_t>(first.p - leaves[lf]->data());
+  uint32_t pl = static_cast<uint32_t>(last.p - leaves[ll]->data());
+  if (lf == ll) {
+    Leaf* leaf = leaves[lf];
+    uint32_t extra = leaf->extra ? extra_weight(leaf->data() + pf, leaf->data() + pl, weight) : 0;
+    std::copy(leaf->data() + pl, leaf->data() + leaf->size, leaf->data() + pf);
+    leaf->size -= pl - pf;
+    size_ -= pl - pf;
+    if (leaf->size == 0) {
+      remove_leaves(lf, lf + 1, alloc);
+    } else {
+      add_count(leaf_counts(), lf, -static_cast<int32_t>(pl - pf));
+      if (extra) {
+        leaf->extra -= extra;
+        add_count(leaf_extras(), lf, -static_cast<int32_t>(extra));
+      }
+    }
+    maybe_shrink(alloc);
+    return;
+  }
+  // drop the tail of the first leaf, the whole leaves in between and the head of the last leaf
+  for (uint32_t i = lf + 1; i < ll; ++i) {
+    size_ -= leaves[i]->size;
+  }
+  size_ -= leaves[lf]->size - pf;
+  if (leaves[lf]->extra) {
+    leaves[lf]->extra -= extra_weight(leaves[lf]->data() + pf, leaves[lf]->data() + leaves[lf]->size, weight);
+  }
+  leaves[lf]->size = pf;
+  Leaf* leaf = leaves[ll];
+  if (leaf->extra) {
+    leaf->extra -= extra_weight(leaf->data(), leaf->data() + pl, weight);
+  }
+  std::copy(leaf->data() + pl, leaf->data() + leaf->size, leaf->data());
+  leaf->size -= pl;
+  size_ -= pl;
+  uint32_t from = pf == 0 ? lf : lf + 1;
+  uint32_t to = leaf->size == 0 ? ll + 1 : ll;
+  remove_leaves(from, to, alloc);
+  maybe_shrink(alloc);
+}
+
+template <class T, int InlineCapacity, int LeafCapacity>
+template <class Alloc>
+void Flat_index<T, InlineCapacity, LeafCapacity>::clear(Alloc& alloc)
+{
+  if (!is_small()) {
+    remove_leaves(0, leaf_count, alloc);
+  }
+  size_ = 0;
+}
+
+#endif // FLAT_INDEX_H
@@ -0,0 +1,522 @@
+#ifndef FROZEN_INTERVAL_INDEX_H
+#define FROZEN_INTERVAL_INDEX_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Index_file.h"
+
+// Immutable interval index without pointers, built once from a range of intervals.
+// The distinct infs are the keys of an implicit balanced search tree stored in Eytzinger order,
+// node k has children 2k and 2k + 1, so a descent reads one array from the front
+// and a few levels ahead are prefetched together.
+// An interval is stored at the topmost node among the keys it contains or starts at,
+// those keys form an in-order range and its topmost node is on the search path of every point
+// of the interval, the same placement rule as in the skip list with tree depth for height.
+// The intervals of a node are kept in lbound order next to the intervals of the neighbouring nodes,
+// the rbound order of a node is a permutation of its slice.
+// The arrays hold no pointers, save() writes them to a file that open() maps and queries in place.
+template <class Interval_>
+class Frozen_interval_index
+{
+public:
+  typedef Interval_ Interval;
+  typedef typename Interval::Value Value;
+  typedef const Interval* const_iterator;
+
+private:
+  struct Node {
+    Value key;
+    uint32_t first; // slice [first, first + size) of intervals and rbound
+    uint32_t size;
+  };
+
+  struct Arrays {
+    std::vector<Node> nodes;
+    std::vector<Interval> intervals;
+    std::vector<uint32_t> rbound;
+  };
+
+  // the arrays are owned by storage, an Arrays of an index built in memory or a Mapped_file
+  std::shared_ptr<const void> storage;
+  const Node* nodes; // 1-based, nodes[0] is unused
+  uint32_t key_count;
+  const Interval* intervals;
+  const uint32_t* rbound;
+  std::size_t interval_count;
+
+  static bool inf_less(const Interval& a, const Interval& b);
+  static bool sup_less(const Interval& a, const Interval& b);
+
+  uint32_t node_count() const {
+    return key_count;
+  }
+  // first node in key order, 0 if there is none
+  uint32_t leftmost() const {
+    uint32_t k = node_count() ? 1 : 0;
+    while (k && 2 * k <= node_count())
+      k *= 2;
+    return k;
+  }
+  // first node with key not less than v in key order, 0 if there is none
+  uint32_t lower_bound(const Value& v) const;
+  // next node in key order, 0 after the last one
+  uint32_t successor(uint32_t k) const;
+  void prefetch_below(uint32_t k) const {
+    // the grandchildren 4k .. 4k + 3 are adjacent
+    __builtin_prefetch(nodes + std::min<std::size_t>(4 * std::size_t(k), node_count()));
+  }
+
+  // length of the prefix of the slice of node k satisfying pred, in lbound or rbound order
+  template <class Pred>
+  uint32_t lbound_prefix(const Node& n, const Pred& pred) const;
+  template <class Pred>
+  uint32_t rbound_prefix(const Node& n, const Pred& pred) const;
+
+public:
+  Frozen_interval_index();
+  template <class InputIterator>
+  Frozen_interval_index(InputIterator b, InputIterator e);
+
+  bool is_contained(const Value& value) const;
+  template <class OutputIterator>
+  OutputIterator find_intervals(const Value& value, OutputIterator out) const;
+  // reports once every interval sharing a point with the window from l to r with closedness lb, rb
+  template <class OutputIterator>
+  OutputIterator find_overlapping(const Value& l, const Value& r, bool lb, bool rb, OutputIterator out) const;
+
+  // counts take the length of slice prefixes instead of visiting the intervals
+  std::size_t count_intervals(const Value& value) const;
+  // visits the nodes with keys in [l, r] but none of the intervals
+  std::size_t count_overlapping(const Value& l, const Value& r, bool lb, bool rb) const;
+
+  // writes the index to path, the file replaces an existing one only once it is complete
+  void save(const std::string& path) const;
+  // maps a file written by save() and checks its header, the arrays are neither read nor copied.
+  // verify also compares the checksums of the arrays, reading the whole file
+  static Frozen_interval_index open(const std::string& path, bool verify = false);
+
+  int size() const {
+    return static_cast<int>(interval_count);
+  }
+  // bytes of the arrays, without the object itself
+  std::size_t memory_usage() const {
+    return (key_count + 1) * sizeof(Node) + interval_count * (sizeof(Interval) + sizeof(uint32_t));
+  }
+
+  // intervals in no particular order
+  const_iterator begin() const {
+    return intervals;
+  }
+  const_iterator end() const {
+    return intervals + interval_count;
+  }
+};
+
+// same orders as the indexes of the skip list nodes
+template <class Interval_>
+bool Frozen_interval_index<Interval_>::inf_less(const Interval& a, const Interval& b)
+{
+  if (a.inf() != b.inf())
+    return a.inf() < b.inf();
+  if (a.inf_closed() != b.inf_closed())
+    return a.inf_closed();
+  if (a.sup() != b.sup())
+    return a.sup() > b.sup();
+  if (a.sup_closed() != b.sup_closed())
+    return a.sup_closed();
+  return false;
+}
+
+template <class Interval_>
+bool Frozen_interval_index<Interval_>::sup_less(const Interval& a, const Interval& b)
+{
+  if (a.sup() != b.sup())
+    return a.sup() > b.sup();
+  if (a.sup_closed() != b.sup_closed())
+    return a.sup_closed();
+  if (a.inf() != b.inf())
+    return a.inf() < b.inf();
+  if (a.inf_closed() != b.inf_closed())
+    return a.inf_closed();
+  return false;
+}
+
+template <class Interval_>
+Frozen_interval_index<Interval_>::Frozen_interval_index()
+{
+  static const Node root_slot = Node();
+  nodes = &root_slot;
+  key_count = 0;
+  intervals = nullptr;
+  rbound = nullptr;
+  interval_count = 0;
+}
+
+template <class Interval_>
+template <class InputIterator>
+Frozen_interval_index<Interval_>::Frozen_interval_index(InputIterator b, InputIterator e)
+{
+  std::shared_ptr<Arrays> arrays = std::make_shared<Arrays>();
+  std::vector<Interval> input(b, e);
+  assert(input.size() < UINT32_MAX);
+  std::vector<Value> keys;
+  keys.reserve(input.size());
+  for (const Interval& i : input)
+    keys.push_back(i.inf());
+  std::sort(keys.begin(), keys.end());
+  keys.erase(std::unique(keys.begin(), keys.end()), keys.end());
+
+  // in-order walk of the implicit tree hands out the keys in sorted order
+  arrays->nodes.resize(keys.size() + 1);
+  nodes = arrays->nodes.data();
+  key_count = static_cast<uint32_t>(keys.size());
+  std::vector<uint32_t> node_of(key_count);
+  uint32_t rank = 0;
+  for (uint32_t k = leftmost(); k != 0; k = successor(k)) {
+    arrays->nodes[k].key = keys[rank];
+    node_of[rank++] = k;
+  }
+
+  // the matching keys of an interval are the ranks from its inf to the last key it contains,
+  // the lowest common ancestor of the two ends is the topmost node of the range
+  std::vector<uint32_t> owner(input.size());
+  for (std::size_t t = 0; t < input.size(); ++t) {
+    const Interval& i = input[t];
+    auto lo = std::lower_bound(keys.begin(), keys.end(), i.inf());
+    auto hi = std::upper_bound(lo, keys.end(), i.sup()) - 1;
+    if (*hi == i.sup() && !i.sup_closed() && hi != lo)
+      --hi;
+    uint32_t x = node_of[lo - keys.begin()];
+    uint32_t y = node_of[std::max(lo, hi) - keys.begin()];
+    while (x != y) {
+      if (x > y)
+        x >>= 1;
+      else
+        y >>= 1;
+    }
+    owner[t] = x;
+  }
+
+  std::vector<uint32_t> order(input.size());
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&](uint32_t x, uint32_t y) {
+    if (owner[x] != owner[y])
+      return owner[x] < owner[y];
+    return inf_less(input[x], input[y]);
+  });
+  std::vector<Interval>& sorted = arrays->intervals;
+  sorted.reserve(input.size());
+  for (uint32_t t : order)
+    sorted.push_back(input[t]);
+
+  std::vector<uint32_t>& by_sup = arrays->rbound;
+  by_sup.resize(sorted.size());
+  std::iota(by_sup.begin(), by_sup.end(), 0);
+  for (uint32_t t = 0, k = 1; k <= key_count; ++k) {
+    uint32_t first = t;
+    while (t < order.size() && owner[order[t]] == k)
+      ++t;
+    arrays->nodes[k].first = first;
+    arrays->nodes[k].size = t - first;
+    std::sort(by_sup.begin() + first, by_sup.begin() + t, [&](uint32_t x, uint32_t y) {
+      return sup_less(sorted[x], sorted[y]);
+    });
+  }
+
+  intervals = sorted.data();
+  rbound = by_sup.data();
+  interval_count = sorted.size();
+  storage = std::move(arrays);
+}
+
+template <class Interval_>
+uint32_t Frozen_interval_index<Interval_>::lower_bound(const Value& v) const
+{
+  const uint32_t m = node_count();
+  uint32_t k = 1;
+  while (k <= m) {
+    prefetch_below(k);
+    k = 2 * k + (nodes[k].key < v ? 1 : 0);
+  }
+  // undo the right turns after the last left turn, at most the path to the root
+  k >>= __builtin_ffs(~k);
+  return k;
+}
+
+template <class Interval_>
+uint32_t Frozen_interval_index<Interval_>::successor(uint32_t k) const
+{
+  const uint32_t m = node_count();
+  if (2 * k + 1 <= m) {
+    k = 2 * k + 1;
+    while (2 * k <= m)
+      k *= 2;
+    return k;
+  }
+  while (k & 1)
+    k >>= 1;
+  return k >> 1;
+}
+
+template <class Interval_>
+template <class Pred>
+uint32_t Frozen_interval_index<Interval_>::lbound_prefix(const Node& n, const Pred& pred) const
+{
+  const Interval* first = intervals + n.first;
+  return static_cast<uint32_t>(std::partition_point(first, first + n.size, pred) - first);
+}
+
+template <class Interval_>
+template <class Pred>
+uint32_t Frozen_interval_index<Interval_>::rbound_prefix(const Node& n, const Pred& pred) const
+{
+  const uint32_t* first = rbound + n.first;
+  return static_cast<uint32_t>(std::partition_point(first, first + n.size, [&](uint32_t t) {
+    return pred(intervals[t]);
+  }) - first);
+}
+
+template <class Interval_>
+bool Frozen_interval_index<Interval_>::is_contained(const Value& value) const
+{
+  const uint32_t m = node_count();
+  for (uint32_t k = 1; k <= m;) {
+    const Node& n = nodes[k];
+    prefetch_below(k);
+    if (n.key < value) {
+      if (n.size && intervals[rbound[n.first]].contains(value))
+        return true;
+      k = 2 * k + 1;
+    } else {
+      if (n.size && intervals[n.first].contains(value))
+        return true;
+      if (n.key == value)
+        break;
+      k = 2 * k;
+    }
+  }
+  return false;
+}
+
+template <class Interval_>
+template <class OutputIterator>
+OutputIterator Frozen_interval_index<Interval_>::find_intervals(const Value& value, OutputIterator out) const
+{
+  // left of the point the containing intervals of a node are a prefix of its rbound order,
+  // at or right of it a prefix of its lbound order
+  const uint32_t m = node_count();
+  for (uint32_t k = 1; k <= m;) {
+    const Node& n = nodes[k];
+    prefetch_below(k);
+    if (n.key < value) {
+      for (uint32_t t = n.first; t != n.first + n.size && intervals[rbound[t]].contains(value); ++t) {
+        out = intervals[rbound[t]];
+        ++out;
+      }
+      k = 2 * k + 1;
+    } else {
+      for (uint32_t t = n.first; t != n.first + n.size && intervals[t].contains(value); ++t) {
+        out = intervals[t];
+        ++out;
+      }
+      if (n.key == value)
+        break;
+      k = 2 * k;
+    }
+  }
+  return out;
+}
+
+template <class Interval_>
+template <class OutputIterator>
+OutputIterator Frozen_interval_index<Interval_>::find_overlapping(const Value& l, const Value& r, bool lb, bool rb,
+                                                                  OutputIterator out) const
+{
+  assert(!(r < l));
+  // same split as in the skip list: nodes left of l on the search path of l,
+  // the nodes in [l, r] and the nodes right of r on the search path of r
+  const uint32_t m = node_count();
+  for (uint32_t k = 1; k <= m;) {
+    const Node& n = nodes[k];
+    if (n.key < l) {
+      for (uint32_t t = n.first; t != n.first + n.size && intervals[rbound[t]].overlaps(l, r, lb, rb); ++t) {
+        out = intervals[rbound[t]];
+        ++out;
+      }
+      k = 2 * k + 1;
+    } else {
+      k = 2 * k;
+    }
+  }
+  for (uint32_t k = lower_bound(l); k != 0 && !(r < nodes[k].key); k = successor(k)) {
+    const Node& n = nodes[k];
+    for (uint32_t t = n.first; t != n.first + n.size; ++t) {
+      if (intervals[t].overlaps(l, r, lb, rb)) {
+        out = intervals[t];
+        ++out;
+      }
+    }
+  }
+  for (uint32_t k = 1; k <= m;) {
+    const Node& n = nodes[k];
+    if (r < n.key) {
+      for (uint32_t t = n.first; t != n.first + n.size && intervals[t].overlaps(l, r, lb, rb); ++t) {
+        out = intervals[t];
+        ++out;
+      }
+      k = 2 * k;
+    } else {
+      k = 2 * k + 1;
+    }
+  }
+  return out;
+}
+
+template <class Interval_>
+std::size_t Frozen_interval_index<Interval_>::count_intervals(const Value& value) const
+{
+  auto contains = [&](const Interval& i) { return i.contains(value); };
+  std::size_t count = 0;
+  const uint32_t m = node_count();
+  for (uint32_t k = 1; k <= m;) {
+    const Node& n = nodes[k];
+    prefetch_below(k);
+    if (n.key < value) {
+      count += rbound_prefix(n, contains);
+      k = 2 * k + 1;
+    } else {
+      count += lbound_prefix(n, contains);
+      if (n.key == value)
+        break;
+      k = 2 * k;
+    }
+  }
+  return count;
+}
+
+template <class Interval_>
+std::size_t Frozen_interval_index<Interval_>::count_overlapping(const Value& l, const Value& r, bool lb,
+                                                                bool rb) const
+{
+  assert(!(r < l));
+  auto overlaps = [&](const Interval& i) { return i.overlaps(l, r, lb, rb); };
+  std::size_t count = 0;
+  const uint32_t m = node_count();
+  for (uint32_t k = 1; k <= m;) {
+    if (nodes[k].key < l) {
+      count += rbound_prefix(nodes[k], overlaps);
+      k = 2 * k + 1;
+    } else {
+      k = 2 * k;
+    }
+  }
+  // left of r the overlapping intervals are a prefix of rbound order, at r of lbound order
+  for (uint32_t k = lower_bound(l); k != 0 && !(r < nodes[k].key); k = successor(k)) {
+    if (nodes[k].key < r)
+      count += rbound_prefix(nodes[k], overlaps);
+    else
+      count += lbound_prefix(nodes[k], overlaps);
+  }
+  for (uint32_t k = 1; k <= m;) {
+    if (r < nodes[k].key) {
+      count += lbound_prefix(nodes[k], overlaps);
+      k = 2 * k;
+    } else {
+      k = 2 * k + 1;
+    }
+  }
+  return count;
+}
+
+template <class Interval_>
+void Frozen_interval_index<Interval_>::save(const std::string& path) const
+{
+  static_assert(std::is_trivially_copyable<Interval>::value, "an index file holds the bytes of the intervals");
+  Index_file_header h = Index_file_header();
+  std::memcpy(h.magic, index_file_magic, sizeof(h.magic));
+  h.version = Index_file_header::current_version;
+  h.endian_tag = Index_file_header::endian_value;
+  h.value_size = sizeof(Value);
+  h.interval_size = sizeof(Interval);
+  h.node_size = sizeof(Node);
+  h.node_count = key_count;
+  h.interval_count = interval_count;
+  const void* data[3] = {nodes, intervals, rbound};
+  const std::size_t bytes[3] = {(key_count + 1) * sizeof(Node), interval_count * sizeof(Interval),
+                                interval_count * sizeof(uint32_t)};
+
+  // the header is written twice, the second time with the offsets and checksums
+  Index_file_writer writer(path);
+  writer.write(&h, sizeof(h));
+  for (int i = 0; i < 3; ++i) {
+    writer.align();
+    h.section_offset[i] = writer.tell();
+    h.section_checksum[i] = index_checksum(data[i], bytes[i]);
+    writer.write(data[i], bytes[i]);
+  }
+  h.file_size = writer.tell();
+  h.header_checksum = index_header_checksum(h);
+  writer.rewrite_header(h);
+  writer.commit();
+}
+
+template <class Interval_>
+Frozen_interval_index<Interval_> Frozen_interval_index<Interval_>::open(const std::string& path, bool verify)
+{
+  static_assert(std::is_trivially_copyable<Interval>::value, "an index file holds the bytes of the intervals");
+  static_assert(alignof(Node) <= index_file_alignment && alignof(Interval) <= index_file_alignment,
+                "arrays are aligned to index_file_alignment in the file");
+  std::shared_ptr<Mapped_file> file = std::make_shared<Mapped_file>(path);
+  auto error = [&](const char* what) { return std::runtime_error(path + ": " + what); };
+  Index_file_header h;
+  if (file->size() < sizeof(h))
+    throw error("not an index file");
+  std::memcpy(&h, file->data(), sizeof(h));
+  if (std::memcmp(h.magic, index_file_magic, sizeof(h.magic)) != 0)
+    throw error("not an index file");
+  if (h.endian_tag != Index_file_header::endian_value)
+    throw error("index file of another byte order");
+  if (h.version != Index_file_header::current_version)
+    throw error("unsupported index file version");
+  if (h.header_checksum != index_header_checksum(h))
+    throw error("corrupt index file header");
+  if (h.value_size != sizeof(Value) || h.interval_size != sizeof(Interval) || h.node_size != sizeof(Node))
+    throw error("index file of another interval type");
+  if (h.file_size != file->size())
+    throw error("truncated index file");
+  if (h.interval_count >= UINT32_MAX)
+    throw error("corrupt index file header");
+
+  // the header is trusted once its checksum matches, the arrays only with verify
+  const uint64_t bytes[3] = {(uint64_t(h.node_count) + 1) * sizeof(Node), h.interval_count * sizeof(Interval),
+                             h.interval_count * sizeof(uint32_t)};
+  for (int i = 0; i < 3; ++i) {
+    if (h.section_offset[i] % index_file_alignment != 0 || h.section_offset[i] > h.file_size ||
+        bytes[i] > h.file_size - h.section_offset[i])
+      throw error("corrupt index file header");
+    if (verify && index_checksum(file->data() + h.section_offset[i], bytes[i]) != h.section_checksum[i])
+      throw error("index file checksum mismatch");
+  }
+
+  Frozen_interval_index index;
+  index.nodes = reinterpret_cast<const Node*>(file->data() + h.section_offset[0]);
+  index.key_count = h.node_count;
+  index.intervals = reinterpret_cast<const Interval*>(file->data() + h.section_offset[1]);
+  index.rbound = reinterpret_cast<const uint32_t*>(file->data() + h.section_offset[2]);
+  index.interval_count = h.interval_count;
+  index.storage = std::move(file);
+  return index;
+}
+
+#endif // FROZEN_INTERVAL_INDEX_H
@@ -0,0 +1,196 @@
+#ifndef INDEX_FILE_H
+#define INDEX_FILE_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// Layout of an index file: this header, then the arrays of the index each at a multiple
+// of index_file_alignment. Offsets are from the start of the file, so a read-only mapping
+// of the whole file is the index.
+// The values are in the byte order of the writer, endian_tag tells a foreign file apart.
+struct Index_file_header {
+  static const uint32_t current_version = 1;
+  static const uint32_t endian_value = 0x01020304;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t endian_tag;
+  uint32_t value_size;    // sizeof of the key type
+  uint32_t interval_size; // sizeof of the interval type
+  uint32_t node_size;
+  uint32_t node_count;
+  uint64_t interval_count;
+  uint64_t file_size;
+  uint64_t section_offset[3];
+  uint64_t section_checksum[3]; // over the bytes of each array, checked on request
+  uint64_t header_checksum;     // over the header up to this field, always checked
+};
+
+static const char index_file_magic[8] = {'I', 'S', 'L', 'I', 'D', 'X', '\0', '\0'};
+static const std::size_t index_file_alignment = 64;
+
+// word-wise multiplicative hash, cheap enough to run over a whole file at disk speed
+inline uint64_t index_checksum(const void* data, std::size_t size)
+{
+  const unsigned char* p = static_cast<const unsigned char*>(data);
+  uint64_t h = 0x9e3779b97f4a7c15ull ^ size;
+  for (; size >= 8; p += 8, size -= 8) {
+    uint64_t w;
+    std::memcpy(&w, p, 8);
+    h = (h ^ w) * 0xff51afd7ed558ccdull;
+    h ^= h >> 32;
+  }
+  for (; size > 0; ++p, --size)
+    h = (h ^ *p) * 0x100000001b3ull;
+  return h;
+}
+
+inline uint64_t index_header_checksum(const Index_file_header& h)
+{
+  return index_checksum(&h, offsetof(Index_file_header, header_checksum));
+}
+
+// read-only mapping of a whole file, unmapped by the destructor
+class Mapped_file
+{
+  void* addr;
+  std::size_t length;
+
+public:
+  explicit Mapped_file(const std::string& path)
+  : addr(nullptr), length(0)
+  {
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+      throw std::runtime_error(path + ": " + std::strerror(errno));
+    struct stat st;
+    if (::fstat(fd, &st) != 0) {
+      int err = errno;
+      ::close(fd);
+      throw std::runtime_error(path + ": " + std::strerror(err));
+    }
+    length = static_cast<std::size_t>(st.st_size);
+    if (length > 0) {
+      addr = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+      if (addr == MAP_FAILED) {
+        int err = errno;
+        ::close(fd);
+        throw std::runtime_error(path + ": " + std::strerror(err));
+      }
+    }
+    // the mapping stays valid without the descriptor
+    ::close(fd);
+  }
+  Mapped_file(const Mapped_file&) = delete;
+  Mapped_file& operator=(const Mapped_file&) = delete;
+  ~Mapped_file() {
+    if (addr)
+      ::munmap(addr, length);
+  }
+
+  const char* data() const {
+    return static_cast<const char*>(addr);
+  }
+  std::size_t size() const {
+    return length;
+  }
+};
+
+// makes a rename or a new file in the directory of path durable
+inline void sync_parent_dir(const std::string& path)
+{
+  std::string::size_type slash = path.rfind('/');
+  std::string dir = slash == std::string::npos ? "." : slash == 0 ? "/" : path.substr(0, slash);
+  int fd = ::open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0)
+    throw std::runtime_error(dir + ": " + std::strerror(errno));
+  int rc = ::fsync(fd);
+  int err = errno;
+  ::close(fd);
+  if (rc != 0)
+    throw std::runtime_error(dir + ": " + std::strerror(err));
+}
+
+// writes a file under a temporary name and renames it into place on commit(),
+// so that readers never map a partly written file
+class Index_file_writer
+{
+  std::string path;
+  std::string tmp_path;
+  std::FILE* file;
+  uint64_t offset;
+
+  void fail() {
+    int err = errno;
+    std::fclose(file);
+    file = nullptr;
+    std::remove(tmp_path.c_str());
+    throw std::runtime_error(tmp_path + ": " + std::strerror(err));
+  }
+
+public:
+  explicit Index_file_writer(const std::string& path)
+  : path(path), tmp_path(path + ".tmp"), offset(0)
+  {
+    file = std::fopen(tmp_path.c_str(), "wb");
+    if (!file)
+      throw std::runtime_error(tmp_path + ": " + std::strerror(errno));
+  }
+  Index_file_writer(const Index_file_writer&) = delete;
+  Index_file_writer& operator=(const Index_file_writer&) = delete;
+  ~Index_file_writer() {
+    if (file) {
+      std::fclose(file);
+      std::remove(tmp_path.c_str());
+    }
+  }
+
+  uint64_t tell() const {
+    return offset;
+  }
+  void write(const void* data, std::size_t size) {
+    if (size && std::fwrite(data, 1, size, file) != size)
+      fail();
+    offset += size;
+  }
+  // zero fill up to the next multiple of index_file_alignment
+  void align() {
+    static const char zeros[index_file_alignment] = {};
+    write(zeros, (index_file_alignment - offset % index_file_alignment) % index_file_alignment);
+  }
+  // overwrites the header at the start of the file
+  template <class Header>
+  void rewrite_header(const Header& h) {
+    if (std::fseek(file, 0, SEEK_SET) != 0 || std::fwrite(&h, sizeof(h), 1, file) != 1 ||
+        std::fseek(file, 0, SEEK_END) != 0)
+      fail();
+  }
+  void commit() {
+    if (std::fflush(file) != 0 || ::fsync(::fileno(file)) != 0)
+      fail();
+    if (std::fclose(file) != 0) {
+      file = nullptr;
+      std::remove(tmp_path.c_str());
+      throw std::runtime_error(tmp_path + ": " + std::strerror(errno));
+    }
+    file = nullptr;
+    if (std::rename(tmp_path.c_str(), path.c_str()) != 0) {
+      int err = errno;
+      std::remove(tmp_path.c_str());
+      throw std::runtime_error(path + ": " + std::strerror(err));
+    }
+    sync_parent_dir(path);
+  }
+};
+
+#endif // INDEX_FILE_H
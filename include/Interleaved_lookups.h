@@ -0,0 +1,58 @@
+#ifndef INTERLEAVED_LOOKUPS_H
+#define INTERLEAVED_LOOKUPS_H
+
+#include <algorithm>
+#include <cstddef>
+#include <utility>
+
+#ifndef ISL_BATCH_WIDTH
+#define ISL_BATCH_WIDTH 16 // lookups kept in flight by run_interleaved
+#endif
+
+// runs lookups 0..n-1 ISL_BATCH_WIDTH at a time, one step of each in turn. start(s, j) sets up
+// lookup j in s, step(s) advances it by one node and returns false when it is done.
+// A step prefetches the node read by the next step of the same lookup, so the miss is
+// served while the other lookups make progress
+template <class State, class Start, class Step>
+void run_interleaved(std::size_t n, Start start, Step step)
+{
+  State states[ISL_BATCH_WIDTH];
+  std::size_t width = std::min<std::size_t>(n, ISL_BATCH_WIDTH);
+  std::size_t next = 0;
+  for (; next < width; ++next)
+    start(states[next], next);
+  while (width > 0) {
+    for (std::size_t k = 0; k < width;) {
+      if (step(states[k])) {
+        ++k;
+      } else if (next < n) {
+        start(states[k++], next++);
+      } else {
+        // the last lookup takes the slot and is stepped next
+        states[k] = states[--width];
+      }
+    }
+  }
+}
+
+// output iterator reporting intervals as std::pair<std::size_t, Interval> tagged with a query index
+template <class OutputIterator>
+class Tagged_output
+{
+  OutputIterator& out;
+  std::size_t j;
+
+public:
+  Tagged_output(OutputIterator& out, std::size_t j) : out(out), j(j) {}
+
+  template <class Interval>
+  Tagged_output& operator=(const Interval& i) {
+    out = std::make_pair(j, i);
+    ++out;
+    return *this;
+  }
+  Tagged_output& operator*() { return *this; }
+  Tagged_output& operator++() { return *this; }
+};
+
+#endif // INTERLEAVED_LOOKUPS_H
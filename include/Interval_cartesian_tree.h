@@ -1,14 +1,24 @@
 #ifndef INTERVAL_CARTESIAN_TREE_H
 #define INTERVAL_CARTESIAN_TREE_H
 
+#include <algorithm>
 #include <cstdint>
+#include <functional>
+#include <iterator>
 #include <random>
-#include <list>
-#include <queue>
-#include <set>
+#include <type_traits>
+#include <utility>
+#include <vector>
 
 #include <boost/random/linear_congruential.hpp>
 
+#include "Flat_index.h"
+#include "Frozen_interval_index.h"
+#include "Interleaved_lookups.h"
+#include "Interval_slab.h"
+#include "Node_arena.h"
+#include "Parallel_for.h"
+
 template<class Interval_>
 class ICTnode;
 
@@ -21,18 +31,35 @@ class ICTnode {
   typedef Self_* Self_ptr_;
   typedef typename Interval_::Value Value_;
   typedef typename Interval_cartesian_tree<Interval_>::Priority_ Priority_;
-  typedef typename Interval_cartesian_tree<Interval_>::Interval_handle_ Interval_handle_;
+  typedef Interval_cartesian_tree<Interval_> Owner_;
+  typedef Interval_slab<Interval_> Container_;
+  typedef typename Container_::Handle Interval_handle_;
+
+  // compares handles resolved through the container and plain intervals in any combination
+  template <class Derived>
+  struct handle_cmp {
+    const Container_& container;
+    explicit handle_cmp(const Container_& container) : container(container) {}
+    const Interval_& get(Interval_handle_ h) const { return container[h]; }
+    const Interval_& get(const Interval_& i) const { return i; }
+    template <class A, class B>
+    bool operator()(const A& a, const B& b) const {
+      return Derived::less(get(a), get(b));
+    }
+  };
 
-  struct inf_cmp {
-    bool operator()(Interval_handle_ const& a, Interval_handle_ const& b) const;
+  struct inf_cmp : handle_cmp<inf_cmp> {
+    using handle_cmp<inf_cmp>::handle_cmp;
+    static bool less(const Interval_& a, const Interval_& b);
   };
 
-  struct sup_cmp {
-    bool operator()(Interval_handle_ const& a, Interval_handle_ const& b) const;
+  struct sup_cmp : handle_cmp<sup_cmp> {
+    using handle_cmp<sup_cmp>::handle_cmp;
+    static bool less(const Interval_& a, const Interval_& b);
   };
 
-  typedef std::multiset<Interval_handle_, inf_cmp> lbound_index_t;
-  typedef std::multiset<Interval_handle_, sup_cmp> rbound_index_t;
+  typedef Flat_index<Interval_handle_> lbound_index_t; // ordered by inf_cmp
+  typedef Flat_index<Interval_handle_> rbound_index_t; // ordered by sup_cmp
 
   Value_ key;
   Priority_ priority;
@@ -42,50 +69,85 @@ class ICTnode {
   lbound_index_t lbound_idx;
   rbound_index_t rbound_idx;
 
-  template<class Idx1_t, class Idx2_t>
-  void move_idx_to(Idx1_t& idx1, Idx2_t& idx2, Self_ptr_ node);
+  template<class Idx1_t, class Idx2_t, class Cmp2_t>
+  void move_idx_to(Idx1_t& idx1, Idx2_t& idx2, const Cmp2_t& cmp2, Self_ptr_ node, Owner_& ict);
+
+  // the position of ih in idx ordered by cmp
+  template<class Idx_t, class Cmp_t>
+  static typename Idx_t::const_iterator find_handle(const Idx_t& idx, const Interval_handle_& ih, const Cmp_t& cmp);
 
-  template<class OutputIterator, class IdxType>
-  void collect_from_idx(const IdxType& idx, const Value_& value, OutputIterator out) const;
+  // calls visit on the handles of idx containing value until it returns false, returns whether it never did
+  template<class Visitor, class IdxType>
+  bool visit_idx(const IdxType& idx, const Value_& value, Visitor& visit, const Owner_& ict) const;
 
   friend class Interval_cartesian_tree<Interval_>;
   
 public:
   ICTnode(const Value_& key, const Priority_& priority);
-  ~ICTnode() = default;
 
-  void place_to_index(const Interval_handle_& ih);
-  bool place_if_matches(const Interval_handle_& ih);
-  bool delete_from_index(Interval_handle_& ih); // saves deleted value to argument
+  void place_to_index(const Interval_handle_& ih, Owner_& ict);
+  bool place_if_matches(const Interval_handle_& ih, Owner_& ict);
+  bool delete_from_index(const Interval_& i, Interval_handle_& ih, Owner_& ict); // saves handle of deleted interval
+  void delete_handle(const Interval_handle_& ih, Owner_& ict);
+  // the interval under ih, which the node holds, has delta more copies now
+  void add_copies(const Interval_handle_& ih, int delta, Owner_& ict);
   template<class OutputIterator>
-  void collect_by_lbound(const Value_& value, OutputIterator out) const;
+  void collect_by_lbound(const Value_& value, OutputIterator out, const Owner_& ict) const;
   template<class OutputIterator>
-  void collect_by_rbound(const Value_& value, OutputIterator out) const;
-  void move_lbound_idx_to(Self_ptr_ node);
-  void move_rbound_idx_to(Self_ptr_ node);
+  void collect_by_rbound(const Value_& value, OutputIterator out, const Owner_& ict) const;
+  template<class Visitor>
+  bool visit_by_lbound(const Value_& value, Visitor& visit, const Owner_& ict) const {
+    return visit_idx(lbound_idx, value, visit, ict);
+  }
+  template<class Visitor>
+  bool visit_by_rbound(const Value_& value, Visitor& visit, const Owner_& ict) const {
+    return visit_idx(rbound_idx, value, visit, ict);
+  }
+  void move_lbound_idx_to(Self_ptr_ node, Owner_& ict);
+  void move_rbound_idx_to(Self_ptr_ node, Owner_& ict);
 };
 
 template <class Interval_>
 class Interval_cartesian_tree {
+public:
+  typedef typename Interval_slab<Interval_>::Handle Interval_handle;
+
+private:
   typedef uint64_t Priority_;
   typedef typename Interval_::Value Value_;
-  typedef typename std::list<Interval_>::iterator Interval_handle_;
-  typedef typename std::list<Interval_>::const_iterator const_iterator;
+  typedef Interval_handle Interval_handle_;
+  typedef typename Interval_slab<Interval_>::const_iterator const_iterator;
   typedef ICTnode<Interval_> Node_;
   typedef Node_* Node_ptr_;
 
   Node_ptr_ root;
-  std::list<Interval_> container;
+  Interval_slab<Interval_> container;
+  std::vector<Node_ptr_> owners; // node whose index holds the interval, indexed by handle
   std::mt19937 gen;
   std::uniform_int_distribution<Priority_> priority_gen;
+  Node_arena arena; // nodes and their indexes
 
   static std::pair<Node_ptr_, Node_ptr_> split(Node_ptr_ node, const Value_& x);
   static Node_ptr_ merge(Node_ptr_ node1, Node_ptr_ node2);
 
   // first - parent, second - node
   std::pair<Node_ptr_, Node_ptr_> find_node(const Value_& x);
-  void place_to_matching(const Interval_handle_& ih);
-  bool delete_from_matching(const Interval_& i);
+  // the first node on the search path for the inf of the interval that matches it
+  Node_ptr_ matching(const Interval_handle_& ih) const;
+  void place_to_matching(const Interval_handle_& ih) {
+    matching(ih)->place_to_index(ih, *this);
+  }
+  // returns the handle the interval is stored under, that of an equal interval if there is one
+  Interval_handle_ insert_impl(const Interval_handle_& ih);
+  // takes the interval out of the index of its node unless it has more copies, saves its handle
+  bool delete_from_matching(const Interval_& i, Interval_handle_& ih);
+  // drops one owner of the node with given key and removes the node when no interval starts at it
+  void release_key(const Value_& key);
+  // builds the tree from scratch over intervals already in the container, the tree must be empty.
+  // Fresh handles equal to another interval become its copies
+  void bulk_build(std::vector<Interval_handle_>& handles, const std::vector<bool>& fresh);
+  Node_ptr_ create_node(const Value_& key);
+  void destroy_node(Node_ptr_ node);
   void delete_tree();
 
   friend class ICTnode<Interval_>;
@@ -94,19 +156,79 @@ public:
   Interval_cartesian_tree();
   template <class InputIterator>
   Interval_cartesian_tree(InputIterator b, InputIterator e);
+  Interval_cartesian_tree(const Interval_cartesian_tree&) = delete;
+  Interval_cartesian_tree& operator=(const Interval_cartesian_tree&) = delete;
   ~Interval_cartesian_tree();
 
   void seed(uint_fast64_t x0);
 
-  void insert(const Interval_& i);
+  // an interval equal to one in the tree is stored as its copy and gets its handle.
+  // The handle stays valid until all copies are removed
+  Interval_handle insert(const Interval_& i);
   template <class InputIterator>
   int insert(InputIterator b, InputIterator e);
 
   bool remove(const Interval_& I);
+  // removes a copy of the interval under ih
+  void remove(Interval_handle ih);
+  // whether an interval equal to I is in the tree, the same search as remove
+  bool contains(const Interval_& I) const {
+    Interval_handle ih;
+    return contains(I, ih);
+  }
+  // saves the handle of the interval found to ih
+  bool contains(const Interval_& I, Interval_handle& ih) const;
+  // the interval under a handle and its number of copies
+  const Interval_& interval(Interval_handle ih) const { return container[ih]; }
+  std::size_t copies(Interval_handle ih) const { return container.copies(ih); }
 
   bool is_contained(const Value_& value) const;
   template <class OutputIterator>
-  OutputIterator find_intervals(const Value_& value, OutputIterator out) const;
+  OutputIterator find_intervals(const Value_& value, OutputIterator out) const {
+    for_each_handle(value, [&](Interval_handle ih) { container.put(out, ih); return true; });
+    return out;
+  }
+  // calls visit(i) on each interval i containing value, once per copy, and stops as soon as visit
+  // returns false. Returns whether the query ran to the end. Nothing is copied, so a search for a
+  // first match costs about as much as is_contained
+  template <class Visitor>
+  bool for_each_interval(const Value_& value, Visitor&& visit) const {
+    return for_each_handle(value, [&](Interval_handle ih) {
+      for (uint32_t c = container.copies(ih); c > 0; --c) {
+        if (!visit(container[ih]))
+          return false;
+      }
+      return true;
+    });
+  }
+  // the same with the handles of the intervals, once for all copies of an interval
+  template <class Visitor>
+  bool for_each_handle(const Value_& value, Visitor&& visit) const;
+  // emits std::pair<Interval_, std::size_t> of each distinct interval and its number of copies
+  // instead of repeating the copies
+  template <class OutputIterator>
+  OutputIterator find_intervals_counted(const Value_& value, OutputIterator out) const {
+    Counted_output<OutputIterator> counted(out);
+    find_intervals(value, counted);
+    return out;
+  }
+  // queries must be sorted, emits std::pair<std::size_t, Interval_> of query index and interval
+  // in no particular order. Large batches take two sweeps over the nodes in O(n + q + k)
+  template <class RandomAccessIterator, class OutputIterator>
+  OutputIterator find_intervals_sorted(RandomAccessIterator qb, RandomAccessIterator qe, OutputIterator out) const;
+  // queries in any order, emits the same pairs as find_intervals_sorted. The descents are interleaved
+  // so that the cache misses of one are overlapped with the steps of the others
+  template <class RandomAccessIterator, class OutputIterator>
+  OutputIterator find_intervals_batch(RandomAccessIterator qb, RandomAccessIterator qe, OutputIterator out) const;
+  // reports once every interval sharing a point with the window from l to r with closedness lb, rb
+  template <class OutputIterator>
+  OutputIterator find_overlapping(const Value_& l, const Value_& r, bool lb, bool rb, OutputIterator out) const;
+
+  // counts take the length of index prefixes instead of visiting the intervals
+  std::size_t count_intervals(const Value_& value) const;
+  // takes a prefix of the index of every node with key in [l, r], but visits none of the intervals:
+  // O(log n + m * log k) for m such keys and indexes of at most k handles, linear in the keys of the window
+  std::size_t count_overlapping(const Value_& l, const Value_& r, bool lb, bool rb) const;
 
   void clear();
 
@@ -119,37 +241,41 @@ public:
   const_iterator end() const {
     return container.end();
   }
+
+  // immutable pointer-free copy for data that is no longer updated
+  Frozen_interval_index<Interval_> freeze() const {
+    return Frozen_interval_index<Interval_>(begin(), end());
+  }
 };
 
 template<class Interval_>
 bool
-ICTnode<Interval_>::inf_cmp::operator()(const ICTnode::Interval_handle_& a, const ICTnode::Interval_handle_& b) const {
-  if (a->inf() != b->inf())
-    return a->inf() < b->inf();
-  if (a->inf_closed() != b->inf_closed())
-    return a->inf_closed();
-  // sup comparison need only for deterministic search in std::set
-  // signs not actually matter
-  if (a->sup() != b->sup())
-    return a->sup() < b->sup();
-  if (a->sup_closed() != b->sup_closed())
-    return b->sup_closed();
+ICTnode<Interval_>::inf_cmp::less(const Interval_& a, const Interval_& b) {
+  if (a.inf() != b.inf())
+    return a.inf() < b.inf();
+  if (a.inf_closed() != b.inf_closed())
+    return a.inf_closed();
+  // wider intervals go first: among intervals with equal inf
+  // the empty ones must not cut off the prefix of intervals containing inf
+  if (a.sup() != b.sup())
+    return a.sup() > b.sup();
+  if (a.sup_closed() != b.sup_closed())
+    return a.sup_closed();
   return false;
 }
 
 template<class Interval_>
 bool
-ICTnode<Interval_>::sup_cmp::operator()(const ICTnode::Interval_handle_& a, const ICTnode::Interval_handle_& b) const {
-  if (a->sup() != b->sup())
-    return a->sup() > b->sup();
-  if (a->sup_closed() != b->sup_closed())
-    return a->sup_closed();
-  // inf comparison need only for deterministic search in std::set
-  // signs not actually matter
-  if (a->inf() != b->inf())
-    return a->inf() > b->inf();
-  if (a->inf_closed() != b->inf_closed())
-    return b->inf_closed();
+ICTnode<Interval_>::sup_cmp::less(const Interval_& a, const Interval_& b) {
+  if (a.sup() != b.sup())
+    return a.sup() > b.sup();
+  if (a.sup_closed() != b.sup_closed())
+    return a.sup_closed();
+  // wider intervals go first, same as in inf_cmp
+  if (a.inf() != b.inf())
+    return a.inf() < b.inf();
+  if (a.inf_closed() != b.inf_closed())
+    return a.inf_closed();
   return false;
 }
 
@@ -163,82 +289,133 @@ ICTnode<Interval_>::ICTnode(const Value_& key, const ICTnode::Priority_& priorit
 , right(nullptr)
 {}
 
+// moved handles form a prefix of idx1, so it is erased at once
 template<class Interval_>
-template<class Idx1_t, class Idx2_t>
-void ICTnode<Interval_>::move_idx_to(Idx1_t& idx1, Idx2_t& idx2, ICTnode::Self_ptr_ node) {
-  while (!idx1.empty() && (*idx1.begin())->contains_or_inf(node->key)) {
-    node->place_to_index(*idx1.begin());
-    auto it = idx2.find(*idx1.begin());
-    assert(it != idx2.end());
-    assert(*it == *idx1.begin());
-    idx2.erase(it);
-    idx1.erase(idx1.begin());
+template<class Idx1_t, class Idx2_t, class Cmp2_t>
+void ICTnode<Interval_>::move_idx_to(Idx1_t& idx1, Idx2_t& idx2, const Cmp2_t& cmp2, ICTnode::Self_ptr_ node,
+                                     Owner_& ict) {
+  auto it = idx1.begin();
+  auto const end = idx1.end();
+  while (it != end && ict.container[*it].contains_or_inf(node->key)) {
+    node->place_to_index(*it, ict);
+    auto it2 = idx2.find(*it, cmp2);
+    assert(it2 != idx2.end());
+    assert(*it2 == *it);
+    idx2.erase(it2, ict.arena, ict.container.copy_weight());
+    ++it;
   }
+  idx1.erase(idx1.begin(), it, ict.arena, ict.container.copy_weight());
 }
 
 template<class Interval_>
-template<class OutputIterator, class IdxType>
-void ICTnode<Interval_>::collect_from_idx(const IdxType& idx, const Value_& value, OutputIterator out) const {
-  auto it = idx.begin();
-  auto const& end = idx.end();
-  while (it != end && (*it)->contains(value)) {
-    out = **it;
-    ++out;
-    ++it;
-  }
+template<class Visitor, class IdxType>
+bool ICTnode<Interval_>::visit_idx(const IdxType& idx, const Value_& value, Visitor& visit,
+                                   const Owner_& ict) const {
+  // containment is tested over chunks of the index runs at once, a visitor stopping at the first
+  // interval does not pay for the rest of the run
+  const std::ptrdiff_t chunk = 8;
+  bool completed = true;
+  idx.for_each_run([&](const Interval_handle_* first, const Interval_handle_* last) {
+    while (first != last) {
+      const Interval_handle_* end = last - first > chunk ? first + chunk : last;
+      const Interval_handle_* stop = first + ict.container.contains_prefix(first, end, value);
+      for (; first != stop; ++first) {
+        if (!visit(*first)) {
+          completed = false;
+          return false;
+        }
+      }
+      if (stop != end)
+        return false;
+    }
+    return true;
+  });
+  return completed;
 }
 
 template<class Interval_>
-void ICTnode<Interval_>::place_to_index(const ICTnode::Interval_handle_& ih) {
-  lbound_idx.insert(ih);
-  rbound_idx.insert(ih);
+void ICTnode<Interval_>::place_to_index(const ICTnode::Interval_handle_& ih, Owner_& ict) {
+  lbound_idx.insert(ih, inf_cmp(ict.container), ict.arena, ict.container.copy_weight());
+  rbound_idx.insert(ih, sup_cmp(ict.container), ict.arena, ict.container.copy_weight());
+  ict.owners[ih] = this;
 }
 
 template<class Interval_>
-bool ICTnode<Interval_>::place_if_matches(const ICTnode::Interval_handle_& ih) {
-  if (ih->contains_or_inf(key)) {
-    place_to_index(ih);
+bool ICTnode<Interval_>::place_if_matches(const ICTnode::Interval_handle_& ih, Owner_& ict) {
+  if (ict.container[ih].contains_or_inf(key)) {
+    place_to_index(ih, ict);
     return true;
   }
   return false;
 }
 
-// saves deleted value to argument
+// saves handle of deleted interval to argument
 template<class Interval_>
-bool ICTnode<Interval_>::delete_from_index(ICTnode::Interval_handle_& ih) {
-  auto it = lbound_idx.find(ih);
+bool ICTnode<Interval_>::delete_from_index(const Interval_& i, ICTnode::Interval_handle_& ih, Owner_& ict) {
+  auto it = lbound_idx.find(i, inf_cmp(ict.container));
   if (it != lbound_idx.end()) {
-    auto it2 = rbound_idx.find(ih);
+    auto it2 = rbound_idx.find(i, sup_cmp(ict.container));
     assert(it2 != rbound_idx.end());
     assert(*it == *it2);
     ih = *it;
-    lbound_idx.erase(it);
-    rbound_idx.erase(it2);
+    if (ict.container.copies(ih) > 1) {
+      // the caller drops a copy, the interval stays
+      return true;
+    }
+    lbound_idx.erase(it, ict.arena, ict.container.copy_weight());
+    rbound_idx.erase(it2, ict.arena, ict.container.copy_weight());
     return true;
   }
   return false;
 }
 
+// intervals equal to the one under ih may precede it in the index
+template<class Interval_>
+template<class Idx_t, class Cmp_t>
+typename Idx_t::const_iterator
+ICTnode<Interval_>::find_handle(const Idx_t& idx, const Interval_handle_& ih, const Cmp_t& cmp) {
+  auto it = idx.lower_bound(ih, cmp);
+  while (*it != ih) {
+    ++it;
+    assert(it != idx.end());
+  }
+  return it;
+}
+
+template<class Interval_>
+void ICTnode<Interval_>::delete_handle(const ICTnode::Interval_handle_& ih, Owner_& ict) {
+  lbound_idx.erase(find_handle(lbound_idx, ih, inf_cmp(ict.container)), ict.arena, ict.container.copy_weight());
+  rbound_idx.erase(find_handle(rbound_idx, ih, sup_cmp(ict.container)), ict.arena, ict.container.copy_weight());
+}
+
+template<class Interval_>
+void ICTnode<Interval_>::add_copies(const Interval_handle_& ih, int delta, Owner_& ict) {
+  lbound_idx.add_weight(find_handle(lbound_idx, ih, inf_cmp(ict.container)), delta);
+  rbound_idx.add_weight(find_handle(rbound_idx, ih, sup_cmp(ict.container)), delta);
+}
+
 template<class Interval_>
 template<class OutputIterator>
-void ICTnode<Interval_>::collect_by_lbound(const Value_& value, OutputIterator out) const {
-  collect_from_idx(lbound_idx, value, out);
+void ICTnode<Interval_>::collect_by_lbound(const Value_& value, OutputIterator out, const Owner_& ict) const {
+  auto put = [&](Interval_handle_ ih) { ict.container.put(out, ih); return true; };
+  visit_idx(lbound_idx, value, put, ict);
 }
 
 template<class Interval_>
 template<class OutputIterator>
-void ICTnode<Interval_>::collect_by_rbound(const Value_& value, OutputIterator out) const {
-  collect_from_idx(rbound_idx, value, out);
+void ICTnode<Interval_>::collect_by_rbound(const Value_& value, OutputIterator out, const Owner_& ict) const {
+  auto put = [&](Interval_handle_ ih) { ict.container.put(out, ih); return true; };
+  visit_idx(rbound_idx, value, put, ict);
 }
 
 template<class Interval_>
-void ICTnode<Interval_>::move_lbound_idx_to(ICTnode::Self_ptr_ node) {
-  move_idx_to(lbound_idx, rbound_idx, node);
+void ICTnode<Interval_>::move_lbound_idx_to(ICTnode::Self_ptr_ node, Owner_& ict) {
+  move_idx_to(lbound_idx, rbound_idx, sup_cmp(ict.container), node, ict);
 }
 
 template<class Interval_>
-void ICTnode<Interval_>::move_rbound_idx_to(ICTnode::Self_ptr_ node) {
-  move_idx_to(rbound_idx, lbound_idx, node);
+void ICTnode<Interval_>::move_rbound_idx_to(ICTnode::Self_ptr_ node, Owner_& ict) {
+  move_idx_to(rbound_idx, lbound_idx, inf_cmp(ict.container), node, ict);
 }
 
 template<class Interval_>
@@ -276,21 +453,37 @@ Interval_cartesian_tree<Interval_>::merge(Node_ptr_ node1, Node_ptr_ node2) {
   }
 }
 
+template<class Interval_>
+typename Interval_cartesian_tree<Interval_>::Node_ptr_
+Interval_cartesian_tree<Interval_>::create_node(const Value_& key) {
+  return new (arena.allocate(sizeof(Node_))) Node_(key, priority_gen(gen));
+}
+
+template<class Interval_>
+void Interval_cartesian_tree<Interval_>::destroy_node(Node_ptr_ node) {
+  node->lbound_idx.clear(arena);
+  node->rbound_idx.clear(arena);
+  node->~Node_();
+  arena.deallocate(node, sizeof(Node_));
+}
+
+// nodes are visited only if their destructors do anything,
+// the memory is returned by the arena at once
 template<class Interval_>
 void Interval_cartesian_tree<Interval_>::delete_tree() {
-  if (!root)
-    return;
-  std::queue<Node_ptr_> q;
-  q.push(root);
-  while (!q.empty()) {
-    Node_ptr_ node = q.front();
-    q.pop();
-    if (node->left)
-      q.push(node->left);
-    if (node->right)
-      q.push(node->right);
-    delete node;
+  if (!std::is_trivially_destructible<Node_>::value && root) {
+    std::vector<Node_ptr_> stack(1, root);
+    while (!stack.empty()) {
+      Node_ptr_ node = stack.back();
+      stack.pop_back();
+      if (node->left)
+        stack.push_back(node->left);
+      if (node->right)
+        stack.push_back(node->right);
+      node->~Node_();
+    }
   }
+  arena.release();
   root = nullptr;
 }
 
@@ -305,33 +498,28 @@ Interval_cartesian_tree<Interval_>::find_node(const Value_& x) {
       break;
     }
     p = v;
-    v = v->key < x ? v->left : v->right;
+    v = x < v->key ? v->left : v->right;
   }
   return std::make_pair(p, v);
 }
 
 
 template<class Interval_>
-void Interval_cartesian_tree<Interval_>::place_to_matching(const Interval_cartesian_tree::Interval_handle_& ih) {
+typename Interval_cartesian_tree<Interval_>::Node_ptr_
+Interval_cartesian_tree<Interval_>::matching(const Interval_cartesian_tree::Interval_handle_& ih) const {
   Node_ptr_ v = root;
-  const Value_& inf = ih->inf();
-  while (true) {
-    if (v->place_if_matches(ih)) {
-      return;
-    }
-    v = v->key < inf ? v->right : v->left;
+  const Interval_& interval = container[ih];
+  while (!interval.contains_or_inf(v->key)) {
+    v = v->key < interval.inf() ? v->right : v->left;
   }
+  return v;
 }
 
 template<class Interval_>
-bool Interval_cartesian_tree<Interval_>::delete_from_matching(const Interval_& i) {
-  std::list<Interval_> tmp;
-  tmp.push_front(i);
-  Interval_handle_ ih = tmp.begin();
+bool Interval_cartesian_tree<Interval_>::delete_from_matching(const Interval_& i, Interval_handle_& ih) {
   Node_ptr_ v = root;
   while (v) {
-    if (v->delete_from_index(ih)) {
-      container.erase(ih);
+    if (v->delete_from_index(i, ih, *this)) {
       return true;
     }
     v = v->key < i.inf() ? v->right : v->left;
@@ -352,10 +540,7 @@ template<class InputIterator>
 Interval_cartesian_tree<Interval_>::Interval_cartesian_tree(InputIterator b, InputIterator e)
 : Interval_cartesian_tree()
 {
-  while (b != e) {
-    insert(*b);
-    ++b;
-  }
+  insert(b, e);
 }
 
 template<class Interval_>
@@ -377,30 +562,152 @@ template<class Interval_>
 void Interval_cartesian_tree<Interval_>::clear() {
   delete_tree();
   container.clear();
+  owners.clear();
 }
 
+// batches at least as large as the tree rebuild it, as in Interval_skip_list
 template<class Interval_>
 template<class InputIterator>
 int Interval_cartesian_tree<Interval_>::insert(InputIterator b, InputIterator e) {
-  int n = 0;
-  for(; b != e; ++b) {
-    insert(*b);
-    ++n;
+  std::size_t old_size = container.size();
+  std::vector<Interval_handle_> handles;
+  for (; b != e; ++b) {
+    handles.push_back(container.insert(*b));
+    if (handles.back() >= owners.size()) {
+      owners.resize(handles.back() + 1);
+    }
+  }
+  int inserted = static_cast<int>(handles.size());
+  if (handles.size() < old_size) {
+    // in order of inf consecutive descents share their upper nodes in the cache
+    std::stable_sort(handles.begin(), handles.end(), [&](Interval_handle_ a, Interval_handle_ b) {
+      return container[a].inf() < container[b].inf();
+    });
+    for (auto const& ih : handles) {
+      insert_impl(ih);
+    }
+    return inserted;
+  }
+  std::vector<bool> fresh(owners.size(), old_size == 0);
+  if (old_size > 0) {
+    for (auto const& ih : handles) {
+      fresh[ih] = true;
+    }
+    delete_tree();
+    handles.clear();
+    for (auto it = container.begin(); it != container.end(); ++it) {
+      if (handles.empty() || handles.back() != it.handle()) {
+        handles.push_back(it.handle());
+      }
+    }
   }
-  return n;
+  bulk_build(handles, fresh);
+  return inserted;
 }
 
 template<class Interval_>
-void Interval_cartesian_tree<Interval_>::insert(const Interval_& i) {
-  container.push_front(i);
-  Interval_handle_ ih = container.begin();
+void Interval_cartesian_tree<Interval_>::bulk_build(std::vector<Interval_handle_>& handles, const std::vector<bool>& fresh) {
+  assert(root == nullptr);
+  typename Node_::inf_cmp inf_less(container);
+  parallel_sort(handles.begin(), handles.end(), inf_less);
+  container.collapse_equal(handles, inf_less, [&](Interval_handle_ ih) { return fresh[ih]; });
+
+  // nodes for distinct infs come in key order, so the treap is built in linear time
+  // keeping its right spine on a stack. The arena is not shared between threads,
+  // so this pass stays sequential
+  std::vector<Node_ptr_> spine;
+  for (std::size_t i = 0; i < handles.size(); ) {
+    const Value_& key = container[handles[i]].inf();
+    Node_ptr_ node = create_node(key);
+    node->ownerCount = 0;
+    for (; i < handles.size() && container[handles[i]].inf() == key; ++i) {
+      ++node->ownerCount;
+    }
+    Node_ptr_ last = nullptr;
+    while (!spine.empty() && spine.back()->priority < node->priority) {
+      last = spine.back();
+      spine.pop_back();
+    }
+    node->left = last;
+    if (!spine.empty()) {
+      spine.back()->right = node;
+    }
+    spine.push_back(node);
+  }
+  root = spine.empty() ? nullptr : spine.front();
+
+  // the first node on the search path for inf that matches the interval, as in place_to_matching
+  const std::size_t block = 4096;
+  parallel_for((handles.size() + block - 1) / block, [&](std::size_t b) {
+    for (std::size_t k = b * block; k < std::min(handles.size(), (b + 1) * block); ++k) {
+      Interval_handle_ ih = handles[k];
+      const Interval_& interval = container[ih];
+      Node_ptr_ v = root;
+      while (!interval.contains_or_inf(v->key)) {
+        v = v->key < interval.inf() ? v->right : v->left;
+      }
+      owners[ih] = v;
+    }
+  });
+
+  // handles of one node form a run sorted as in lbound index
+  parallel_sort(handles.begin(), handles.end(), [&](Interval_handle_ a, Interval_handle_ b) {
+    if (owners[a] != owners[b]) {
+      return std::less<Node_ptr_>()(owners[a], owners[b]);
+    }
+    return inf_less(a, b);
+  });
+  std::vector<std::size_t> runs(1, 0);
+  for (std::size_t i = 1; i <= handles.size(); ++i) {
+    if (i == handles.size() || owners[handles[i]] != owners[handles[i - 1]]) {
+      runs.push_back(i);
+    }
+  }
+  // equal intervals must keep the same relative order in both indexes
+  std::vector<Interval_handle_> by_sup(handles);
+  parallel_for(runs.size() - 1, [&](std::size_t r) {
+    std::stable_sort(by_sup.begin() + runs[r], by_sup.begin() + runs[r + 1], typename Node_::sup_cmp(container));
+  });
+  for (std::size_t r = 0; r + 1 < runs.size(); ++r) {
+    Node_ptr_ node = owners[handles[runs[r]]];
+    node->lbound_idx.assign_sorted(handles.data() + runs[r], handles.data() + runs[r + 1], arena,
+                                   container.copy_weight());
+    node->rbound_idx.assign_sorted(by_sup.data() + runs[r], by_sup.data() + runs[r + 1], arena,
+                                   container.copy_weight());
+  }
+}
+
+template<class Interval_>
+typename Interval_cartesian_tree<Interval_>::Interval_handle
+Interval_cartesian_tree<Interval_>::insert(const Interval_& i) {
+  Interval_handle_ ih = container.insert(i);
+  if (ih >= owners.size()) {
+    owners.resize(ih + 1);
+  }
+  return insert_impl(ih);
+}
+
+template<class Interval_>
+typename Interval_cartesian_tree<Interval_>::Interval_handle_
+Interval_cartesian_tree<Interval_>::insert_impl(const Interval_handle_& ih) {
+  const Interval_& i = container[ih];
   std::pair<Node_ptr_, Node_ptr_> found = find_node(i.inf());
   if (found.second) {
+    // an equal interval is at the same node, then the interval becomes its copy
+    Node_ptr_ w = matching(ih);
+    auto it = w->lbound_idx.find(ih, typename Node_::inf_cmp(container));
+    if (it != w->lbound_idx.end()) {
+      Interval_handle_ equal = *it;
+      container.erase(ih);
+      container.add_copy(equal);
+      w->add_copies(equal, 1, *this);
+      return equal;
+    }
     found.second->ownerCount++;
-    place_to_matching(ih);
-    return;
+    w->place_to_index(ih, *this);
+    return ih;
   }
-  auto* node = new Node_(i.inf(), priority_gen(gen));
+  auto* node = create_node(i.inf());
   Node_ptr_ v = root;
   Node_ptr_* child_ptr = &root;
   while (v && v->priority > node->priority) {
@@ -412,43 +719,81 @@ void Interval_cartesian_tree<Interval_>::insert(const Interval_& i) {
   node->left = spl.first;
   node->right = spl.second;
   for (Node_ptr_ u = node->left; u; u = u->right) {
-    u->move_rbound_idx_to(node);
+    u->move_rbound_idx_to(node, *this);
   }
   for (Node_ptr_ u = node->right; u; u = u->left) {
-    u->move_lbound_idx_to(node);
+    u->move_lbound_idx_to(node, *this);
   }
   place_to_matching(ih);
+  return ih;
 }
 
 template<class Interval_>
 bool Interval_cartesian_tree<Interval_>::remove(const Interval_& I) {
-  if (!delete_from_matching(I)) {
+  Interval_handle_ ih;
+  if (!delete_from_matching(I, ih)) {
     return false;
   }
+  if (container.drop_copy(ih)) {
+    owners[ih]->add_copies(ih, -1, *this);
+    return true;
+  }
+  release_key(I.inf());
+  container.erase(ih);
+  return true;
+}
+
+template<class Interval_>
+bool Interval_cartesian_tree<Interval_>::contains(const Interval_& I, Interval_handle& ih) const {
+  typename Node_::inf_cmp inf_less(container);
+  for (Node_ptr_ v = root; v; v = v->key < I.inf() ? v->right : v->left) {
+    auto it = v->lbound_idx.find(I, inf_less);
+    if (it != v->lbound_idx.end()) {
+      ih = *it;
+      return true;
+    }
+  }
+  return false;
+}
+
+template<class Interval_>
+void Interval_cartesian_tree<Interval_>::remove(Interval_handle ih) {
+  assert(container.is_alive(ih));
+  if (container.drop_copy(ih)) {
+    owners[ih]->add_copies(ih, -1, *this);
+    return;
+  }
+  owners[ih]->delete_handle(ih, *this);
+  release_key(container[ih].inf());
+  container.erase(ih);
+}
+
+template<class Interval_>
+void Interval_cartesian_tree<Interval_>::release_key(const Value_& key) {
   Node_ptr_ v = root;
   Node_ptr_* child_ptr = &root;
-  while (v && v->key != I.inf()) {
-    child_ptr = I.inf() < v->key ? &v->left : &v->right;
+  while (v && v->key != key) {
+    child_ptr = key < v->key ? &v->left : &v->right;
     v = *child_ptr;
   }
   assert(v);
   if (--v->ownerCount) {
-    return true;
+    return;
   }
   Node_ptr_ u = v->left;
   Node_ptr_ w = v->right;
   while (u || w) {
     if (!u || w && w->priority > u->priority) {
-      v->move_rbound_idx_to(w);
+      v->move_rbound_idx_to(w, *this);
       w = w->left;
     } else {
-      v->move_lbound_idx_to(u);
+      v->move_lbound_idx_to(u, *this);
       u = u->right;
     }
   }
   *child_ptr = merge(v->left, v->right);
-  delete v;
-  return true;
+  assert(v->lbound_idx.empty() && v->rbound_idx.empty());
+  destroy_node(v);
 }
 
 template<class Interval_>
@@ -456,12 +801,12 @@ bool Interval_cartesian_tree<Interval_>::is_contained(const Value_& value) const
   Node_ptr_ v = root;
   while (v) {
     if (value > v->key) {
-      if (!v->rbound_idx.empty() && (*v->rbound_idx.begin())->contains(value)) {
+      if (!v->rbound_idx.empty() && container[v->rbound_idx.front()].contains(value)) {
         return true;
       }
       v = v->right;
     } else {
-      if (!v->lbound_idx.empty() && (*v->lbound_idx.begin())->contains(value)) {
+      if (!v->lbound_idx.empty() && container[v->lbound_idx.front()].contains(value)) {
         return true;
       }
       if (v->key == value) {
@@ -474,23 +819,269 @@ bool Interval_cartesian_tree<Interval_>::is_contained(const Value_& value) const
 }
 
 template<class Interval_>
-template<class OutputIterator>
-OutputIterator Interval_cartesian_tree<Interval_>::find_intervals(const Value_& value, OutputIterator out) const {
+template<class Visitor>
+bool Interval_cartesian_tree<Interval_>::for_each_handle(const Value_& value, Visitor&& visit) const {
   Node_ptr_ v = root;
   while (v) {
     if (value > v->key) {
-      v->collect_by_rbound(value, out);
+      if (!v->visit_by_rbound(value, visit, *this)) {
+        return false;
+      }
       v = v->right;
     } else {
-      v->collect_by_lbound(value, out);
+      if (!v->visit_by_lbound(value, visit, *this)) {
+        return false;
+      }
       if (v->key == value) {
         break;
       }
       v = v->left;
     }
   }
+  return true;
+}
+
+template<class Interval_>
+template<class RandomAccessIterator, class OutputIterator>
+OutputIterator Interval_cartesian_tree<Interval_>::find_intervals_sorted(RandomAccessIterator qb, RandomAccessIterator qe, OutputIterator out) const {
+  assert(std::is_sorted(qb, qe));
+  const std::size_t q = qe - qb;
+  std::size_t depth = 1;
+  for (std::size_t n = container.size(); n > 1; n >>= 1)
+    depth += 2;
+  if (q * depth < container.size()) {
+    std::vector<Interval_> found;
+    for (std::size_t j = 0; j < q; ++j) {
+      found.clear();
+      find_intervals(qb[j], std::back_inserter(found));
+      for (const Interval_& i : found) {
+        out = std::make_pair(j, i);
+        ++out;
+      }
+    }
+    return out;
+  }
+
+  // same sweeps as in Interval_skip_list: for a node left of the query point
+  // the containing intervals form a prefix of rbound index, for a node right of it or at it
+  // they form a prefix of lbound index. A node whose first interval misses the point
+  // misses all the following points of the sweep and is dropped
+  std::vector<const Node_*> nodes;
+  std::vector<const Node_*> stack;
+  for (const Node_* v = root; v || !stack.empty();) {
+    if (v) {
+      stack.push_back(v);
+      v = v->left;
+      continue;
+    }
+    v = stack.back();
+    stack.pop_back();
+    if (!v->lbound_idx.empty())
+      nodes.push_back(v);
+    v = v->right;
+  }
+  std::vector<const Node_*> active;
+  std::size_t next = 0;
+  for (std::size_t j = 0; j < q; ++j) {
+    const Value_& value = qb[j];
+    while (next < nodes.size() && nodes[next]->key < value)
+      active.push_back(nodes[next++]);
+    std::size_t kept = 0;
+    for (std::size_t a = 0; a < active.size(); ++a) {
+      const Node_* v = active[a];
+      auto it = v->rbound_idx.begin();
+      if (!container[*it].contains(value))
+        continue;
+      active[kept++] = v;
+      Tagged_output<OutputIterator> tagged(out, j);
+      for (; it != v->rbound_idx.end() && container[*it].contains(value); ++it) {
+        container.put(tagged, *it);
+      }
+    }
+    active.resize(kept);
+  }
+
+  active.clear();
+  next = nodes.size();
+  for (std::size_t j = q; j-- > 0;) {
+    const Value_& value = qb[j];
+    while (next > 0 && !(nodes[next - 1]->key < value))
+      active.push_back(nodes[--next]);
+    std::size_t kept = 0;
+    for (std::size_t a = 0; a < active.size(); ++a) {
+      const Node_* v = active[a];
+      auto it = v->lbound_idx.begin();
+      if (!container[*it].contains(value))
+        continue;
+      active[kept++] = v;
+      Tagged_output<OutputIterator> tagged(out, j);
+      for (; it != v->lbound_idx.end() && container[*it].contains(value); ++it) {
+        container.put(tagged, *it);
+      }
+    }
+    active.resize(kept);
+  }
+  return out;
+}
+
+
+template<class Interval_>
+template<class RandomAccessIterator, class OutputIterator>
+OutputIterator Interval_cartesian_tree<Interval_>::find_intervals_batch(RandomAccessIterator qb, RandomAccessIterator qe, OutputIterator out) const {
+  // a descent alternates two steps: one reads the node prefetched before and prefetches the first
+  // interval of the index it collects from, the other collects and prefetches the child
+  struct Descent {
+    std::size_t j;
+    Node_ptr_ v;
+    bool at_node;
+  };
+  run_interleaved<Descent>(qe - qb,
+    [&](Descent& d, std::size_t j) {
+      d = Descent{j, root, false};
+      __builtin_prefetch(root);
+    },
+    [&](Descent& d) {
+      const Value_& value = qb[d.j];
+      if (!d.v)
+        return false;
+      if (!d.at_node) {
+        const auto& idx = value > d.v->key ? d.v->rbound_idx : d.v->lbound_idx;
+        if (!idx.empty())
+          __builtin_prefetch(&container[idx.front()]);
+        d.at_node = true;
+        return true;
+      }
+      if (value > d.v->key) {
+        d.v->collect_by_rbound(value, Tagged_output<OutputIterator>(out, d.j), *this);
+        d.v = d.v->right;
+      } else {
+        d.v->collect_by_lbound(value, Tagged_output<OutputIterator>(out, d.j), *this);
+        if (d.v->key == value)
+          return false;
+        d.v = d.v->left;
+      }
+      __builtin_prefetch(d.v);
+      d.at_node = false;
+      return d.v != nullptr;
+    });
+  return out;
+}
+
+template<class Interval_>
+template<class OutputIterator>
+OutputIterator Interval_cartesian_tree<Interval_>::find_overlapping(const Value_& l, const Value_& r, bool lb, bool rb, OutputIterator out) const {
+  assert(!(r < l));
+  // every interval is stored at the node of highest priority among the keys it contains.
+  // A node left of l holding an overlapping interval is an ancestor of l,
+  // its overlapping intervals form a prefix of rbound index
+  for (Node_ptr_ v = root; v && !(l == v->key);) {
+    if (v->key < l) {
+      for (auto it = v->rbound_idx.begin(); it != v->rbound_idx.end() && container[*it].overlaps(l, r, lb, rb); ++it) {
+        container.put(out, *it);
+      }
+      v = v->right;
+    } else {
+      v = v->left;
+    }
+  }
+  // each node in [l, r] owns an interval starting in the window, so visiting them is paid by the output
+  std::vector<const Node_*> stack;
+  if (root)
+    stack.push_back(root);
+  while (!stack.empty()) {
+    const Node_* v = stack.back();
+    stack.pop_back();
+    if (!(v->key < l) && !(r < v->key)) {
+      for (Interval_handle_ ih : v->lbound_idx) {
+        if (container[ih].overlaps(l, r, lb, rb)) {
+          container.put(out, ih);
+        }
+      }
+    }
+    if (l < v->key && v->left)
+      stack.push_back(v->left);
+    if (v->key < r && v->right)
+      stack.push_back(v->right);
+  }
+  // a node right of r holding an overlapping interval is an ancestor of r,
+  // its overlapping intervals form a prefix of lbound index
+  for (Node_ptr_ v = root; v && !(r == v->key);) {
+    if (r < v->key) {
+      for (auto it = v->lbound_idx.begin(); it != v->lbound_idx.end() && container[*it].overlaps(l, r, lb, rb); ++it) {
+        container.put(out, *it);
+      }
+      v = v->left;
+    } else {
+      v = v->right;
+    }
+  }
   return out;
 }
 
 
+template<class Interval_>
+std::size_t Interval_cartesian_tree<Interval_>::count_intervals(const Value_& value) const {
+  auto contains = [&](Interval_handle_ ih) { return container[ih].contains(value); };
+  std::size_t count = 0;
+  Node_ptr_ v = root;
+  while (v) {
+    if (value > v->key) {
+      count += container.count_prefix(v->rbound_idx, contains);
+      v = v->right;
+    } else {
+      count += container.count_prefix(v->lbound_idx, contains);
+      if (v->key == value) {
+        break;
+      }
+      v = v->left;
+    }
+  }
+  return count;
+}
+
+template<class Interval_>
+std::size_t Interval_cartesian_tree<Interval_>::count_overlapping(const Value_& l, const Value_& r, bool lb, bool rb) const {
+  assert(!(r < l));
+  auto overlaps = [&](Interval_handle_ ih) { return container[ih].overlaps(l, r, lb, rb); };
+  std::size_t count = 0;
+  // same split of the nodes as in find_overlapping
+  for (Node_ptr_ v = root; v && !(l == v->key);) {
+    if (v->key < l) {
+      count += container.count_prefix(v->rbound_idx, overlaps);
+      v = v->right;
+    } else {
+      v = v->left;
+    }
+  }
+  // left of r the overlapping intervals are a prefix of rbound index, at r of lbound index:
+  // with equal inf the empty intervals would cut lbound prefix, with equal sup they come last anyway
+  std::vector<const Node_*> stack;
+  if (root)
+    stack.push_back(root);
+  while (!stack.empty()) {
+    const Node_* v = stack.back();
+    stack.pop_back();
+    if (!(v->key < l) && !(r < v->key)) {
+      if (v->key < r)
+        count += container.count_prefix(v->rbound_idx, overlaps);
+      else
+        count += container.count_prefix(v->lbound_idx, overlaps);
+    }
+    if (l < v->key && v->left)
+      stack.push_back(v->left);
+    if (v->key < r && v->right)
+      stack.push_back(v->right);
+  }
+  for (Node_ptr_ v = root; v && !(r == v->key);) {
+    if (r < v->key) {
+      count += container.count_prefix(v->lbound_idx, overlaps);
+      v = v->left;
+    } else {
+      v = v->right;
+    }
+  }
+  return count;
+}
+
+
 #endif //INTERVAL_CARTESIAN_TREE_H
@@ -0,0 +1,341 @@
+#ifndef INTERVAL_LOG_H
+#define INTERVAL_LOG_H
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Index_file.h"
+
+#ifndef ISL_LOG_GROUP_BYTES
+#define ISL_LOG_GROUP_BYTES (1 << 20) // pending log records are written out as a frame at this size
+#endif
+
+// Files of the operation log of an interval index, in the byte order of the writer.
+// A record is a tag byte, bit 0 set for an insert and bits 1 and 2 for the closedness of inf and sup,
+// followed by the bytes of inf and sup.
+// The log is a header and a sequence of frames, each a Log_frame_header and the records
+// of one group commit. A crash can leave a torn frame at the end, replay stops before it.
+// A checkpoint is a header and the records of all intervals of the index, tagged as inserts.
+// Both carry the generation of the checkpoint, a log continues the checkpoint of its generation
+// and a log of an older generation is already contained in the checkpoint.
+struct Log_file_header {
+  static const uint32_t current_version = 1;
+
+  char magic[8];
+  uint32_t version;
+  uint32_t value_size;
+  uint64_t generation;
+  uint64_t record_count;    // checkpoints only
+  uint64_t records_checksum; // checkpoints only, chunks of log_checkpoint_chunk records
+  uint64_t header_checksum;
+};
+
+struct Log_frame_header {
+  uint32_t payload_bytes;
+  uint32_t record_count;
+  uint64_t checksum; // over the payload
+};
+
+static const char log_file_magic[8] = {'I', 'S', 'L', 'L', 'O', 'G', '\0', '\0'};
+static const char checkpoint_file_magic[8] = {'I', 'S', 'L', 'C', 'K', 'P', 'T', '\0'};
+static const std::size_t log_checkpoint_chunk = 4096;
+
+inline uint64_t log_header_checksum(const Log_file_header& h)
+{
+  return index_checksum(&h, offsetof(Log_file_header, header_checksum));
+}
+
+template <class Interval>
+struct Log_record {
+  typedef typename Interval::Value Value;
+  static_assert(std::is_trivially_copyable<Value>::value, "records hold the bytes of the bounds");
+  static const std::size_t size = 1 + 2 * sizeof(Value);
+
+  static char* encode(char* p, bool insert, const Interval& i) {
+    *p++ = static_cast<char>((insert ? 1 : 0) | (i.inf_closed() ? 2 : 0) | (i.sup_closed() ? 4 : 0));
+    std::memcpy(p, &i.inf(), sizeof(Value));
+    std::memcpy(p + sizeof(Value), &i.sup(), sizeof(Value));
+    return p + 2 * sizeof(Value);
+  }
+  // advances p past the record
+  static Interval decode(const char*& p, bool& insert) {
+    unsigned char tag = static_cast<unsigned char>(*p++);
+    Value inf, sup;
+    std::memcpy(&inf, p, sizeof(Value));
+    std::memcpy(&sup, p + sizeof(Value), sizeof(Value));
+    p += 2 * sizeof(Value);
+    insert = tag & 1;
+    return Interval(inf, sup, (tag & 2) != 0, (tag & 4) != 0);
+  }
+};
+
+// reads whole files with buffered sequential reads
+class Log_reader
+{
+  std::FILE* file;
+  std::string path;
+
+public:
+  explicit Log_reader(const std::string& path)
+  : file(std::fopen(path.c_str(), "rb")), path(path)
+  {
+    if (!file)
+      throw std::runtime_error(path + ": " + std::strerror(errno));
+    std::setvbuf(file, nullptr, _IOFBF, 1 << 20);
+  }
+  Log_reader(const Log_reader&) = delete;
+  Log_reader& operator=(const Log_reader&) = delete;
+  ~Log_reader() {
+    std::fclose(file);
+  }
+
+  // false at the end of the file, also in the middle of the requested bytes
+  bool read(void* data, std::size_t size) {
+    if (std::fread(data, 1, size, file) == size)
+      return true;
+    if (std::ferror(file))
+      throw std::runtime_error(path + ": " + std::strerror(errno));
+    return false;
+  }
+  Log_file_header read_header(const char* magic) {
+    Log_file_header h;
+    if (!read(&h, sizeof(h)) || std::memcmp(h.magic, magic, sizeof(h.magic)) != 0)
+      throw std::runtime_error(path + ": not a log file");
+    if (h.version != Log_file_header::current_version)
+      throw std::runtime_error(path + ": unsupported log file version");
+    if (h.header_checksum != log_header_checksum(h))
+      throw std::runtime_error(path + ": corrupt log file header");
+    return h;
+  }
+};
+
+// appending side of the log. Records are buffered until commit() writes them as one frame
+// and waits for the disk once for the whole group
+template <class Interval_>
+class Interval_log
+{
+public:
+  typedef Interval_ Interval;
+  typedef Log_record<Interval> Record;
+
+private:
+  std::string path;
+  int fd;
+  uint64_t bytes;          // length of the file
+  std::vector<char> frame; // a Log_frame_header followed by the pending records
+  uint32_t pending;
+
+  void write_frame();
+
+public:
+  // appends to a log whose first size bytes are valid, anything after them is cut off
+  Interval_log(const std::string& path, uint64_t size);
+  Interval_log(const Interval_log&) = delete;
+  Interval_log& operator=(const Interval_log&) = delete;
+  // records not committed are lost, the same as in a crash
+  ~Interval_log();
+
+  // replaces the file at path with an empty log of the generation
+  static void create(const std::string& path, uint64_t generation);
+  // calls fn(insert, interval) for the records of a log of the generation and returns the length
+  // of its valid part, or 0 without calling fn for a log of an older generation
+  template <class Fn>
+  static uint64_t replay(const std::string& path, uint64_t generation, Fn fn);
+
+  void append(bool insert, const Interval& i);
+  void commit();
+  // bytes in the file and pending
+  uint64_t size() const {
+    return bytes + (pending ? frame.size() : 0);
+  }
+};
+
+template <class Interval_>
+Interval_log<Interval_>::Interval_log(const std::string& path, uint64_t size)
+: path(path), bytes(size), frame(sizeof(Log_frame_header)), pending(0)
+{
+  fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+  if (fd < 0)
+    throw std::runtime_error(path + ": " + std::strerror(errno));
+  if (::ftruncate(fd, static_cast<off_t>(size)) != 0 || ::lseek(fd, 0, SEEK_END) < 0 || ::fdatasync(fd) != 0) {
+    int err = errno;
+    ::close(fd);
+    throw std::runtime_error(path + ": " + std::strerror(err));
+  }
+}
+
+template <class Interval_>
+Interval_log<Interval_>::~Interval_log()
+{
+  ::close(fd);
+}
+
+template <class Interval_>
+void Interval_log<Interval_>::create(const std::string& path, uint64_t generation)
+{
+  Log_file_header h = Log_file_header();
+  std::memcpy(h.magic, log_file_magic, sizeof(h.magic));
+  h.version = Log_file_header::current_version;
+  h.value_size = sizeof(typename Interval::Value);
+  h.generation = generation;
+  h.header_checksum = log_header_checksum(h);
+  Index_file_writer writer(path);
+  writer.write(&h, sizeof(h));
+  writer.commit();
+}
+
+template <class Interval_>
+template <class Fn>
+uint64_t Interval_log<Interval_>::replay(const std::string& path, uint64_t generation, Fn fn)
+{
+  Log_reader reader(path);
+  Log_file_header h = reader.read_header(log_file_magic);
+  if (h.value_size != sizeof(typename Interval::Value))
+    throw std::runtime_error(path + ": log of another interval type");
+  if (h.generation < generation)
+    return 0;
+  if (h.generation > generation)
+    throw std::runtime_error(path + ": log newer than its checkpoint");
+  uint64_t valid = sizeof(h);
+  std::vector<char> payload;
+  Log_frame_header f;
+  while (reader.read(&f, sizeof(f))) {
+    if (f.payload_bytes != uint64_t(f.record_count) * Record::size)
+      break;
+    payload.resize(f.payload_bytes);
+    if (!reader.read(payload.data(), payload.size()) || index_checksum(payload.data(), payload.size()) != f.checksum)
+      break;
+    const char* p = payload.data();
+    for (uint32_t r = 0; r < f.record_count; ++r) {
+      bool insert;
+      Interval i = Record::decode(p, insert);
+      fn(insert, i);
+    }
+    valid += sizeof(f) + f.payload_bytes;
+  }
+  return valid;
+}
+
+template <class Interval_>
+void Interval_log<Interval_>::append(bool insert, const Interval& i)
+{
+  std::size_t at = frame.size();
+  frame.resize(at + Record::size);
+  Record::encode(frame.data() + at, insert, i);
+  ++pending;
+  if (frame.size() >= ISL_LOG_GROUP_BYTES)
+    write_frame();
+}
+
+template <class Interval_>
+void Interval_log<Interval_>::write_frame()
+{
+  Log_frame_header f;
+  f.payload_bytes = static_cast<uint32_t>(frame.size() - sizeof(f));
+  f.record_count = pending;
+  f.checksum = index_checksum(frame.data() + sizeof(f), f.payload_bytes);
+  std::memcpy(frame.data(), &f, sizeof(f));
+  // the frame goes at the end of the valid part, so a retry after a failure overwrites
+  // whatever part of it reached the file, and that part is cut off right away
+  for (std::size_t done = 0; done < frame.size();) {
+    ssize_t n = ::pwrite(fd, frame.data() + done, frame.size() - done, static_cast<off_t>(bytes + done));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0) {
+      int err = errno;
+      // even if the file cannot be cut, a retry writes over the torn part
+      bool cut = ::ftruncate(fd, static_cast<off_t>(bytes)) == 0;
+      (void)cut;
+      throw std::runtime_error(path + ": " + std::strerror(err));
+    }
+    done += static_cast<std::size_t>(n);
+  }
+  bytes += frame.size();
+  frame.resize(sizeof(f));
+  pending = 0;
+}
+
+template <class Interval_>
+void Interval_log<Interval_>::commit()
+{
+  if (pending)
+    write_frame();
+  if (::fdatasync(fd) != 0)
+    throw std::runtime_error(path + ": " + std::strerror(errno));
+}
+
+// writes the intervals of [b, e) as the checkpoint of the generation, replacing the file at path
+// only once it is complete
+template <class Interval, class InputIterator>
+void write_checkpoint(const std::string& path, uint64_t generation, InputIterator b, InputIterator e)
+{
+  typedef Log_record<Interval> Record;
+  Log_file_header h = Log_file_header();
+  std::memcpy(h.magic, checkpoint_file_magic, sizeof(h.magic));
+  h.version = Log_file_header::current_version;
+  h.value_size = sizeof(typename Interval::Value);
+  h.generation = generation;
+  Index_file_writer writer(path);
+  writer.write(&h, sizeof(h));
+  std::vector<char> chunk;
+  chunk.reserve(log_checkpoint_chunk * Record::size);
+  uint64_t checksum = 0;
+  while (b != e) {
+    chunk.clear();
+    for (std::size_t r = 0; r < log_checkpoint_chunk && b != e; ++r, ++b) {
+      chunk.resize(chunk.size() + Record::size);
+      Record::encode(chunk.data() + chunk.size() - Record::size, true, *b);
+      ++h.record_count;
+    }
+    checksum = (checksum ^ index_checksum(chunk.data(), chunk.size())) * 0x9e3779b97f4a7c15ull;
+    writer.write(chunk.data(), chunk.size());
+  }
+  h.records_checksum = checksum;
+  h.header_checksum = log_header_checksum(h);
+  writer.rewrite_header(h);
+  writer.commit();
+}
+
+// calls fn(interval) for the intervals of a checkpoint and returns its generation
+template <class Interval, class Fn>
+uint64_t read_checkpoint(const std::string& path, Fn fn)
+{
+  typedef Log_record<Interval> Record;
+  Log_reader reader(path);
+  Log_file_header h = reader.read_header(checkpoint_file_magic);
+  if (h.value_size != sizeof(typename Interval::Value))
+    throw std::runtime_error(path + ": checkpoint of another interval type");
+  std::vector<char> chunk;
+  uint64_t checksum = 0;
+  for (uint64_t left = h.record_count; left > 0;) {
+    std::size_t records = static_cast<std::size_t>(std::min<uint64_t>(left, log_checkpoint_chunk));
+    chunk.resize(records * Record::size);
+    if (!reader.read(chunk.data(), chunk.size()))
+      throw std::runtime_error(path + ": truncated checkpoint");
+    checksum = (checksum ^ index_checksum(chunk.data(), chunk.size())) * 0x9e3779b97f4a7c15ull;
+    const char* p = chunk.data();
+    for (std::size_t r = 0; r < records; ++r) {
+      bool insert;
+      fn(Record::decode(p, insert));
+    }
+    left -= records;
+  }
+  if (checksum != h.records_checksum)
+    throw std::runtime_error(path + ": checkpoint checksum mismatch");
+  return h.generation;
+}
+
+#endif // INTERVAL_LOG_H
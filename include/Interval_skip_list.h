@@ -4,23 +4,27 @@
 #include <CGAL/license/Interval_skip_list.h>
 
 #include <CGAL/basic.h>
-#include <list>
+#include <algorithm>
+#include <functional>
 #include <iostream>
-#include <set>
+#include <iterator>
+#include <memory>
 #include <random>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "Flat_index.h"
+#include "Frozen_interval_index.h"
+#include "Interleaved_lookups.h"
+#include "Interval_slab.h"
+#include "Node_arena.h"
+#include "Parallel_for.h"
 
 #include <boost/random/linear_congruential.hpp>
 #include <boost/random/geometric_distribution.hpp>
 #include <boost/random/variate_generator.hpp>
 
-
-//#define CGAL_ISL_USE_CCC
-#define CGAL_ISL_USE_LIST
-
-#if defined(CGAL_ISL_USE_CCC) || ! defined(CGAL_ISL_USE_LIST)
-#include <CGAL/Compact_container.h>
-#endif
-
 template <class Interval_>
 class Interval_skip_list;
 
@@ -29,6 +33,10 @@ class IntervalSLnode;
 
 const int MAX_FORWARD = 48;         // Maximum number of forward pointers
 
+#ifndef ISL_FAT_FORWARD
+#define ISL_FAT_FORWARD 0 // 1 makes forward pointers carry the key of the node they point to
+#endif
+
 template <class Interval_>
 class IntervalSLnode  // interval skip list node
 {
@@ -37,71 +45,126 @@ private:
   typedef Self* Self_ptr;
   typedef Interval_ Interval;
   typedef typename Interval::Value Value;
-  typedef typename Interval_skip_list<Interval_>::Interval_handle Interval_handle;
+  typedef Interval_skip_list<Interval_> Owner;
+  typedef Interval_slab<Interval_> Container;
+  typedef typename Container::Handle Interval_handle;
+
+  // compares handles resolved through the container and plain intervals in any combination
+  template <class Derived>
+  struct handle_cmp {
+    const Container& container;
+    explicit handle_cmp(const Container& container) : container(container) {}
+    const Interval& get(Interval_handle h) const { return container[h]; }
+    const Interval& get(const Interval& i) const { return i; }
+    template <class A, class B>
+    bool operator()(const A& a, const B& b) const {
+      return Derived::less(get(a), get(b));
+    }
+  };
 
-  struct inf_cmp {
-    bool operator()(Interval_handle const& a, Interval_handle const& b) const;
+  struct inf_cmp : handle_cmp<inf_cmp> {
+    using handle_cmp<inf_cmp>::handle_cmp;
+    static bool less(const Interval& a, const Interval& b);
   };
 
-  struct sup_cmp {
-    bool operator()(Interval_handle const& a, Interval_handle const& b) const;
+  struct sup_cmp : handle_cmp<sup_cmp> {
+    using handle_cmp<sup_cmp>::handle_cmp;
+    static bool less(const Interval& a, const Interval& b);
   };
 
-  typedef std::multiset<Interval_handle, inf_cmp> lbound_index_t;
-  typedef std::multiset<Interval_handle, sup_cmp> rbound_index_t;
+  typedef Flat_index<Interval_handle> lbound_index_t; // ordered by inf_cmp
+  typedef Flat_index<Interval_handle> rbound_index_t; // ordered by sup_cmp
+
+  // forward pointer. With ISL_FAT_FORWARD it keeps a copy of the key of the node it points to,
+  // so that the search compares with the next key without loading the next node
+  struct Link {
+    Self_ptr node;
+#if ISL_FAT_FORWARD
+    Value key;
+    const Value& next_key() const { return key; }
+    Link& operator=(Self_ptr p) {
+      node = p;
+      if (p)
+        key = p->key;
+      return *this;
+    }
+#else
+    const Value& next_key() const { return node->key; }
+    Link& operator=(Self_ptr p) {
+      node = p;
+      return *this;
+    }
+#endif
+    operator Self_ptr() const { return node; }
+    Self_ptr operator->() const { return node; }
+  };
 
-  bool header_node;
   Value key;
-  IntervalSLnode** forward;  // array of forward pointers
   lbound_index_t lbound_idx;
   rbound_index_t rbound_idx;
-  int ownerCount;  // number of intervals with inf value equal to key
+  int ownerCount;  // number of intervals with inf value equal to key, -1 for the header,
+                   // -2 for a node taken off the list whose intervals wait to be migrated
   int topLevel;  // index of top level of forward pointers in this node.
                  // Levels are numbered 0..topLevel.
+  // topLevel + 1 forward pointers follow the node in the same arena block
+
+  // size and alignment of the arena block holding a node with given top level.
+  // Fat nodes start at a cache line, the search then touches the line of the node header
+  // only at nodes whose indexes it reads
+  static size_t block_size(int top_level);
+  static const size_t block_alignment = ISL_FAT_FORWARD ? 64 : alignof(Link);
 
-  // iterates over idx1, deletes from both
-  template<class Idx1_t, class Idx2_t>
-  void move_idx_to(Idx1_t& idx1, Idx2_t& idx2, Self_ptr node);
+  Link* forward() { return reinterpret_cast<Link*>(this + 1); }
+  Link const* forward() const { return reinterpret_cast<Link const*>(this + 1); }
+  void destroy_forward();
 
-  template<class OutputIterator, class IdxType>
-  void collect_from_idx(const IdxType& idx, const Value& value, OutputIterator out) const;
+  // iterates over idx1, deletes from both, returns the number of moved handles
+  template<class Idx1_t, class Idx2_t, class Cmp2_t>
+  std::size_t move_idx_to(Idx1_t& idx1, Idx2_t& idx2, const Cmp2_t& cmp2, Self_ptr node, Owner& isl);
+
+  // the position of ih in idx ordered by cmp
+  template<class Idx_t, class Cmp_t>
+  static typename Idx_t::const_iterator find_handle(const Idx_t& idx, const Interval_handle& ih, const Cmp_t& cmp);
+
+  // calls visit on the handles of idx containing value until it returns false, returns whether it never did
+  template<class Visitor, class IdxType>
+  bool visit_idx(const IdxType& idx, const Value& value, Visitor& visit, const Owner& isl) const;
 
 public:
   friend class Interval_skip_list<Interval>;
 
+  // nodes are constructed only in arena blocks of block_size(top_level) bytes
   explicit IntervalSLnode(int top_level);  // constructor for the header
   IntervalSLnode(const Value& key, int top_level);  // constructor
-  ~IntervalSLnode();  // destructor
 
   bool is_header() const;
+  bool is_pending() const;
   int get_height() const; // number of levels of this node
   const Value& get_value() const;
   IntervalSLnode* get_next() const;
 
-  void place_to_index(const Interval_handle& ih);
-  bool place_if_matches(const Interval_handle& ih);
-  bool delete_from_index(Interval_handle& ih); // saves deleted value to argument
+  void place_to_index(const Interval_handle& ih, Owner& isl);
+  bool place_if_matches(const Interval_handle& ih, Owner& isl);
+  bool delete_from_index(const Interval& i, Interval_handle& ih, Owner& isl); // saves handle of deleted interval
+  void delete_handle(const Interval_handle& ih, Owner& isl);
+  // the interval under ih, which the node holds, has delta more copies now
+  void add_copies(const Interval_handle& ih, int delta, Owner& isl);
   template<class OutputIterator>
-  void collect_by_lbound(const Value& value, OutputIterator out) const;
+  void collect_by_lbound(const Value& value, OutputIterator out, const Owner& isl) const;
   template<class OutputIterator>
-  void collect_by_rbound(const Value& value, OutputIterator out) const;
-  void move_lbound_idx_to(Self_ptr node);
-  void move_rbound_idx_to(Self_ptr node);
-  void print(std::ostream& os) const;
-};
-
-#ifndef CGAL_ISL_USE_LIST
-template <class Interval_>
-class Interval_for_container : public Interval_
-{
-private:
-  void* p;
-public:
-  explicit Interval_for_container(const Interval_& i) : Interval_(i), p(nullptr) {}
-  void* for_compact_container() const { return p; }
-  void for_compact_container(void *ptr) { p = ptr; }
+  void collect_by_rbound(const Value& value, OutputIterator out, const Owner& isl) const;
+  template<class Visitor>
+  bool visit_by_lbound(const Value& value, Visitor& visit, const Owner& isl) const {
+    return visit_idx(lbound_idx, value, visit, isl);
+  }
+  template<class Visitor>
+  bool visit_by_rbound(const Value& value, Visitor& visit, const Owner& isl) const {
+    return visit_idx(rbound_idx, value, visit, isl);
+  }
+  std::size_t move_lbound_idx_to(Self_ptr node, Owner& isl);
+  std::size_t move_rbound_idx_to(Self_ptr node, Owner& isl);
+  void print(std::ostream& os, const Owner& isl) const;
 };
-#endif
 
 template <class Interval_>
 class Interval_skip_list
@@ -110,23 +173,76 @@ private:
   typedef Interval_ Interval;
   typedef typename Interval::Value Value;
 
-#ifdef CGAL_ISL_USE_LIST
-  std::list<Interval> container;
-  typedef typename std::list<Interval>::iterator Interval_handle;
-#else
-  Compact_container<Interval_for_container<Interval_t>> container;
-  typedef typename Compact_container<Interval_for_container<Interval_t>>::iterator
-    Interval_handle;
-#endif
+public:
+  typedef typename Interval_slab<Interval>::Handle Interval_handle;
+
+private:
+  Interval_slab<Interval> container;
+  // node whose index holds the interval, indexed by handle
+  std::vector<IntervalSLnode<Interval>*> owners;
 
   int maxLevel;
   boost::rand48 random;
   boost::geometric_distribution<> prob;
   boost::variate_generator<boost::rand48&, boost::geometric_distribution<>> die;
+  Node_arena arena;  // nodes with their forward pointers and node indexes
   IntervalSLnode<Interval>* header;
+  // nodes taken off the list with their indexes, queries search them besides the list
+  std::vector<IntervalSLnode<Interval>*> pending;
+  std::size_t migration_budget; // handles an update may move, 0 for no limit
+  std::size_t migration_left;   // of the budget of the current update
 
   int random_level();  // choose a new node level at random
-  void insert_impl(const Interval_handle& ih);
+  // finger[i] is a node of level i before all keys of the insertions with it, header at first.
+  // Inserting in order of inf, each search starts from where the previous one ended
+  void seek(const Value& key, IntervalSLnode<Interval>** finger) const;
+  // returns the handle the interval is stored under, that of an equal interval if there is one
+  Interval_handle insert_impl(const Interval_handle& ih, IntervalSLnode<Interval>** finger);
+  // the first node of the search path for the inf of the interval that matches it,
+  // the finger must have been moved to its inf
+  IntervalSLnode<Interval>* matching(const Interval_handle& ih, IntervalSLnode<Interval>** finger) const;
+  void place(const Interval_handle& ih, IntervalSLnode<Interval>** finger) {
+    matching(ih, finger)->place_to_index(ih, *this);
+  }
+  // builds the list from scratch over intervals already in the container, the list must be empty.
+  // Fresh handles equal to another interval become its copies
+  void bulk_build(std::vector<Interval_handle>& handles, const std::vector<bool>& fresh);
+
+  IntervalSLnode<Interval>* create_header();
+  IntervalSLnode<Interval>* create_node(const Value& key, int top_level);
+  void destroy_node(IntervalSLnode<Interval>* node);
+  // runs node destructors if they do anything, memory is left to the arena
+  void destroy_nodes();
+
+  // drops one owner of v->forward()[i] and unlinks that node when no interval starts at its key,
+  // i must be the top level of the node
+  void release_key(IntervalSLnode<Interval>* v, int i);
+
+  void start_update() {
+    migration_left = migration_budget ? migration_budget : std::size_t(-1);
+  }
+  void finish_update() {
+    if (!pending.empty()) {
+      migrate(migration_left);
+    }
+  }
+  // whether the current update may move all intervals of node, which is charged for them
+  bool may_move(const IntervalSLnode<Interval>* node) const {
+    return node->lbound_idx.size() <= migration_left;
+  }
+  // puts a copy of node in its place in the list and makes node pending with all of its intervals.
+  // Finger entries pointing to node are moved to the copy
+  void retire(IntervalSLnode<Interval>* node, IntervalSLnode<Interval>** finger);
+  // places up to budget pending intervals, returns the number placed
+  std::size_t migrate(std::size_t budget);
+  // pending nodes are searched as if the search had passed them, left of value, or stopped at them
+  template <class Visitor>
+  bool visit_pending(const Value& value, Visitor& visit) const;
+  template <class OutputIterator>
+  void collect_pending(const Value& value, OutputIterator out) const {
+    auto put = [&](Interval_handle ih) { container.put(out, ih); return true; };
+    visit_pending(value, put);
+  }
 
   friend class IntervalSLnode<Interval>;
 
@@ -134,31 +250,101 @@ public:
   Interval_skip_list();
   template <class InputIterator>
   Interval_skip_list(InputIterator b, InputIterator e);
+  Interval_skip_list(const Interval_skip_list&) = delete;
+  Interval_skip_list& operator=(const Interval_skip_list&) = delete;
   ~Interval_skip_list();
 
   void seed(boost::rand48::result_type x0);
 
-  void insert(const Interval& i);
+  // an update then moves at most k interval handles between nodes. A node with more intervals than
+  // an update may still move is taken off the list whole and its intervals stay pending, queries
+  // search each pending node apart. Updates spend what is left of their budget on the pending intervals,
+  // maintain() more. 0, the default, moves everything at once
+  void set_migration_budget(std::size_t k) {
+    migration_budget = k;
+  }
+  // places up to budget pending intervals at their nodes, returns the number still pending
+  std::size_t maintain(std::size_t budget) {
+    migrate(budget);
+    return pending_intervals();
+  }
+  std::size_t pending_intervals() const;
+
+  // an interval equal to one in the list is stored as its copy and gets its handle.
+  // The handle stays valid until all copies are removed
+  Interval_handle insert(const Interval& i);
+  // a batch at least as large as the list rebuilds it in O(n log n) instead of inserting one by one
   template <class InputIterator>
   int insert(InputIterator b, InputIterator e);
 
   bool remove(const Interval& I);
+  // removes a copy of the interval under ih
+  void remove(Interval_handle ih);
+  // whether an interval equal to I is in the list, the same search as remove
+  bool contains(const Interval& I) const {
+    Interval_handle ih;
+    return contains(I, ih);
+  }
+  // saves the handle of the interval found to ih
+  bool contains(const Interval& I, Interval_handle& ih) const;
+  // the interval under a handle and its number of copies
+  const Interval& interval(Interval_handle ih) const { return container[ih]; }
+  std::size_t copies(Interval_handle ih) const { return container.copies(ih); }
 
   bool is_contained(const Value& value) const;
   template <class OutputIterator>
-  OutputIterator find_intervals(const Value& value, OutputIterator out) const;
+  OutputIterator find_intervals(const Value& value, OutputIterator out) const {
+    for_each_handle(value, [&](Interval_handle ih) { container.put(out, ih); return true; });
+    return out;
+  }
+  // calls visit(i) on each interval i containing value, once per copy, and stops as soon as visit
+  // returns false. Returns whether the query ran to the end. Nothing is copied, so a search for a
+  // first match costs about as much as is_contained
+  template <class Visitor>
+  bool for_each_interval(const Value& value, Visitor&& visit) const {
+    return for_each_handle(value, [&](Interval_handle ih) {
+      for (uint32_t c = container.copies(ih); c > 0; --c) {
+        if (!visit(container[ih]))
+          return false;
+      }
+      return true;
+    });
+  }
+  // the same with the handles of the intervals, once for all copies of an interval
+  template <class Visitor>
+  bool for_each_handle(const Value& value, Visitor&& visit) const;
+  // emits std::pair<Interval, std::size_t> of each distinct interval and its number of copies
+  // instead of repeating the copies
+  template <class OutputIterator>
+  OutputIterator find_intervals_counted(const Value& value, OutputIterator out) const {
+    Counted_output<OutputIterator> counted(out);
+    find_intervals(value, counted);
+    return out;
+  }
+  // queries must be sorted, emits std::pair<std::size_t, Interval> of query index and interval
+  // in no particular order. Large batches take two sweeps over the nodes in O(n + q + k)
+  template <class RandomAccessIterator, class OutputIterator>
+  OutputIterator find_intervals_sorted(RandomAccessIterator qb, RandomAccessIterator qe, OutputIterator out) const;
+  // queries in any order, emits the same pairs as find_intervals_sorted. The searches are interleaved
+  // so that the cache misses of one are overlapped with the steps of the others
+  template <class RandomAccessIterator, class OutputIterator>
+  OutputIterator find_intervals_batch(RandomAccessIterator qb, RandomAccessIterator qe, OutputIterator out) const;
+  // reports once every interval sharing a point with the window from l to r with closedness lb, rb
+  template <class OutputIterator>
+  OutputIterator find_overlapping(const Value& l, const Value& r, bool lb, bool rb, OutputIterator out) const;
+
+  // counts take the length of index prefixes instead of visiting the intervals
+  std::size_t count_intervals(const Value& value) const;
+  // takes a prefix of the index of every node with key in [l, r] and of the pending nodes,
+  // but visits none of the intervals: O(log n + m * log k) for m such keys and indexes of at most k handles,
+  // linear in the keys of the window
+  std::size_t count_overlapping(const Value& l, const Value& r, bool lb, bool rb) const;
 
   void clear();
 
   int size() const;
 
-#ifdef CGAL_ISL_USE_LIST
-  typedef typename std::list<Interval>::const_iterator const_iterator;
-#else
-  typedef typename
-  Compact_container<Interval_for_container<Interval_t> >::const_iterator
-                                                           const_iterator;
-#endif
+  typedef typename Interval_slab<Interval>::const_iterator const_iterator;
 
   const_iterator begin() const {
     return container.begin();
@@ -168,6 +354,11 @@ public:
     return container.end();
   }
 
+  // immutable pointer-free copy for data that is no longer updated
+  Frozen_interval_index<Interval> freeze() const {
+    return Frozen_interval_index<Interval>(begin(), end());
+  }
+
   // return node containing
   // Value if found, otherwise null
   IntervalSLnode<Interval>* search(const Value& searchKey);
@@ -177,66 +368,76 @@ public:
 };
 
 template <class Interval>
-bool IntervalSLnode<Interval>::inf_cmp::operator()(Interval_handle const& a, Interval_handle const& b) const
+bool IntervalSLnode<Interval>::inf_cmp::less(const Interval& a, const Interval& b)
 {
-  if (a->inf() != b->inf())
-    return a->inf() < b->inf();
-  if (a->inf_closed() != b->inf_closed())
-    return a->inf_closed();
-  // sup comparison need only for deterministic search in std::set
-  // signs not actually matter
-  if (a->sup() != b->sup())
-    return a->sup() < b->sup();
-  if (a->sup_closed() != b->sup_closed())
-    return b->sup_closed();
+  if (a.inf() != b.inf())
+    return a.inf() < b.inf();
+  if (a.inf_closed() != b.inf_closed())
+    return a.inf_closed();
+  // wider intervals go first: among intervals with equal inf
+  // the empty ones must not cut off the prefix of intervals containing inf
+  if (a.sup() != b.sup())
+    return a.sup() > b.sup();
+  if (a.sup_closed() != b.sup_closed())
+    return a.sup_closed();
   return false;
 }
 
 template<class Interval>
-bool IntervalSLnode<Interval>::sup_cmp::operator()(const Interval_handle& a, const Interval_handle& b) const {
-  if (a->sup() != b->sup())
-    return a->sup() > b->sup();
-  if (a->sup_closed() != b->sup_closed())
-    return a->sup_closed();
-  // inf comparison need only for deterministic search in std::set
-  // signs not actually matter
-  if (a->inf() != b->inf())
-    return a->inf() > b->inf();
-  if (a->inf_closed() != b->inf_closed())
-    return b->inf_closed();
+bool IntervalSLnode<Interval>::sup_cmp::less(const Interval& a, const Interval& b) {
+  if (a.sup() != b.sup())
+    return a.sup() > b.sup();
+  if (a.sup_closed() != b.sup_closed())
+    return a.sup_closed();
+  // wider intervals go first, same as in inf_cmp
+  if (a.inf() != b.inf())
+    return a.inf() < b.inf();
+  if (a.inf_closed() != b.inf_closed())
+    return a.inf_closed();
   return false;
 }
 
+template <class Interval>
+size_t IntervalSLnode<Interval>::block_size(int top_level) {
+  static_assert(sizeof(Self) % alignof(Link) == 0, "forward pointers must be aligned");
+  return sizeof(Self) + (top_level + 1) * sizeof(Link);
+}
+
 template <class Interval>
 IntervalSLnode<Interval>::IntervalSLnode(int top_level)
-  : header_node(true)
+  : ownerCount(-1)
   , topLevel(top_level)
-  , ownerCount(0)
 {
   // top_level is actually one less than the real number of levels
-  forward = new IntervalSLnode*[top_level + 1];
-  for(int i = 0; i <= top_level; i++) {
-    forward[i] = 0;
-  }
+  std::uninitialized_fill(forward(), forward() + top_level + 1, Link());
 }
 
 template <class Interval>
 IntervalSLnode<Interval>::IntervalSLnode(const Value& key, int top_level)
-  : header_node(false)
-  , key(key)
-  , topLevel(top_level)
+  : key(key)
   , ownerCount(0)
+  , topLevel(top_level)
 {
   // top_level is actually one less than the real number of levels
-  forward = new IntervalSLnode*[top_level + 1];
-  for(int i = 0; i <= top_level; i++) {
-    forward[i] = 0;
+  std::uninitialized_fill(forward(), forward() + top_level + 1, Link());
+}
+
+// the links are not members, the owner destroys them before the node
+template <class Interval>
+void IntervalSLnode<Interval>::destroy_forward() {
+  for (int i = 0; i <= topLevel; ++i) {
+    forward()[i].~Link();
   }
 }
 
 template <class Interval>
 bool IntervalSLnode<Interval>::is_header() const {
-  return header_node;
+  return ownerCount == -1;
+}
+
+template <class Interval>
+bool IntervalSLnode<Interval>::is_pending() const {
+  return ownerCount == -2;
 }
 
 template <class Interval>
@@ -246,7 +447,7 @@ int IntervalSLnode<Interval>::get_height() const {
 
 template <class Interval>
 IntervalSLnode<Interval>* IntervalSLnode<Interval>::get_next() const {
-  return forward[0];
+  return forward()[0];
 }
 
 template <class Interval>
@@ -257,109 +458,163 @@ IntervalSLnode<Interval>::get_value() const
 }
 
 template<class Interval>
-void IntervalSLnode<Interval>::place_to_index(const IntervalSLnode::Interval_handle& ih) {
-  lbound_idx.insert(ih);
-  rbound_idx.insert(ih);
+void IntervalSLnode<Interval>::place_to_index(const IntervalSLnode::Interval_handle& ih, Owner& isl) {
+  lbound_idx.insert(ih, inf_cmp(isl.container), isl.arena, isl.container.copy_weight());
+  rbound_idx.insert(ih, sup_cmp(isl.container), isl.arena, isl.container.copy_weight());
+  isl.owners[ih] = this;
 }
 
 template<class Interval>
-bool IntervalSLnode<Interval>::place_if_matches(const IntervalSLnode::Interval_handle& ih) {
-  if (ih->contains_or_inf(key)) {
-    place_to_index(ih);
+bool IntervalSLnode<Interval>::place_if_matches(const IntervalSLnode::Interval_handle& ih, Owner& isl) {
+  if (isl.container[ih].contains_or_inf(key)) {
+    place_to_index(ih, isl);
     return true;
   }
   return false;
 }
 
-// saves deleted value to argument
+// saves handle of deleted interval to argument
 template<class Interval>
-bool IntervalSLnode<Interval>::delete_from_index(IntervalSLnode::Interval_handle& ih)
+bool IntervalSLnode<Interval>::delete_from_index(const Interval& i, IntervalSLnode::Interval_handle& ih, Owner& isl)
 {
-  auto it = lbound_idx.find(ih);
+  auto it = lbound_idx.find(i, inf_cmp(isl.container));
   if (it != lbound_idx.end()) {
-    auto it2 = rbound_idx.find(ih);
+    auto it2 = rbound_idx.find(i, sup_cmp(isl.container));
     assert(it2 != rbound_idx.end());
     assert(*it == *it2);
     ih = *it;
-    lbound_idx.erase(it);
-    rbound_idx.erase(it2);
+    if (isl.container.copies(ih) > 1) {
+      // the caller drops a copy, the interval stays
+      return true;
+    }
+    lbound_idx.erase(it, isl.arena, isl.container.copy_weight());
+    rbound_idx.erase(it2, isl.arena, isl.container.copy_weight());
     return true;
   }
   return false;
 }
 
+// intervals equal to the one under ih may precede it in the index
 template<class Interval>
-template<class OutputIterator, class IdxType>
-void IntervalSLnode<Interval>::collect_from_idx(const IdxType& idx, const Value& value, OutputIterator out) const {
-  auto it = idx.begin();
-  auto const& end = idx.end();
-  while (it != end && (*it)->contains(value)) {
-    out = **it;
-    ++out;
+template<class Idx_t, class Cmp_t>
+typename Idx_t::const_iterator
+IntervalSLnode<Interval>::find_handle(const Idx_t& idx, const Interval_handle& ih, const Cmp_t& cmp) {
+  auto it = idx.lower_bound(ih, cmp);
+  while (*it != ih) {
     ++it;
+    assert(it != idx.end());
   }
+  return it;
+}
+
+template<class Interval>
+void IntervalSLnode<Interval>::delete_handle(const IntervalSLnode::Interval_handle& ih, Owner& isl)
+{
+  lbound_idx.erase(find_handle(lbound_idx, ih, inf_cmp(isl.container)), isl.arena, isl.container.copy_weight());
+  rbound_idx.erase(find_handle(rbound_idx, ih, sup_cmp(isl.container)), isl.arena, isl.container.copy_weight());
+}
+
+template<class Interval>
+void IntervalSLnode<Interval>::add_copies(const Interval_handle& ih, int delta, Owner& isl) {
+  lbound_idx.add_weight(find_handle(lbound_idx, ih, inf_cmp(isl.container)), delta);
+  rbound_idx.add_weight(find_handle(rbound_idx, ih, sup_cmp(isl.container)), delta);
+}
+
+template<class Interval>
+template<class Visitor, class IdxType>
+bool IntervalSLnode<Interval>::visit_idx(const IdxType& idx, const Value& value, Visitor& visit,
+                                         const Owner& isl) const {
+  // containment is tested over chunks of the index runs at once, a visitor stopping at the first
+  // interval does not pay for the rest of the run
+  const std::ptrdiff_t chunk = 8;
+  bool completed = true;
+  idx.for_each_run([&](const Interval_handle* first, const Interval_handle* last) {
+    while (first != last) {
+      const Interval_handle* end = last - first > chunk ? first + chunk : last;
+      const Interval_handle* stop = first + isl.container.contains_prefix(first, end, value);
+      for (; first != stop; ++first) {
+        if (!visit(*first)) {
+          completed = false;
+          return false;
+        }
+      }
+      if (stop != end)
+        return false;
+    }
+    return true;
+  });
+  return completed;
 }
 
 template<class Interval>
 template<class OutputIterator>
-void IntervalSLnode<Interval>::collect_by_lbound(const Value& value, OutputIterator out) const {
-  collect_from_idx(lbound_idx, value, out);
+void IntervalSLnode<Interval>::collect_by_lbound(const Value& value, OutputIterator out, const Owner& isl) const {
+  auto put = [&](Interval_handle ih) { isl.container.put(out, ih); return true; };
+  visit_idx(lbound_idx, value, put, isl);
 }
 
 template<class Interval>
 template<class OutputIterator>
-void IntervalSLnode<Interval>::collect_by_rbound(const Value& value, OutputIterator out) const {
-  collect_from_idx(rbound_idx, value, out);
+void IntervalSLnode<Interval>::collect_by_rbound(const Value& value, OutputIterator out, const Owner& isl) const {
+  auto put = [&](Interval_handle ih) { isl.container.put(out, ih); return true; };
+  visit_idx(rbound_idx, value, put, isl);
 }
 
 // iterates over idx1, deletes from both
+// moved handles form a prefix of idx1, so it is erased at once
 template<class Interval>
-template<class Idx1_t, class Idx2_t>
-void IntervalSLnode<Interval>::move_idx_to(Idx1_t& idx1, Idx2_t& idx2, Self_ptr node) {
-  while (!idx1.empty() && (*idx1.begin())->contains_or_inf(node->key)) {
-    node->place_to_index(*idx1.begin());
-    auto it = idx2.find(*idx1.begin());
-    assert(it != idx2.end());
-    assert(*it == *idx1.begin());
-    idx2.erase(it);
-    idx1.erase(idx1.begin());
+template<class Idx1_t, class Idx2_t, class Cmp2_t>
+std::size_t IntervalSLnode<Interval>::move_idx_to(Idx1_t& idx1, Idx2_t& idx2, const Cmp2_t& cmp2, Self_ptr node,
+                                                  Owner& isl) {
+  auto it = idx1.begin();
+  auto const end = idx1.end();
+  while (it != end && isl.container[*it].contains_or_inf(node->key)) {
+    node->place_to_index(*it, isl);
+    auto it2 = idx2.find(*it, cmp2);
+    assert(it2 != idx2.end());
+    assert(*it2 == *it);
+    idx2.erase(it2, isl.arena, isl.container.copy_weight());
+    ++it;
   }
+  std::size_t size = idx1.size();
+  idx1.erase(idx1.begin(), it, isl.arena, isl.container.copy_weight());
+  return size - idx1.size();
 }
 
 template<class Interval>
-void IntervalSLnode<Interval>::move_lbound_idx_to(Self_ptr node) {
-  move_idx_to(lbound_idx, rbound_idx, node);
+std::size_t IntervalSLnode<Interval>::move_lbound_idx_to(Self_ptr node, Owner& isl) {
+  return move_idx_to(lbound_idx, rbound_idx, sup_cmp(isl.container), node, isl);
 }
 
 template<class Interval>
-void IntervalSLnode<Interval>::move_rbound_idx_to(Self_ptr node) {
-  move_idx_to(rbound_idx, lbound_idx, node);
+std::size_t IntervalSLnode<Interval>::move_rbound_idx_to(Self_ptr node, Owner& isl) {
+  return move_idx_to(rbound_idx, lbound_idx, inf_cmp(isl.container), node, isl);
 }
 
 template <class Interval>
-void IntervalSLnode<Interval>::print(std::ostream& os) const
+void IntervalSLnode<Interval>::print(std::ostream& os, const Owner& isl) const
 {
   int i;
   os << "IntervalSLnode key:  ";
-  if (! header_node) {
+  if (! is_header()) {
     os << key;
   }else {
     os << "HEADER";
   }
   os << "\n";
   os << "number of levels: " << get_height() << std::endl;
-  os << "ownerCount = " << ownerCount << std::endl;
+  os << "ownerCount = " << ownerCount << (is_pending() ? " (pending)" : "") << std::endl;
   os << "lbound_index: {";
   std::string delim;
   for (auto const& ih : lbound_idx) {
-    os << delim << *ih;
+    os << delim << isl.container[ih];
     delim = ", ";
   }
   os << "}" << std::endl;
   os << "rbound_index: {";
   delim = "";
   for (auto const& ih : rbound_idx) {
-    os << delim << *ih;
+    os << delim << isl.container[ih];
     delim = ", ";
   }
   os << "}" << std::endl;
@@ -367,8 +622,8 @@ void IntervalSLnode<Interval>::print(std::ostream& os) const
   for(i=0; i<=topLevel; i++)
   {
     os << "forward[" << i << "] = ";
-    if(forward[i] != nullptr) {
-      os << forward[i]->get_value();
+    if(forward()[i] != nullptr) {
+      os << forward()[i]->get_value();
     } else {
       os << "nullptr";
     }
@@ -377,22 +632,16 @@ void IntervalSLnode<Interval>::print(std::ostream& os) const
   os << std::endl << std::endl;
 }
 
-template <class Interval>
-IntervalSLnode<Interval>::~IntervalSLnode() {
-  delete [] forward;
-}
-
 template <class Interval>
 Interval_skip_list<Interval>::Interval_skip_list()
   : maxLevel(0)
   , random(std::random_device()())
   , prob(0.5)
   , die(random, prob)
+  , migration_budget(0)
+  , migration_left(std::size_t(-1))
 {
-  header = new IntervalSLnode<Interval>(MAX_FORWARD);
-  for (int i = 0; i < MAX_FORWARD; i++) {
-    header->forward[i] = nullptr;
-  }
+  header = create_header();
 }
 
 template <class Interval>
@@ -402,14 +651,53 @@ Interval_skip_list<Interval>::Interval_skip_list(InputIterator b, InputIterator
     , random(std::random_device()())
     , prob(0.5)
     , die(random, prob)
+    , migration_budget(0)
+    , migration_left(std::size_t(-1))
 {
-  header = new IntervalSLnode<Interval>(MAX_FORWARD);
-  for (int i = 0; i< MAX_FORWARD; i++) {
-    header->forward[i] = 0;
-  }
-  for(; b!= e; ++b){
-    insert(*b);
+  header = create_header();
+  insert(b, e);
+}
+
+template <class Interval>
+IntervalSLnode<Interval>* Interval_skip_list<Interval>::create_header() {
+  void* block = arena.allocate_aligned(IntervalSLnode<Interval>::block_size(MAX_FORWARD - 1),
+                                      IntervalSLnode<Interval>::block_alignment);
+  return new (block) IntervalSLnode<Interval>(MAX_FORWARD - 1);
+}
+
+template <class Interval>
+IntervalSLnode<Interval>* Interval_skip_list<Interval>::create_node(const Value& key, int top_level) {
+  void* block = arena.allocate_aligned(IntervalSLnode<Interval>::block_size(top_level),
+                                      IntervalSLnode<Interval>::block_alignment);
+  return new (block) IntervalSLnode<Interval>(key, top_level);
+}
+
+template <class Interval>
+void Interval_skip_list<Interval>::destroy_node(IntervalSLnode<Interval>* node) {
+  node->lbound_idx.clear(arena);
+  node->rbound_idx.clear(arena);
+  size_t size = IntervalSLnode<Interval>::block_size(node->topLevel);
+  node->destroy_forward();
+  node->~IntervalSLnode<Interval>();
+  arena.deallocate(node, size);
+}
+
+template <class Interval>
+void Interval_skip_list<Interval>::destroy_nodes() {
+  if (!std::is_trivially_destructible<IntervalSLnode<Interval>>::value) {
+    IntervalSLnode<Interval>* v = header;
+    while (v) {
+      IntervalSLnode<Interval>* next = v->get_next();
+      v->destroy_forward();
+      v->~IntervalSLnode<Interval>();
+      v = next;
+    }
+    for (IntervalSLnode<Interval>* p : pending) {
+      p->destroy_forward();
+      p->~IntervalSLnode<Interval>();
+    }
   }
+  pending.clear();
 }
 
 template<class Interval_>
@@ -417,231 +705,766 @@ void Interval_skip_list<Interval_>::seed(boost::rand48::result_type x0) {
   random.seed(x0);
 }
 
+// moves the finger to the last node with key less than key on each level
+template <class Interval>
+void Interval_skip_list<Interval>::seek(const Value& key, IntervalSLnode<Interval>** finger) const {
+  // levels whose finger has to move are the lowest ones, the search starts at the highest of them
+  int h = -1;
+  while (h < maxLevel && finger[h + 1]->forward()[h + 1] && finger[h + 1]->forward()[h + 1].next_key() < key) {
+    ++h;
+  }
+  IntervalSLnode<Interval>* v = h >= 0 ? finger[h] : nullptr;
+  for (int i = h; i >= 0; --i) {
+    while (v->forward()[i] && v->forward()[i].next_key() < key) {
+      v = v->forward()[i];
+    }
+    finger[i] = v;
+  }
+}
+
 template<class Interval>
-void Interval_skip_list<Interval>::insert_impl(const Interval_handle& ih) {
-  auto lbound = ih->inf();
-  IntervalSLnode<Interval>* node = search(lbound);
-  if (node) {
+typename Interval_skip_list<Interval>::Interval_handle
+Interval_skip_list<Interval>::insert_impl(const Interval_handle& ih, IntervalSLnode<Interval>** finger) {
+  auto lbound = container[ih].inf();
+  seek(lbound, finger);
+  IntervalSLnode<Interval>* node = finger[0]->forward()[0];
+  if (node && node->key == lbound) {
     // node with lbound already persists in list
-    // just increase ownerCount and place interval to index of some node
-    node->ownerCount++;
-    IntervalSLnode<Interval>* v = header;
-    for (int i = maxLevel; i >= 0; --i) {
-      while (v->forward[i] && v->forward[i]->key < lbound) {
-        v = v->forward[i];
-        if (v->place_if_matches(ih)) {
-          return;
-        }
-      }
-      if (v->forward[i] && v->forward[i]->place_if_matches(ih)) {
-        return;
-      }
+    // just increase ownerCount and place interval to index of some node.
+    // An equal interval is at the same node or waits in a pending one, then the interval becomes its copy
+    IntervalSLnode<Interval>* w = matching(ih, finger);
+    typename IntervalSLnode<Interval>::inf_cmp inf_less(container);
+    IntervalSLnode<Interval>* holder = w;
+    auto it = w->lbound_idx.find(ih, inf_less);
+    for (auto p = pending.begin(); it == holder->lbound_idx.end() && p != pending.end(); ++p) {
+      holder = *p;
+      it = holder->lbound_idx.find(ih, inf_less);
+    }
+    if (it != holder->lbound_idx.end()) {
+      Interval_handle equal = *it;
+      container.erase(ih);
+      container.add_copy(equal);
+      holder->add_copies(equal, 1, *this);
+      return equal;
     }
-    assert(false); // no node for lbound
+    node->ownerCount++;
+    w->place_to_index(ih, *this);
   } else {
     // insert node with key equals to lbound
     // at the same time place interval to index of some node
     int lvl = random_level();
-    auto* new_node = new IntervalSLnode<Interval>(lbound, lvl);
+    auto* new_node = create_node(lbound, lvl);
     new_node->ownerCount = 1;
 
-    // phase 1: search for nearest node from the left at height = lvl
-    //          placing interval for index if some node contained by it
+    // phase 1: the nearest nodes from the left at height >= lvl are on the finger,
+    //          placing interval for index if some node right of them contained by it
     bool placed = false;
-    IntervalSLnode<Interval>* v = header;
-    for (int i = std::max(maxLevel, lvl); i >= lvl; --i) {
-      while (v->forward[i] && v->forward[i]->key < lbound) {
-        v = v->forward[i];
-        if (!placed) {
-          placed = v->place_if_matches(ih);
-        }
-      }
-      // if i == lvl then v->forward[i] located to the right of new node, which is a better fit for interval
-      if (!placed && i != lvl && v->forward[i]) {
-        placed = v->forward[i]->place_if_matches(ih);
+    for (int i = std::max(maxLevel, lvl); i > lvl && !placed; --i) {
+      if (finger[i]->forward()[i]) {
+        placed = finger[i]->forward()[i]->place_if_matches(ih, *this);
       }
     }
     if (!placed) {
-      new_node->place_to_index(ih);
+      new_node->place_to_index(ih, *this);
     }
 
-    if (v->forward[lvl] && v->forward[lvl]->get_height() == lvl + 1) {
-      // v->forward[lvl] is node with same height right to the new,
+    // nodes whose intervals would take more than the migration budget to sort out
+    std::vector<IntervalSLnode<Interval>*> retired;
+    auto steal = [&](IntervalSLnode<Interval>* w, bool by_lbound) {
+      if (!may_move(w)) {
+        retired.push_back(w);
+      } else {
+        migration_left -= by_lbound ? w->move_lbound_idx_to(new_node, *this) : w->move_rbound_idx_to(new_node, *this);
+      }
+    };
+
+    IntervalSLnode<Interval>* v = finger[lvl];
+    if (v->forward()[lvl] && v->forward()[lvl]->get_height() == lvl + 1) {
+      // v->forward()[lvl] is node with same height right to the new,
       // so some intervals can be moved to the new leftmost node
-      v->forward[lvl]->move_lbound_idx_to(new_node);
+      steal(v->forward()[lvl], true);
     }
     // adjust forward pointers at level lvl
-    new_node->forward[lvl] = v->forward[lvl];
-    v->forward[lvl] = new_node;
+    new_node->forward()[lvl] = v->forward()[lvl];
+    v->forward()[lvl] = new_node;
 
     // phase 2: iterate over nodes below the inserted and steal intervals which overlap it
-    IntervalSLnode<Interval>* prev_right = new_node->forward[lvl]; // last processed node on the right
+    IntervalSLnode<Interval>* prev_right = new_node->forward()[lvl]; // last processed node on the right
     for (int i = lvl - 1; i >= 0; --i) {
-      while (v->forward[i] && v->forward[i]->key < lbound) {
-        v = v->forward[i];
-        v->move_rbound_idx_to(new_node);
+      while (v != finger[i]) {
+        v = v->forward()[i];
+        steal(v, false);
       }
-      if (v->forward[i] && v->forward[i] != prev_right) {
-        v->forward[i]->move_lbound_idx_to(new_node);
-        prev_right = v->forward[i];
+      if (v->forward()[i] && v->forward()[i] != prev_right) {
+        steal(v->forward()[i], true);
+        prev_right = v->forward()[i];
       }
       // adjust forward pointers at level i
-      new_node->forward[i] = v->forward[i];
-      v->forward[i] = new_node;
+      new_node->forward()[i] = v->forward()[i];
+      v->forward()[i] = new_node;
     }
     if (lvl > maxLevel) {
       for (int i = maxLevel + 1; i <= lvl; ++i) {
-        header->forward[i] = new_node;
+        header->forward()[i] = new_node;
       }
       maxLevel = lvl;
     }
+    for (IntervalSLnode<Interval>* w : retired) {
+      retire(w, finger);
+    }
+  }
+  return ih;
+}
+
+template<class Interval>
+IntervalSLnode<Interval>*
+Interval_skip_list<Interval>::matching(const Interval_handle& ih, IntervalSLnode<Interval>** finger) const {
+  // nodes left of the finger never take it
+  const Interval& interval = container[ih];
+  for (int i = maxLevel; i >= 0; --i) {
+    IntervalSLnode<Interval>* w = finger[i]->forward()[i];
+    if (w && interval.contains_or_inf(w->key)) {
+      return w;
+    }
+  }
+  assert(false); // no node for lbound
+  return nullptr;
+}
+
+template<class Interval>
+void Interval_skip_list<Interval>::retire(IntervalSLnode<Interval>* node, IntervalSLnode<Interval>** finger) {
+  IntervalSLnode<Interval>* copy = create_node(node->key, node->topLevel);
+  copy->ownerCount = node->ownerCount;
+  IntervalSLnode<Interval>* v = header;
+  for (int i = maxLevel; i >= 0; --i) {
+    while (v->forward()[i] && v->forward()[i].next_key() < node->key) {
+      v = v->forward()[i];
+    }
+    if (i <= node->topLevel) {
+      assert(v->forward()[i] == node);
+      copy->forward()[i] = node->forward()[i];
+      v->forward()[i] = copy;
+    }
   }
+  std::replace(finger, finger + MAX_FORWARD, node, copy);
+  node->ownerCount = -2;
+  pending.push_back(node);
+}
+
+template<class Interval>
+std::size_t Interval_skip_list<Interval>::migrate(std::size_t budget) {
+  std::size_t placed = 0;
+  IntervalSLnode<Interval>* finger[MAX_FORWARD];
+  while (!pending.empty()) {
+    IntervalSLnode<Interval>* p = pending.back();
+    assert(p->is_pending());
+    // in order of inf the searches continue from one another
+    std::fill(finger, finger + MAX_FORWARD, header);
+    for (; placed < budget && !p->lbound_idx.empty(); ++placed) {
+      Interval_handle ih = p->lbound_idx.front();
+      p->delete_handle(ih, *this);
+      seek(container[ih].inf(), finger);
+      place(ih, finger);
+    }
+    if (!p->lbound_idx.empty()) {
+      break;
+    }
+    pending.pop_back();
+    destroy_node(p);
+  }
+  return placed;
+}
+
+template<class Interval>
+std::size_t Interval_skip_list<Interval>::pending_intervals() const {
+  std::size_t count = 0;
+  for (const IntervalSLnode<Interval>* p : pending) {
+    count += p->lbound_idx.size();
+  }
+  return count;
+}
+
+template<class Interval>
+template<class Visitor>
+bool Interval_skip_list<Interval>::visit_pending(const Value& value, Visitor& visit) const {
+  for (const IntervalSLnode<Interval>* p : pending) {
+    if (!(p->key < value ? p->visit_by_rbound(value, visit, *this) : p->visit_by_lbound(value, visit, *this)))
+      return false;
+  }
+  return true;
 }
 
 template <class Interval>
-void
+typename Interval_skip_list<Interval>::Interval_handle
 Interval_skip_list<Interval>::insert(const Interval& i)
 {
-#ifdef CGAL_ISL_USE_LIST
-  container.push_front(i);
-  Interval_handle ih = container.begin();
-#else
-  Interval_for_container<Interval_t> ifc(i);
-  Interval_handle ih = container.insert(ifc);
-#endif
-  insert_impl(ih);
+  Interval_handle ih = container.insert(i);
+  if (ih >= owners.size()) {
+    owners.resize(ih + 1);
+  }
+  IntervalSLnode<Interval>* finger[MAX_FORWARD];
+  std::fill(finger, finger + MAX_FORWARD, header);
+  start_update();
+  ih = insert_impl(ih, finger);
+  finish_update();
+  return ih;
 }
 
 
 template<class Interval>
 template<class InputIterator>
 int Interval_skip_list<Interval>::insert(InputIterator b, InputIterator e) {
-  int i = 0;
+  size_t old_size = container.size();
+  std::vector<Interval_handle> handles;
   for(; b != e; ++b) {
-    insert(*b);
-    ++i;
+    handles.push_back(container.insert(*b));
+    if (handles.back() >= owners.size()) {
+      owners.resize(handles.back() + 1);
+    }
+  }
+  int inserted = static_cast<int>(handles.size());
+  if (handles.size() < old_size) {
+    // in order of inf the searches continue from one another
+    std::stable_sort(handles.begin(), handles.end(), [&](Interval_handle a, Interval_handle b) {
+      return container[a].inf() < container[b].inf();
+    });
+    IntervalSLnode<Interval>* finger[MAX_FORWARD];
+    std::fill(finger, finger + MAX_FORWARD, header);
+    for (auto const& ih : handles) {
+      start_update();
+      insert_impl(ih, finger);
+      finish_update();
+    }
+    return inserted;
+  }
+  std::vector<bool> fresh(owners.size(), old_size == 0);
+  if (old_size > 0) {
+    for (auto const& ih : handles) {
+      fresh[ih] = true;
+    }
+    destroy_nodes();
+    arena.release();
+    header = create_header();
+    maxLevel = 0;
+    handles.clear();
+    for (auto it = container.begin(); it != container.end(); ++it) {
+      if (handles.empty() || handles.back() != it.handle()) {
+        handles.push_back(it.handle());
+      }
+    }
+  }
+  bulk_build(handles, fresh);
+  return inserted;
+}
+
+template<class Interval>
+void Interval_skip_list<Interval>::bulk_build(std::vector<Interval_handle>& handles, const std::vector<bool>& fresh) {
+  assert(header->get_next() == nullptr);
+  typedef IntervalSLnode<Interval> Node;
+  typename Node::inf_cmp inf_less(container);
+  parallel_sort(handles.begin(), handles.end(), inf_less);
+  container.collapse_equal(handles, inf_less, [&](Interval_handle ih) { return fresh[ih]; });
+
+  // nodes for distinct infs, linked bottom-up. The arena is not shared between threads,
+  // so this pass stays sequential, it touches each key once
+  Node* last[MAX_FORWARD];
+  std::fill(last, last + MAX_FORWARD, header);
+  for (size_t i = 0; i < handles.size(); ) {
+    const Value& key = container[handles[i]].inf();
+    Node* node = create_node(key, random_level());
+    for (int l = 0; l <= node->topLevel; ++l) {
+      last[l]->forward()[l] = node;
+      last[l] = node;
+    }
+    maxLevel = std::max(maxLevel, node->topLevel);
+    for (; i < handles.size() && container[handles[i]].inf() == key; ++i) {
+      ++node->ownerCount;
+      owners[handles[i]] = node;
+    }
+  }
+
+  // the interval goes to the leftmost of the tallest nodes it contains,
+  // which is the first node on the search path for its inf that matches it.
+  // Climbing from the inf node by top level pointers visits every new maximum height
+  const size_t block = 4096;
+  parallel_for((handles.size() + block - 1) / block, [&](size_t b) {
+    for (size_t k = b * block; k < std::min(handles.size(), (b + 1) * block); ++k) {
+      Interval_handle ih = handles[k];
+      const Interval& interval = container[ih];
+      Node* best = owners[ih];
+      for (Node* v = best; ; ) {
+        auto const& next = v->forward()[v->topLevel];
+        if (!next || !interval.contains(next.next_key())) {
+          break;
+        }
+        v = next;
+        if (v->topLevel > best->topLevel) {
+          best = v;
+        }
+      }
+      owners[ih] = best;
+    }
+  });
+
+  // handles of one node form a run sorted as in lbound index
+  parallel_sort(handles.begin(), handles.end(), [&](Interval_handle a, Interval_handle b) {
+    if (owners[a] != owners[b]) {
+      return std::less<Node*>()(owners[a], owners[b]);
+    }
+    return inf_less(a, b);
+  });
+  std::vector<size_t> runs(1, 0);
+  for (size_t i = 1; i <= handles.size(); ++i) {
+    if (i == handles.size() || owners[handles[i]] != owners[handles[i - 1]]) {
+      runs.push_back(i);
+    }
+  }
+  // equal intervals must keep the same relative order in both indexes
+  std::vector<Interval_handle> by_sup(handles);
+  parallel_for(runs.size() - 1, [&](size_t r) {
+    std::stable_sort(by_sup.begin() + runs[r], by_sup.begin() + runs[r + 1], typename Node::sup_cmp(container));
+  });
+  for (size_t r = 0; r + 1 < runs.size(); ++r) {
+    Node* node = owners[handles[runs[r]]];
+    node->lbound_idx.assign_sorted(handles.data() + runs[r], handles.data() + runs[r + 1], arena,
+                                   container.copy_weight());
+    node->rbound_idx.assign_sorted(by_sup.data() + runs[r], by_sup.data() + runs[r + 1], arena,
+                                   container.copy_weight());
   }
-  return i;
 }
 
 template <class Interval>
 bool Interval_skip_list<Interval>::remove(const Interval& I)
 {
-  // need to obtain Interval_handle for search in index
-#ifdef CGAL_ISL_USE_LIST
-  std::list<Interval> tmp;
-  tmp.push_front(I);
-  Interval_handle ih = tmp.begin();
-#else
-  Compact_container<Interval_for_container<Interval_t>> tmp;
-  Interval_for_container<Interval_t> ifc(i);
-  Interval_handle ih = container.insert(ifc);
-#endif
+  Interval_handle ih;
   auto const& lbound = I.inf();
   bool removed = false;
   IntervalSLnode<Interval>* v = header;
   int i;
   // phase 1: iterate over skip list and try to delete interval if it is in some node
   for (i = maxLevel; i >= 0; --i) {
-    while (v->forward[i] && v->forward[i]->key < lbound) {
-      v = v->forward[i];
+    while (v->forward()[i] && v->forward()[i].next_key() < lbound) {
+      v = v->forward()[i];
       if (!removed) {
-        removed = v->delete_from_index(ih);
+        removed = v->delete_from_index(I, ih, *this);
       }
     }
-    if (!removed && v->forward[i]) {
-      removed = v->forward[i]->delete_from_index(ih);
+    if (!removed && v->forward()[i]) {
+      removed = v->forward()[i]->delete_from_index(I, ih, *this);
     }
-    if (v->forward[i] && v->forward[i]->key == lbound) {
+    if (v->forward()[i] && v->forward()[i].next_key() == lbound) {
       break;
     }
   }
+  // the search also stops early at a key equal to lbound without the interval
+  for (auto p = pending.begin(); !removed && p != pending.end(); ++p) {
+    removed = (*p)->delete_from_index(I, ih, *this);
+  }
   if (!removed) {
-    assert(i < 0);
     return false;
   }
-  assert(v && v->forward[i] && v->forward[i]->key == lbound);
-  if (--(v->forward[i]->ownerCount) == 0) {
-    // phase 2: remove node from skip list and place intervals from its index to other nodes
-    IntervalSLnode<Interval>* rm_node = v->forward[i];
-    if (rm_node->forward[i]) {
-      rm_node->move_rbound_idx_to(rm_node->forward[i]);
+  if (container.drop_copy(ih)) {
+    owners[ih]->add_copies(ih, -1, *this);
+    return true;
+  }
+  assert(v && v->forward()[i] && v->forward()[i].next_key() == lbound);
+  start_update();
+  release_key(v, i);
+  // ih is valid handle since IntervalSLnode<Interval_t>::delete_from_index completed successfully
+  container.erase(ih);
+  finish_update();
+  return true;
+}
+
+template <class Interval>
+void Interval_skip_list<Interval>::remove(Interval_handle ih)
+{
+  assert(container.is_alive(ih));
+  if (container.drop_copy(ih)) {
+    owners[ih]->add_copies(ih, -1, *this);
+    return;
+  }
+  owners[ih]->delete_handle(ih, *this);
+  auto const& lbound = container[ih].inf();
+  IntervalSLnode<Interval>* v = header;
+  int i;
+  for (i = maxLevel; i >= 0; --i) {
+    while (v->forward()[i] && v->forward()[i].next_key() < lbound) {
+      v = v->forward()[i];
+    }
+    if (v->forward()[i] && v->forward()[i].next_key() == lbound) {
+      break;
+    }
+  }
+  assert(i >= 0);
+  start_update();
+  release_key(v, i);
+  container.erase(ih);
+  finish_update();
+}
+
+template <class Interval>
+bool Interval_skip_list<Interval>::contains(const Interval& I, Interval_handle& ih) const
+{
+  typename IntervalSLnode<Interval>::inf_cmp inf_less(container);
+  auto const& lbound = I.inf();
+  IntervalSLnode<Interval>* v = header;
+  for (int i = maxLevel; i >= 0; --i) {
+    while (v->forward()[i] && v->forward()[i].next_key() < lbound) {
+      v = v->forward()[i];
+    }
+    IntervalSLnode<Interval>* w = v->forward()[i];
+    if (w) {
+      auto it = w->lbound_idx.find(I, inf_less);
+      if (it != w->lbound_idx.end()) {
+        ih = *it;
+        return true;
+      }
+      if (w->key == lbound) {
+        break;
+      }
+    }
+  }
+  for (const IntervalSLnode<Interval>* p : pending) {
+    auto it = p->lbound_idx.find(I, inf_less);
+    if (it != p->lbound_idx.end()) {
+      ih = *it;
+      return true;
     }
-    v->forward[i] = rm_node->forward[i];
+  }
+  return false;
+}
+
+template <class Interval>
+void Interval_skip_list<Interval>::release_key(IntervalSLnode<Interval>* v, int i)
+{
+  if (--(v->forward()[i]->ownerCount) == 0) {
+    // phase 2: remove node from skip list and place intervals from its index to other nodes,
+    // or leave them all pending when that could take more than the migration budget
+    IntervalSLnode<Interval>* rm_node = v->forward()[i];
+    bool move = may_move(rm_node);
+    if (move) {
+      migration_left -= rm_node->lbound_idx.size();
+    }
+    if (move && rm_node->forward()[i]) {
+      rm_node->move_rbound_idx_to(rm_node->forward()[i], *this);
+    }
+    v->forward()[i] = rm_node->forward()[i];
     for (--i; i >= 0; --i) {
-      while (v->forward[i] != rm_node) {
-        v = v->forward[i];
-        rm_node->move_lbound_idx_to(v);
+      while (v->forward()[i] != rm_node) {
+        v = v->forward()[i];
+        if (move) {
+          rm_node->move_lbound_idx_to(v, *this);
+        }
       }
-      assert(v->forward[i] == rm_node);
-      // check that rm_node->forward[i] not null and wasn't processed for index change at previous iteration
-      if (rm_node->forward[i] != rm_node->forward[i + 1]) {
-        rm_node->move_rbound_idx_to(rm_node->forward[i]);
+      assert(v->forward()[i] == rm_node);
+      // check that rm_node->forward()[i] not null and wasn't processed for index change at previous iteration
+      if (move && rm_node->forward()[i] != rm_node->forward()[i + 1]) {
+        rm_node->move_rbound_idx_to(rm_node->forward()[i], *this);
       }
-      v->forward[i] = rm_node->forward[i];
+      v->forward()[i] = rm_node->forward()[i];
+    }
+    if (move) {
+      assert(rm_node->lbound_idx.empty() && rm_node->rbound_idx.empty());
+      destroy_node(rm_node);
+    } else {
+      rm_node->ownerCount = -2;
+      pending.push_back(rm_node);
     }
-    delete rm_node;
   }
-  // ih is valid iterator since IntervalSLnode<Interval_t>::delete_from_index completed successfully
-  container.erase(ih);
-  return true;
 }
 
 template<class Interval>
 bool Interval_skip_list<Interval>::is_contained(const Value& value) const {
   IntervalSLnode<Interval>* v = header;
   for (int i = maxLevel; i >= 0; --i) {
-    while (v->forward[i] && v->forward[i]->key < value) {
-      v = v->forward[i];
-      if (!v->rbound_idx.empty() && (*(v->rbound_idx.begin()))->contains(value))
+    while (v->forward()[i] && v->forward()[i].next_key() < value) {
+      v = v->forward()[i];
+      if (!v->rbound_idx.empty() && container[v->rbound_idx.front()].contains(value))
         return true;
     }
-    if (v->forward[i]) {
-      if (!v->forward[i]->lbound_idx.empty() && (*(v->forward[i]->lbound_idx.begin()))->contains(value))
+    if (v->forward()[i]) {
+      if (!v->forward()[i]->lbound_idx.empty() && container[v->forward()[i]->lbound_idx.front()].contains(value))
         return true;
-      if (v->forward[i]->key == value)
+      if (v->forward()[i].next_key() == value)
         break;
     }
   }
+  for (const IntervalSLnode<Interval>* p : pending) {
+    const auto& idx = p->key < value ? p->rbound_idx : p->lbound_idx;
+    if (!idx.empty() && container[idx.front()].contains(value))
+      return true;
+  }
   return false;
 }
 
 template<class Interval>
-template<class OutputIterator>
-OutputIterator Interval_skip_list<Interval>::find_intervals(const Value& value, OutputIterator out) const {
+template<class Visitor>
+bool Interval_skip_list<Interval>::for_each_handle(const Value& value, Visitor&& visit) const {
   IntervalSLnode<Interval>* v = header;
   IntervalSLnode<Interval>* prev_right = nullptr;
   for (int i = maxLevel; i >= 0; --i) {
-    while (v->forward[i] && v->forward[i]->key < value) {
-      v = v->forward[i];
-      v->collect_by_rbound(value, out);
+    while (v->forward()[i] && v->forward()[i].next_key() < value) {
+      v = v->forward()[i];
+      if (!v->visit_by_rbound(value, visit, *this))
+        return false;
     }
-    if (v->forward[i] && v->forward[i] != prev_right) {
+    if (v->forward()[i] && v->forward()[i] != prev_right) {
       // for node with key == value intervals with inf() == value and inf_open don't overlap value
       // therefore we collect them by lbound
-      v->forward[i]->collect_by_lbound(value, out);
-      if (v->forward[i]->key == value) {
+      if (!v->forward()[i]->visit_by_lbound(value, visit, *this))
+        return false;
+      if (v->forward()[i].next_key() == value) {
         break;
       }
-      prev_right = v->forward[i];
+      prev_right = v->forward()[i];
     }
   }
+  return visit_pending(value, visit);
+}
+
+template<class Interval>
+template<class RandomAccessIterator, class OutputIterator>
+OutputIterator Interval_skip_list<Interval>::find_intervals_sorted(RandomAccessIterator qb, RandomAccessIterator qe, OutputIterator out) const {
+  assert(std::is_sorted(qb, qe));
+  const std::size_t q = qe - qb;
+  if (q * (maxLevel + 1) < container.size()) {
+    std::vector<Interval> found;
+    for (std::size_t j = 0; j < q; ++j) {
+      found.clear();
+      find_intervals(qb[j], std::back_inserter(found));
+      for (const Interval& i : found) {
+        out = std::make_pair(j, i);
+        ++out;
+      }
+    }
+    return out;
+  }
+
+  // every interval is stored at one node. For a node left of the query point
+  // the containing intervals form a prefix of rbound index, for a node right of it or at it
+  // they form a prefix of lbound index. A node whose first interval misses the point
+  // misses all the following points of the sweep and is dropped
+  std::vector<const IntervalSLnode<Interval>*> nodes;
+  for (const IntervalSLnode<Interval>* v = header->get_next(); v; v = v->get_next()) {
+    if (!v->lbound_idx.empty())
+      nodes.push_back(v);
+  }
+  if (!pending.empty()) {
+    // a pending node is swept as a node of the list with its key
+    for (const IntervalSLnode<Interval>* p : pending) {
+      if (!p->lbound_idx.empty())
+        nodes.push_back(p);
+    }
+    std::stable_sort(nodes.begin(), nodes.end(), [](const IntervalSLnode<Interval>* a, const IntervalSLnode<Interval>* b) {
+      return a->key < b->key;
+    });
+  }
+  std::vector<const IntervalSLnode<Interval>*> active;
+  std::size_t next = 0;
+  for (std::size_t j = 0; j < q; ++j) {
+    const Value& value = qb[j];
+    while (next < nodes.size() && nodes[next]->key < value)
+      active.push_back(nodes[next++]);
+    std::size_t kept = 0;
+    for (std::size_t a = 0; a < active.size(); ++a) {
+      const IntervalSLnode<Interval>* v = active[a];
+      auto it = v->rbound_idx.begin();
+      if (!container[*it].contains(value))
+        continue;
+      active[kept++] = v;
+      Tagged_output<OutputIterator> tagged(out, j);
+      for (; it != v->rbound_idx.end() && container[*it].contains(value); ++it) {
+        container.put(tagged, *it);
+      }
+    }
+    active.resize(kept);
+  }
+
+  active.clear();
+  next = nodes.size();
+  for (std::size_t j = q; j-- > 0;) {
+    const Value& value = qb[j];
+    while (next > 0 && !(nodes[next - 1]->key < value))
+      active.push_back(nodes[--next]);
+    std::size_t kept = 0;
+    for (std::size_t a = 0; a < active.size(); ++a) {
+      const IntervalSLnode<Interval>* v = active[a];
+      auto it = v->lbound_idx.begin();
+      if (!container[*it].contains(value))
+        continue;
+      active[kept++] = v;
+      Tagged_output<OutputIterator> tagged(out, j);
+      for (; it != v->lbound_idx.end() && container[*it].contains(value); ++it) {
+        container.put(tagged, *it);
+      }
+    }
+    active.resize(kept);
+  }
   return out;
 }
 
-template <class Interval>
-void Interval_skip_list<Interval>::clear() {
-  IntervalSLnode<Interval>* v = header->get_next();
-  IntervalSLnode<Interval>* next;
-  while (v != 0) {
-    next = v->get_next();
-    delete v;
-    v = next;
+template<class Interval>
+template<class RandomAccessIterator, class OutputIterator>
+OutputIterator Interval_skip_list<Interval>::find_intervals_batch(RandomAccessIterator qb, RandomAccessIterator qe, OutputIterator out) const {
+  // the search of find_intervals cut into steps that each read the node prefetched by the previous one
+  struct Search {
+    std::size_t j;
+    const IntervalSLnode<Interval>* v;
+    const IntervalSLnode<Interval>* prev_right;
+    int i;
+  };
+  run_interleaved<Search>(qe - qb,
+    [&](Search& s, std::size_t j) {
+      s = Search{j, header, nullptr, maxLevel};
+      __builtin_prefetch(header->forward()[maxLevel].node);
+    },
+    [&](Search& s) {
+      const Value& value = qb[s.j];
+      const IntervalSLnode<Interval>* next = s.v->forward()[s.i];
+      if (next && s.v->forward()[s.i].next_key() < value) {
+        s.v = next;
+        s.v->collect_by_rbound(value, Tagged_output<OutputIterator>(out, s.j), *this);
+      } else {
+        if (next && next != s.prev_right) {
+          next->collect_by_lbound(value, Tagged_output<OutputIterator>(out, s.j), *this);
+          if (next->key == value)
+            return false;
+          s.prev_right = next;
+        }
+        if (--s.i < 0)
+          return false;
+      }
+      __builtin_prefetch(s.v->forward()[s.i].node);
+      return true;
+    });
+  if (!pending.empty()) {
+    for (std::size_t j = 0; j < static_cast<std::size_t>(qe - qb); ++j) {
+      collect_pending(qb[j], Tagged_output<OutputIterator>(out, j));
+    }
+  }
+  return out;
+}
+
+template<class Interval>
+template<class OutputIterator>
+OutputIterator Interval_skip_list<Interval>::find_overlapping(const Value& l, const Value& r, bool lb, bool rb, OutputIterator out) const {
+  assert(!(r < l));
+  // every interval is stored at one node, the tallest among the keys it contains.
+  // A node left of l holding an overlapping interval is on the search path of l,
+  // its overlapping intervals form a prefix of rbound index
+  IntervalSLnode<Interval>* v = header;
+  for (int i = maxLevel; i >= 0; --i) {
+    while (v->forward()[i] && v->forward()[i].next_key() < l) {
+      v = v->forward()[i];
+      for (auto it = v->rbound_idx.begin(); it != v->rbound_idx.end() && container[*it].overlaps(l, r, lb, rb); ++it) {
+        container.put(out, *it);
+      }
+    }
+  }
+  // each node in [l, r] owns an interval starting in the window, so walking them is paid by the output
+  for (v = v->forward()[0]; v && !(r < v->key); v = v->forward()[0]) {
+    for (Interval_handle ih : v->lbound_idx) {
+      if (container[ih].overlaps(l, r, lb, rb)) {
+        container.put(out, ih);
+      }
+    }
+  }
+  // a node right of r holding an overlapping interval is on the search path of r,
+  // its overlapping intervals form a prefix of lbound index
+  v = header;
+  IntervalSLnode<Interval>* prev_right = nullptr;
+  for (int i = maxLevel; i >= 0; --i) {
+    while (v->forward()[i] && !(r < v->forward()[i].next_key())) {
+      v = v->forward()[i];
+    }
+    if (v->forward()[i] && v->forward()[i] != prev_right) {
+      prev_right = v->forward()[i];
+      for (auto it = prev_right->lbound_idx.begin(); it != prev_right->lbound_idx.end() && container[*it].overlaps(l, r, lb, rb); ++it) {
+        container.put(out, *it);
+      }
+    }
+  }
+  // a pending node splits as a node of the list
+  for (const IntervalSLnode<Interval>* p : pending) {
+    const auto& idx = p->key < r ? p->rbound_idx : p->lbound_idx;
+    for (auto it = idx.begin(); it != idx.end() && container[*it].overlaps(l, r, lb, rb); ++it) {
+      container.put(out, *it);
+    }
+  }
+  return out;
+}
+
+template<class Interval>
+std::size_t Interval_skip_list<Interval>::count_intervals(const Value& value) const {
+  auto contains = [&](Interval_handle ih) { return container[ih].contains(value); };
+  std::size_t count = 0;
+  IntervalSLnode<Interval>* v = header;
+  IntervalSLnode<Interval>* prev_right = nullptr;
+  for (int i = maxLevel; i >= 0; --i) {
+    while (v->forward()[i] && v->forward()[i].next_key() < value) {
+      v = v->forward()[i];
+      count += container.count_prefix(v->rbound_idx, contains);
+    }
+    if (v->forward()[i] && v->forward()[i] != prev_right) {
+      count += container.count_prefix(v->forward()[i]->lbound_idx, contains);
+      if (v->forward()[i].next_key() == value) {
+        break;
+      }
+      prev_right = v->forward()[i];
+    }
   }
-  for (int i = 0; i < MAX_FORWARD; ++i) {
-    header->forward[i] = 0;
+  for (const IntervalSLnode<Interval>* p : pending) {
+    count += container.count_prefix(p->key < value ? p->rbound_idx : p->lbound_idx, contains);
   }
+  return count;
+}
+
+template<class Interval>
+std::size_t Interval_skip_list<Interval>::count_overlapping(const Value& l, const Value& r, bool lb, bool rb) const {
+  assert(!(r < l));
+  auto overlaps = [&](Interval_handle ih) { return container[ih].overlaps(l, r, lb, rb); };
+  std::size_t count = 0;
+  // same split of the nodes as in find_overlapping
+  IntervalSLnode<Interval>* v = header;
+  for (int i = maxLevel; i >= 0; --i) {
+    while (v->forward()[i] && v->forward()[i].next_key() < l) {
+      v = v->forward()[i];
+      count += container.count_prefix(v->rbound_idx, overlaps);
+    }
+  }
+  // left of r the overlapping intervals are a prefix of rbound index, at r of lbound index:
+  // with equal inf the empty intervals would cut lbound prefix, with equal sup they come last anyway
+  for (v = v->forward()[0]; v && !(r < v->key); v = v->forward()[0]) {
+    if (v->key < r)
+      count += container.count_prefix(v->rbound_idx, overlaps);
+    else
+      count += container.count_prefix(v->lbound_idx, overlaps);
+  }
+  v = header;
+  IntervalSLnode<Interval>* prev_right = nullptr;
+  for (int i = maxLevel; i >= 0; --i) {
+    while (v->forward()[i] && !(r < v->forward()[i].next_key())) {
+      v = v->forward()[i];
+    }
+    if (v->forward()[i] && v->forward()[i] != prev_right) {
+      prev_right = v->forward()[i];
+      count += container.count_prefix(prev_right->lbound_idx, overlaps);
+    }
+  }
+  for (const IntervalSLnode<Interval>* p : pending) {
+    count += container.count_prefix(p->key < r ? p->rbound_idx : p->lbound_idx, overlaps);
+  }
+  return count;
+}
+
+template <class Interval>
+void Interval_skip_list<Interval>::clear() {
+  destroy_nodes();
+  arena.release();
+  header = create_header();
   container.clear();
+  owners.clear();
   maxLevel = 0;
 }
 
@@ -659,7 +1482,7 @@ void Interval_skip_list<Interval>::print(std::ostream& os) const
   IntervalSLnode<Interval>* n = header->get_next();
 
   while( n != 0 ) {
-    n->print(os);
+    n->print(os, *this);
     n = n->get_next();
   }
 }
@@ -691,11 +1514,11 @@ Interval_skip_list<Interval>::search(const Value& searchKey)
 {
   IntervalSLnode<Interval>* v = header;
   for (int i = maxLevel; i >= 0; --i) {
-    while (v->forward[i] != 0 && (v->forward[i]->key < searchKey)) {
-      v = v->forward[i];
+    while (v->forward()[i] != 0 && (v->forward()[i].next_key() < searchKey)) {
+      v = v->forward()[i];
     }
-    if (v->forward[i] && v->forward[i]->key == searchKey)
-      return v->forward[i];
+    if (v->forward()[i] && v->forward()[i].next_key() == searchKey)
+      return v->forward()[i];
   }
   return nullptr;
 }
@@ -706,15 +1529,11 @@ int Interval_skip_list<Interval>::random_level()
   return std::min(die(), MAX_FORWARD - 1);
 }
 
+// the arena frees all nodes at once
 template <class Interval>
 Interval_skip_list<Interval>::~Interval_skip_list()
 {
-  IntervalSLnode<Interval>* next;
-  while (header != 0) {
-    next = header->get_next();
-    delete header;
-    header = next;
-  }
+  destroy_nodes();
 }
 
 #endif // INTERVAL_SKIP_LIST_H
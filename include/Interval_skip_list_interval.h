@@ -9,32 +9,78 @@
 #include <iostream>
 
 
-template <class Value_>
-class Interval_skip_list_interval
+// Closedness of the bounds of an Interval_skip_list_interval. The interval derives from it,
+// so the fixed policies take no space and fold the closedness tests of the comparators and
+// of contains() at compile time.
+
+// closedness stored with each interval, the bytes are laid out as before the policies
+class Runtime_bounds
+{
+  bool lbound_;
+  bool rbound_;
+public:
+  static constexpr bool inf_default = true;
+  static constexpr bool sup_default = true;
+
+  Runtime_bounds() = default;
+  Runtime_bounds(bool lb, bool rb) : lbound_(lb), rbound_(rb) {}
+  bool inf_closed() const {return lbound_;}
+  bool sup_closed() const {return rbound_;}
+};
+
+// [inf, sup]
+class Closed_bounds
+{
+public:
+  static constexpr bool inf_default = true;
+  static constexpr bool sup_default = true;
+
+  Closed_bounds() = default;
+  Closed_bounds(bool lb, bool rb) { CGAL_precondition(lb && rb); (void)lb; (void)rb; }
+  static constexpr bool inf_closed() {return true;}
+  static constexpr bool sup_closed() {return true;}
+};
+
+// [inf, sup)
+class Half_open_bounds
+{
+public:
+  static constexpr bool inf_default = true;
+  static constexpr bool sup_default = false;
+
+  Half_open_bounds() = default;
+  Half_open_bounds(bool lb, bool rb) { CGAL_precondition(lb && !rb); (void)lb; (void)rb; }
+  static constexpr bool inf_closed() {return true;}
+  static constexpr bool sup_closed() {return false;}
+};
+
+
+template <class Value_, class Bounds_ = Runtime_bounds>
+class Interval_skip_list_interval : private Bounds_
 {
 public:
   typedef Value_ Value;
+  typedef Bounds_ Bounds;
 
 private:
-  bool lbound_;
-  bool rbound_;
   Value inf_;
   Value sup_;
 public:
 
   Interval_skip_list_interval() = default;
+  // the closedness must be the one of Bounds_ unless it is Runtime_bounds
   Interval_skip_list_interval(const Value& inf_,
                               const Value& sup_,
-                              bool lb = true,
-                              bool rb = true);
+                              bool lb = Bounds_::inf_default,
+                              bool rb = Bounds_::sup_default);
 
   const Value& inf() const {return inf_;}
 
   const Value& sup() const {return sup_;}
 
-  bool inf_closed() const {return lbound_;}
+  bool inf_closed() const {return Bounds_::inf_closed();}
 
-  bool sup_closed() const {return rbound_;}
+  bool sup_closed() const {return Bounds_::sup_closed();}
 
   bool contains(const Value& V) const;
 
@@ -43,6 +89,9 @@ public:
   // true iff this contains (l,r)
   bool contains_interval(const Value& l, const Value& r) const;
 
+  // true iff this and the interval from l to r with closedness lb, rb share a point
+  bool overlaps(const Value& l, const Value& r, bool lb, bool rb) const;
+
   bool operator==(const Interval_skip_list_interval& I) const
   {
     return inf() == I.inf() &&
@@ -59,29 +108,29 @@ public:
 
 
 
-template <class V>
+template <class V, class B>
 std::ostream& operator<<(std::ostream& os,
-                         const Interval_skip_list_interval<V>& i)
+                         const Interval_skip_list_interval<V, B>& i)
 {
   os << (i.inf_closed()?"[":"(") << i.inf() << ", " << i.sup() << (i.sup_closed()?"]":")");
   return os;
 }
 
 
-template <class V>
-Interval_skip_list_interval<V>::Interval_skip_list_interval(
+template <class V, class B>
+Interval_skip_list_interval<V, B>::Interval_skip_list_interval(
                                                             const Value& i,
                                                             const Value& s,
                                                             bool lb, bool rb)
-  : lbound_(lb), rbound_(rb), inf_(i), sup_(s)
+  : B(lb, rb), inf_(i), sup_(s)
 {
   CGAL_precondition( !(inf_ > sup_) );
 }
 
 
-template <class V>
+template <class V, class B>
 bool
-Interval_skip_list_interval<V>::contains_interval(const Value& i,
+Interval_skip_list_interval<V, B>::contains_interval(const Value& i,
                                                   const Value& s) const
   // true iff this contains (l,r)
 {
@@ -89,17 +138,30 @@ Interval_skip_list_interval<V>::contains_interval(const Value& i,
 }
 
 
-template <class V>
+template <class V, class B>
 bool
-Interval_skip_list_interval<V>::contains(const Value& v) const
+Interval_skip_list_interval<V, B>::contains(const Value& v) const
 {
   // return true if this contains V, false otherwise
   return (inf_closed() ? inf() <= v : inf() < v) &&
          (sup_closed() ? v <= sup() : v < sup());
 }
 
-template<class Value_>
-bool Interval_skip_list_interval<Value_>::contains_or_inf(const Value& v) const {
+template <class V, class B>
+bool
+Interval_skip_list_interval<V, B>::overlaps(const Value& l, const Value& r,
+                                         bool lb, bool rb) const
+{
+  // the intersection runs from the larger inf to the smaller sup
+  const Value& lo = inf() < l ? l : inf();
+  bool lo_closed = inf() < l ? lb : (l < inf() ? inf_closed() : inf_closed() && lb);
+  const Value& hi = r < sup() ? r : sup();
+  bool hi_closed = r < sup() ? rb : (sup() < r ? sup_closed() : sup_closed() && rb);
+  return lo < hi || (lo == hi && lo_closed && hi_closed);
+}
+
+template<class Value_, class Bounds_>
+bool Interval_skip_list_interval<Value_, Bounds_>::contains_or_inf(const Value& v) const {
   return contains(v) || v == inf();
 }
 
@@ -0,0 +1,212 @@
+#ifndef INTERVAL_SKIP_LIST_MAP_H
+#define INTERVAL_SKIP_LIST_MAP_H
+
+#include <algorithm>
+#include <cstddef>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "Interval_skip_list.h"
+
+// Index_ whose intervals carry a value of type T, Interval_skip_list_map<I, T, Interval_cartesian_tree>
+// for the tree. Equal intervals are copies of one entry of Index_, so the values are kept by handle:
+// the value of the first copy in a vector next to the slab, the values of further copies apart.
+// Queries report each copy with its value, without a second lookup.
+// T must be default constructible. References to values are invalidated by inserts, the same as
+// references to the intervals of Index_.
+template <class Interval_, class T, template <class> class Index_ = Interval_skip_list>
+class Interval_skip_list_map
+{
+public:
+  typedef Interval_ Interval;
+  typedef typename Interval::Value Value;
+  typedef T Mapped;
+  typedef Index_<Interval> Index;
+  typedef typename Index::Interval_handle Interval_handle;
+
+private:
+  Index index;
+  std::vector<T> values; // value of the first copy under each handle
+  std::unordered_map<Interval_handle, std::vector<T>> more; // values of the further copies
+
+  // drops the value of a copy under ih, the values after it keep their order
+  void erase_value(Interval_handle ih, std::size_t copy);
+
+public:
+  Interval_skip_list_map() = default;
+  Interval_skip_list_map(const Interval_skip_list_map&) = delete;
+  Interval_skip_list_map& operator=(const Interval_skip_list_map&) = delete;
+
+  // inserts i with a value constructed from args, returns the handle of i shared by its copies
+  template <class... Args>
+  Interval_handle emplace(const Interval& i, Args&&... args);
+  Interval_handle insert(const Interval& i, const T& v) {
+    return emplace(i, v);
+  }
+
+  // removes a copy of i with the value inserted last
+  bool remove(const Interval& i);
+  // removes the first copy of i whose value satisfies pred
+  template <class Pred>
+  bool remove_if(const Interval& i, Pred pred);
+
+  bool contains(const Interval& i) const {
+    return index.contains(i);
+  }
+  bool is_contained(const Value& value) const {
+    return index.is_contained(value);
+  }
+  std::size_t count_intervals(const Value& value) const {
+    return index.count_intervals(value);
+  }
+
+  // calls visit(i, v) on each interval i containing value and its value v, once per copy,
+  // and stops as soon as visit returns false. Returns whether the query ran to the end
+  template <class Visitor>
+  bool for_each_interval(const Value& value, Visitor&& visit);
+  template <class Visitor>
+  bool for_each_interval(const Value& value, Visitor&& visit) const;
+  // emits std::pair<const Interval&, T&> of each interval containing value and its value
+  template <class OutputIterator>
+  OutputIterator find_intervals(const Value& value, OutputIterator out) {
+    for_each_interval(value, [&](const Interval& i, T& v) {
+      out = std::pair<const Interval&, T&>(i, v);
+      ++out;
+      return true;
+    });
+    return out;
+  }
+  template <class OutputIterator>
+  OutputIterator find_intervals(const Value& value, OutputIterator out) const {
+    for_each_interval(value, [&](const Interval& i, const T& v) {
+      out = std::pair<const Interval&, const T&>(i, v);
+      ++out;
+      return true;
+    });
+    return out;
+  }
+
+  void clear() {
+    index.clear();
+    values.clear();
+    more.clear();
+  }
+  int size() const {
+    return index.size();
+  }
+  const Index& intervals() const {
+    return index;
+  }
+};
+
+template <class Interval_, class T, template <class> class Index_>
+template <class... Args>
+typename Interval_skip_list_map<Interval_, T, Index_>::Interval_handle
+Interval_skip_list_map<Interval_, T, Index_>::emplace(const Interval& i, Args&&... args)
+{
+  Interval_handle ih = index.insert(i);
+  if (index.copies(ih) == 1) {
+    if (ih >= values.size()) {
+      values.resize(ih + 1);
+    }
+    values[ih] = T(std::forward<Args>(args)...);
+  } else {
+    more[ih].emplace_back(std::forward<Args>(args)...);
+  }
+  return ih;
+}
+
+template <class Interval_, class T, template <class> class Index_>
+void Interval_skip_list_map<Interval_, T, Index_>::erase_value(Interval_handle ih, std::size_t copy)
+{
+  auto it = more.find(ih);
+  if (it == more.end()) {
+    // the slot may be reused, its value is released now
+    values[ih] = T();
+    return;
+  }
+  std::vector<T>& rest = it->second;
+  if (copy == 0) {
+    values[ih] = std::move(rest.front());
+    copy = 1;
+  }
+  rest.erase(rest.begin() + (copy - 1));
+  if (rest.empty()) {
+    more.erase(it);
+  }
+}
+
+template <class Interval_, class T, template <class> class Index_>
+bool Interval_skip_list_map<Interval_, T, Index_>::remove(const Interval& i)
+{
+  Interval_handle ih;
+  if (!index.contains(i, ih)) {
+    return false;
+  }
+  erase_value(ih, index.copies(ih) - 1);
+  index.remove(ih);
+  return true;
+}
+
+template <class Interval_, class T, template <class> class Index_>
+template <class Pred>
+bool Interval_skip_list_map<Interval_, T, Index_>::remove_if(const Interval& i, Pred pred)
+{
+  Interval_handle ih;
+  if (!index.contains(i, ih)) {
+    return false;
+  }
+  std::size_t copy = 0;
+  if (!pred(static_cast<const T&>(values[ih]))) {
+    auto it = more.find(ih);
+    if (it == more.end()) {
+      return false;
+    }
+    auto v = std::find_if(it->second.cbegin(), it->second.cend(), pred);
+    if (v == it->second.cend()) {
+      return false;
+    }
+    copy = 1 + (v - it->second.cbegin());
+  }
+  erase_value(ih, copy);
+  index.remove(ih);
+  return true;
+}
+
+template <class Interval_, class T, template <class> class Index_>
+template <class Visitor>
+bool Interval_skip_list_map<Interval_, T, Index_>::for_each_interval(const Value& value, Visitor&& visit) const
+{
+  return index.for_each_handle(value, [&](Interval_handle ih) {
+    const Interval& i = index.interval(ih);
+    if (!visit(i, static_cast<const T&>(values[ih]))) {
+      return false;
+    }
+    if (more.empty()) {
+      return true;
+    }
+    auto it = more.find(ih);
+    if (it != more.end()) {
+      for (const T& v : it->second) {
+        if (!visit(i, v)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  });
+}
+
+// the values are not part of the index, handing them out as non-const is safe
+template <class Interval_, class T, template <class> class Index_>
+template <class Visitor>
+bool Interval_skip_list_map<Interval_, T, Index_>::for_each_interval(const Value& value, Visitor&& visit)
+{
+  const Interval_skip_list_map& self = *this;
+  return self.for_each_interval(value, [&](const Interval& i, const T& v) {
+    return visit(i, const_cast<T&>(v));
+  });
+}
+
+#endif // INTERVAL_SKIP_LIST_MAP_H
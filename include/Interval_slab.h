@@ -0,0 +1,297 @@
+#ifndef INTERVAL_SLAB_H
+#define INTERVAL_SLAB_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <utility>
+#include <vector>
+
+#include "Interval_soa.h"
+
+#ifndef ISL_SOA_INTERVALS
+#define ISL_SOA_INTERVALS 0 // 1 also keeps interval bounds in separate arrays for vectorized containment tests
+#endif
+
+// output iterator adapter for queries that report each stored interval once
+// as std::pair<Interval, std::size_t> of the interval and its number of copies
+template <class OutputIterator>
+class Counted_output
+{
+  OutputIterator& out;
+
+public:
+  explicit Counted_output(OutputIterator& out) : out(out) {}
+
+  template <class Interval>
+  void put(const Interval& i, std::size_t copies) {
+    out = std::make_pair(i, copies);
+    ++out;
+  }
+};
+
+// Storage of intervals addressed by 32-bit handles.
+// Elements are kept in one contiguous array, a handle is the index of the slot
+// and stays valid until the element is erased. Slots of erased elements are reused.
+// References are invalidated by insert(), handles are not.
+// Elements are immutable once inserted, with ISL_SOA_INTERVALS their bounds are mirrored in an Interval_soa.
+// Equal elements can share a slot that counts their copies, they then share the handle as well.
+// Sizes and iteration count every copy
+template <class T>
+class Interval_slab
+{
+public:
+  typedef uint32_t Handle;
+
+private:
+  std::vector<T> items;
+  std::vector<bool> alive;
+  std::vector<uint32_t> counts; // copies of the element in the slot
+  std::vector<Handle> free_slots;
+  std::size_t extra_copies = 0; // copies beyond the first of all slots
+#if ISL_SOA_INTERVALS
+  Interval_soa<typename T::Value> soa;
+#endif
+
+public:
+  class const_iterator
+  {
+    const Interval_slab* slab;
+    Handle h;
+    uint32_t copy; // of the element in the slot
+
+    friend class Interval_slab;
+
+    const_iterator(const Interval_slab* slab, Handle h) : slab(slab), h(h), copy(0) {}
+
+    void skip_free() {
+      while (h < slab->items.size() && !slab->alive[h]) {
+        ++h;
+      }
+    }
+
+  public:
+    typedef std::forward_iterator_tag iterator_category;
+    typedef T value_type;
+    typedef std::ptrdiff_t difference_type;
+    typedef const T* pointer;
+    typedef const T& reference;
+
+    const_iterator() : slab(nullptr), h(0), copy(0) {}
+
+    reference operator*() const { return slab->items[h]; }
+    pointer operator->() const { return &slab->items[h]; }
+    Handle handle() const { return h; }
+
+    const_iterator& operator++() {
+      if (++copy < slab->copies(h)) {
+        return *this;
+      }
+      copy = 0;
+      ++h;
+      skip_free();
+      return *this;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator tmp = *this;
+      ++*this;
+      return tmp;
+    }
+
+    bool operator==(const const_iterator& other) const { return h == other.h && copy == other.copy; }
+    bool operator!=(const const_iterator& other) const { return !(*this == other); }
+  };
+
+  Interval_slab() = default;
+
+  Handle insert(const T& v);
+  // erases the element with all of its copies
+  void erase(Handle h);
+  void clear();
+
+  // one more copy of the element under h
+  void add_copy(Handle h) {
+    assert(is_alive(h));
+    ++counts[h];
+    ++extra_copies;
+  }
+  // drops a copy of the element under h unless it is the last one, which erase() takes
+  bool drop_copy(Handle h) {
+    assert(is_alive(h));
+    if (counts[h] == 1) {
+      return false;
+    }
+    --counts[h];
+    --extra_copies;
+    return true;
+  }
+  uint32_t copies(Handle h) const { return extra_copies ? counts[h] : 1; }
+  // whether any slot holds more than one copy
+  bool has_copies() const { return extra_copies != 0; }
+  // copies() as the weight of a handle in a Flat_index
+  struct Copy_weight {
+    const Interval_slab* slab;
+    uint32_t operator()(Handle h) const { return slab->copies(h); }
+  };
+  Copy_weight copy_weight() const { return Copy_weight{this}; }
+
+  // writes the element under h to out once per copy, or once with its count to a Counted_output
+  template <class OutputIterator>
+  void put(OutputIterator& out, Handle h) const;
+  template <class OutputIterator>
+  void put(Counted_output<OutputIterator>& out, Handle h) const {
+    out.put(items[h], copies(h));
+  }
+  // copies of the elements of the prefix of idx whose handles satisfy pred,
+  // idx must weigh its handles by copy_weight()
+  template <class Index, class Pred>
+  std::size_t count_prefix(const Index& idx, const Pred& pred) const;
+  // handles are sorted by less, so that equal elements are adjacent. A fresh handle, one nobody holds yet,
+  // becomes copies of the first element equal to it that is not fresh, or else of the first one.
+  // Erased handles leave the vector
+  template <class Less, class Fresh>
+  void collapse_equal(std::vector<Handle>& handles, const Less& less, const Fresh& fresh);
+
+  const T& operator[](Handle h) const { assert(is_alive(h)); return items[h]; }
+  bool is_alive(Handle h) const { return h < items.size() && alive[h]; }
+
+  // number of leading handles in [first, last) whose element contains x
+  template <class Value>
+  uint32_t contains_prefix(const Handle* first, const Handle* last, const Value& x) const;
+
+  // elements with their copies
+  uint32_t size() const { return static_cast<uint32_t>(items.size() - free_slots.size() + extra_copies); }
+  bool empty() const { return size() == 0; }
+
+  const_iterator begin() const;
+  const_iterator end() const;
+};
+
+template <class T>
+typename Interval_slab<T>::Handle Interval_slab<T>::insert(const T& v)
+{
+  if (!free_slots.empty()) {
+    Handle h = free_slots.back();
+    free_slots.pop_back();
+    items[h] = v;
+    alive[h] = true;
+    counts[h] = 1;
+#if ISL_SOA_INTERVALS
+    soa.set(h, v);
+#endif
+    return h;
+  }
+  assert(items.size() < UINT32_MAX);
+  items.push_back(v);
+  alive.push_back(true);
+  counts.push_back(1);
+#if ISL_SOA_INTERVALS
+  soa.set(static_cast<Handle>(items.size() - 1), v);
+#endif
+  return static_cast<Handle>(items.size() - 1);
+}
+
+template <class T>
+void Interval_slab<T>::erase(Handle h)
+{
+  assert(is_alive(h));
+  alive[h] = false;
+  extra_copies -= counts[h] - 1;
+  free_slots.push_back(h);
+}
+
+template <class T>
+void Interval_slab<T>::clear()
+{
+  items.clear();
+  alive.clear();
+  counts.clear();
+  free_slots.clear();
+  extra_copies = 0;
+#if ISL_SOA_INTERVALS
+  soa.clear();
+#endif
+}
+
+template <class T>
+template <class Value>
+uint32_t Interval_slab<T>::contains_prefix(const Handle* first, const Handle* last, const Value& x) const
+{
+#if ISL_SOA_INTERVALS
+  return soa.contains_prefix(first, last, x);
+#else
+  const Handle* it = first;
+  while (it != last && items[*it].contains(x)) {
+    ++it;
+  }
+  return static_cast<uint32_t>(it - first);
+#endif
+}
+
+template <class T>
+template <class OutputIterator>
+void Interval_slab<T>::put(OutputIterator& out, Handle h) const
+{
+  for (uint32_t c = copies(h); c > 0; --c) {
+    out = items[h];
+    ++out;
+  }
+}
+
+template <class T>
+template <class Index, class Pred>
+std::size_t Interval_slab<T>::count_prefix(const Index& idx, const Pred& pred) const
+{
+  if (!extra_copies) {
+    return idx.count_prefix(pred);
+  }
+  return idx.count_prefix(pred, copy_weight());
+}
+
+template <class T>
+template <class Less, class Fresh>
+void Interval_slab<T>::collapse_equal(std::vector<Handle>& handles, const Less& less, const Fresh& fresh)
+{
+  std::size_t kept = 0;
+  for (std::size_t b = 0, e; b < handles.size(); b = e) {
+    e = b + 1;
+    while (e < handles.size() && !less(handles[b], handles[e])) {
+      ++e;
+    }
+    std::size_t first = b;
+    while (first < e && fresh(handles[first])) {
+      ++first;
+    }
+    Handle keep = handles[first < e ? first : b];
+    // kept never passes k, the group is read before it is overwritten
+    for (std::size_t k = b; k < e; ++k) {
+      Handle h = handles[k];
+      if (h == keep || !fresh(h)) {
+        handles[kept++] = h;
+        continue;
+      }
+      counts[keep] += counts[h];
+      extra_copies += counts[h];
+      erase(h);
+    }
+  }
+  handles.resize(kept);
+}
+
+template <class T>
+typename Interval_slab<T>::const_iterator Interval_slab<T>::begin() const
+{
+  const_iterator it(this, 0);
+  it.skip_free();
+  return it;
+}
+
+template <class T>
+typename Interval_slab<T>::const_iterator Interval_slab<T>::end() const
+{
+  return const_iterator(this, static_cast<Handle>(items.size()));
+}
+
+#endif // INTERVAL_SLAB_H
@@ -0,0 +1,147 @@
+#ifndef INTERVAL_SOA_H
+#define INTERVAL_SOA_H
+
+#include <cassert>
+#include <cstdint>
+#include <vector>
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+// number of leading handles in [first, last) whose interval contains x.
+// Closedness is a bit mask per handle, bit 0 for inf and bit 1 for sup
+template <class Value>
+uint32_t contains_prefix_scalar(const Value* infs, const Value* sups, const uint8_t* closed,
+                                const uint32_t* first, const uint32_t* last, const Value& x)
+{
+  const uint32_t* it = first;
+  for (; it != last; ++it) {
+    uint32_t h = *it;
+    if (!((closed[h] & 1) ? infs[h] <= x : infs[h] < x) || !((closed[h] & 2) ? x <= sups[h] : x < sups[h])) {
+      break;
+    }
+  }
+  return static_cast<uint32_t>(it - first);
+}
+
+#if defined(__AVX2__)
+// four handles per step. Closedness bytes are gathered as 32-bit words, so the mask array
+// must have three bytes of padding after the last handle
+inline uint32_t contains_prefix_avx2(const double* infs, const double* sups, const uint8_t* closed,
+                                     const uint32_t* first, const uint32_t* last, double x)
+{
+  const uint32_t* it = first;
+  const __m256d vx = _mm256_set1_pd(x);
+  const __m256i one = _mm256_set1_epi64x(1);
+  const __m256i two = _mm256_set1_epi64x(2);
+  for (; last - it >= 4; it += 4) {
+    __m128i idx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(it));
+    __m256d lo = _mm256_i32gather_pd(infs, idx, 8);
+    __m256d hi = _mm256_i32gather_pd(sups, idx, 8);
+    __m256i c = _mm256_cvtepu32_epi64(_mm_i32gather_epi32(reinterpret_cast<const int*>(closed), idx, 1));
+    __m256d lo_closed = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(c, one), one));
+    __m256d hi_closed = _mm256_castsi256_pd(_mm256_cmpeq_epi64(_mm256_and_si256(c, two), two));
+    __m256d lo_ok = _mm256_or_pd(_mm256_cmp_pd(lo, vx, _CMP_LT_OQ),
+                                 _mm256_and_pd(_mm256_cmp_pd(lo, vx, _CMP_LE_OQ), lo_closed));
+    __m256d hi_ok = _mm256_or_pd(_mm256_cmp_pd(vx, hi, _CMP_LT_OQ),
+                                 _mm256_and_pd(_mm256_cmp_pd(vx, hi, _CMP_LE_OQ), hi_closed));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_pd(_mm256_and_pd(lo_ok, hi_ok)));
+    if (mask != 0xf) {
+      return static_cast<uint32_t>(it - first) + __builtin_ctz(~mask);
+    }
+  }
+  return static_cast<uint32_t>(it - first) + contains_prefix_scalar(infs, sups, closed, it, last, x);
+}
+#endif
+
+#if defined(__AVX512F__)
+// eight handles per step, same padding as for AVX2
+inline uint32_t contains_prefix_avx512(const double* infs, const double* sups, const uint8_t* closed,
+                                       const uint32_t* first, const uint32_t* last, double x)
+{
+  const uint32_t* it = first;
+  const __m512d vx = _mm512_set1_pd(x);
+  const __m512i one = _mm512_set1_epi64(1);
+  const __m512i two = _mm512_set1_epi64(2);
+  for (; last - it >= 8; it += 8) {
+    __m256i idx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(it));
+    __m512d lo = _mm512_i32gather_pd(idx, infs, 8);
+    __m512d hi = _mm512_i32gather_pd(idx, sups, 8);
+    __m512i c = _mm512_cvtepu32_epi64(_mm256_i32gather_epi32(reinterpret_cast<const int*>(closed), idx, 1));
+    __mmask8 lo_ok = _mm512_cmp_pd_mask(lo, vx, _CMP_LT_OQ) |
+                     (_mm512_cmp_pd_mask(lo, vx, _CMP_LE_OQ) & _mm512_test_epi64_mask(c, one));
+    __mmask8 hi_ok = _mm512_cmp_pd_mask(vx, hi, _CMP_LT_OQ) |
+                     (_mm512_cmp_pd_mask(vx, hi, _CMP_LE_OQ) & _mm512_test_epi64_mask(c, two));
+    unsigned mask = static_cast<unsigned>(lo_ok & hi_ok);
+    if (mask != 0xff) {
+      return static_cast<uint32_t>(it - first) + __builtin_ctz(~mask);
+    }
+  }
+  return static_cast<uint32_t>(it - first) + contains_prefix_avx2(infs, sups, closed, it, last, x);
+}
+#endif
+
+template <class Value>
+uint32_t contains_prefix(const Value* infs, const Value* sups, const uint8_t* closed,
+                         const uint32_t* first, const uint32_t* last, const Value& x)
+{
+  return contains_prefix_scalar(infs, sups, closed, first, last, x);
+}
+
+inline uint32_t contains_prefix(const double* infs, const double* sups, const uint8_t* closed,
+                                const uint32_t* first, const uint32_t* last, const double& x)
+{
+#if defined(__AVX512F__)
+  return contains_prefix_avx512(infs, sups, closed, first, last, x);
+#elif defined(__AVX2__)
+  return contains_prefix_avx2(infs, sups, closed, first, last, x);
+#else
+  return contains_prefix_scalar(infs, sups, closed, first, last, x);
+#endif
+}
+
+// bounds of intervals indexed by handle in separate contiguous arrays, so that containment
+// is tested for a run of handles without loading whole intervals
+template <class Value>
+class Interval_soa
+{
+  std::vector<Value> infs;
+  std::vector<Value> sups;
+  std::vector<uint8_t> closed; // three bytes longer for the gathers
+
+public:
+  template <class Interval>
+  void set(uint32_t h, const Interval& i);
+  void clear();
+
+  uint32_t contains_prefix(const uint32_t* first, const uint32_t* last, const Value& x) const {
+    return ::contains_prefix(infs.data(), sups.data(), closed.data(), first, last, x);
+  }
+};
+
+template <class Value>
+template <class Interval>
+void Interval_soa<Value>::set(uint32_t h, const Interval& i)
+{
+  // gathers take the handles as signed offsets
+  assert(h < INT32_MAX);
+  if (h >= infs.size()) {
+    infs.resize(h + 1);
+    sups.resize(h + 1);
+    closed.resize(h + 4);
+  }
+  infs[h] = i.inf();
+  sups[h] = i.sup();
+  closed[h] = static_cast<uint8_t>((i.inf_closed() ? 1 : 0) | (i.sup_closed() ? 2 : 0));
+}
+
+template <class Value>
+void Interval_soa<Value>::clear()
+{
+  infs.clear();
+  sups.clear();
+  closed.clear();
+}
+
+#endif // INTERVAL_SOA_H
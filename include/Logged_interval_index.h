@@ -0,0 +1,166 @@
+#ifndef LOGGED_INTERVAL_INDEX_H
+#define LOGGED_INTERVAL_INDEX_H
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "Interval_log.h"
+#include "Interval_skip_list.h"
+
+#ifndef ISL_CHECKPOINT_BYTES
+#define ISL_CHECKPOINT_BYTES (64 << 20) // commit() takes a checkpoint once the log grows past this size
+#endif
+
+// Index_ whose updates are recorded in an operation log in a directory, so that a restart
+// recovers the committed state. Updates are buffered and made durable together by commit(),
+// one write and one flush to disk for the whole group.
+// Once the log has grown past ISL_CHECKPOINT_BYTES the intervals are written to a checkpoint
+// and the log starts over. Recovery loads the checkpoint, replays the log into counts
+// of equal intervals, where an insert and a later remove of the same interval cancel out,
+// and builds the index from the surviving intervals in a single bulk insert.
+// Only removes that found an interval are logged, so the counts never go negative.
+// The index is not synchronized, the same as Index_.
+template <class Interval_, template <class> class Index_ = Interval_skip_list>
+class Logged_interval_index
+{
+public:
+  typedef Interval_ Interval;
+  typedef typename Interval::Value Value;
+  typedef Index_<Interval> Index;
+  typedef typename Index::Interval_handle Interval_handle;
+
+private:
+  struct Interval_hash {
+    std::size_t operator()(const Interval& i) const {
+      std::size_t h = std::hash<Value>()(i.inf());
+      h = h * 31 + std::hash<Value>()(i.sup());
+      return h * 4 + (i.inf_closed() ? 2 : 0) + (i.sup_closed() ? 1 : 0);
+    }
+  };
+
+  std::string dir;
+  Index engine;
+  uint64_t generation;
+  std::unique_ptr<Interval_log<Interval>> log;
+
+  std::string log_path() const {
+    return dir + "/intervals.log";
+  }
+  std::string checkpoint_path() const {
+    return dir + "/intervals.checkpoint";
+  }
+  void recover();
+
+public:
+  // creates the directory or recovers the index stored there
+  explicit Logged_interval_index(const std::string& dir);
+  Logged_interval_index(const Logged_interval_index&) = delete;
+  Logged_interval_index& operator=(const Logged_interval_index&) = delete;
+  // commits, errors are dropped
+  ~Logged_interval_index();
+
+  Interval_handle insert(const Interval& i) {
+    log->append(true, i);
+    return engine.insert(i);
+  }
+  bool remove(const Interval& i) {
+    if (!engine.remove(i))
+      return false;
+    log->append(false, i);
+    return true;
+  }
+
+  // makes the updates so far durable
+  void commit();
+  // writes all intervals to a new checkpoint and empties the log
+  void checkpoint();
+
+  // queries go to the index
+  const Index& index() const {
+    return engine;
+  }
+  int size() const {
+    return engine.size();
+  }
+};
+
+template <class Interval_, template <class> class Index_>
+Logged_interval_index<Interval_, Index_>::Logged_interval_index(const std::string& dir)
+: dir(dir), generation(0)
+{
+  if (::mkdir(dir.c_str(), 0777) != 0 && errno != EEXIST)
+    throw std::runtime_error(dir + ": " + std::strerror(errno));
+  recover();
+}
+
+template <class Interval_, template <class> class Index_>
+Logged_interval_index<Interval_, Index_>::~Logged_interval_index()
+{
+  try {
+    commit();
+  } catch (...) {
+  }
+}
+
+template <class Interval_, template <class> class Index_>
+void Logged_interval_index<Interval_, Index_>::recover()
+{
+  std::unordered_map<Interval, std::size_t, Interval_hash> counts;
+  if (::access(checkpoint_path().c_str(), F_OK) == 0) {
+    generation = read_checkpoint<Interval>(checkpoint_path(), [&](const Interval& i) { ++counts[i]; });
+  }
+  uint64_t valid = 0;
+  if (::access(log_path().c_str(), F_OK) == 0) {
+    valid = Interval_log<Interval>::replay(log_path(), generation, [&](bool insert, const Interval& i) {
+      if (insert) {
+        ++counts[i];
+      } else {
+        auto it = counts.find(i);
+        if (it != counts.end() && --it->second == 0)
+          counts.erase(it);
+      }
+    });
+  }
+  std::vector<Interval> intervals;
+  for (const auto& c : counts)
+    intervals.insert(intervals.end(), c.second, c.first);
+  counts.clear();
+  engine.insert(intervals.begin(), intervals.end());
+
+  if (valid == 0) {
+    Interval_log<Interval>::create(log_path(), generation);
+    valid = sizeof(Log_file_header);
+  }
+  log.reset(new Interval_log<Interval>(log_path(), valid));
+}
+
+template <class Interval_, template <class> class Index_>
+void Logged_interval_index<Interval_, Index_>::commit()
+{
+  log->commit();
+  if (log->size() > ISL_CHECKPOINT_BYTES)
+    checkpoint();
+}
+
+template <class Interval_, template <class> class Index_>
+void Logged_interval_index<Interval_, Index_>::checkpoint()
+{
+  // the checkpoint holds every update, pending or not. Until the new log replaces the old one
+  // the old log has an older generation than the checkpoint and is ignored by recovery
+  write_checkpoint<Interval>(checkpoint_path(), generation + 1, engine.begin(), engine.end());
+  ++generation;
+  Interval_log<Interval>::create(log_path(), generation);
+  log.reset(new Interval_log<Interval>(log_path(), sizeof(Log_file_header)));
+}
+
+#endif // LOGGED_INTERVAL_INDEX_H
@@ -0,0 +1,182 @@
+#ifndef NODE_ARENA_H
+#define NODE_ARENA_H
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <vector>
+
+#ifndef ISL_ARENA_CHUNK_SIZE
+#define ISL_ARENA_CHUNK_SIZE (256 * 1024)
+#endif
+
+// Arena for variable-sized blocks owned by one data structure.
+// Small blocks are carved from big chunks and recycled through per-size free lists,
+// big blocks fall back to operator new but are still tracked by the arena.
+// release() frees whole chunks at once without visiting the blocks carved from them.
+class Node_arena
+{
+  static const size_t GRANULARITY = 8;
+  static const size_t MAX_SMALL = 2048;
+  static const size_t CHUNK_SIZE = ISL_ARENA_CHUNK_SIZE;
+
+  struct Free_block {
+    Free_block* next;
+  };
+
+  struct Large_block {
+    Large_block* prev;
+    Large_block* next;
+  };
+  static_assert(sizeof(Large_block) % 16 == 0, "large blocks must stay 16 byte aligned");
+
+  std::vector<char*> chunks;
+  char* cur;
+  char* end;
+  Free_block* free_lists[MAX_SMALL / GRANULARITY + 1];
+  Large_block* large;
+  size_t bytes_in_use;
+
+  static size_t size_class(size_t bytes) {
+    return (bytes + GRANULARITY - 1) / GRANULARITY;
+  }
+
+  void* allocate_from_chunk(size_t size, size_t alignment);
+
+public:
+  Node_arena();
+  Node_arena(const Node_arena&) = delete;
+  Node_arena& operator=(const Node_arena&) = delete;
+  ~Node_arena();
+
+  void* allocate(size_t bytes);
+  // small blocks only, alignment is a power of two up to 64.
+  // The block is released by deallocate like any other of its size
+  void* allocate_aligned(size_t bytes, size_t alignment);
+  void deallocate(void* p, size_t bytes);
+
+  // frees all blocks, pointers obtained from the arena become invalid
+  void release();
+
+  // bytes currently handed out, not counting free lists and chunk tails
+  size_t used() const { return bytes_in_use; }
+};
+
+inline Node_arena::Node_arena()
+  : cur(nullptr)
+  , end(nullptr)
+  , free_lists()
+  , large(nullptr)
+  , bytes_in_use(0)
+{}
+
+inline Node_arena::~Node_arena() {
+  release();
+}
+
+inline void* Node_arena::allocate_from_chunk(size_t size, size_t alignment) {
+  size_t pad = -reinterpret_cast<uintptr_t>(cur) & (alignment - 1);
+  if (static_cast<size_t>(end - cur) < pad + size) {
+    // the tail of the current chunk is abandoned, it is smaller than any node
+    cur = static_cast<char*>(::operator new(CHUNK_SIZE));
+    end = cur + CHUNK_SIZE;
+    chunks.push_back(cur);
+    pad = -reinterpret_cast<uintptr_t>(cur) & (alignment - 1);
+  }
+  if (pad) {
+    // the gap before an aligned block goes to the free list of its size
+    auto* gap = reinterpret_cast<Free_block*>(cur);
+    gap->next = free_lists[pad / GRANULARITY];
+    free_lists[pad / GRANULARITY] = gap;
+    cur += pad;
+  }
+  void* p = cur;
+  cur += size;
+  return p;
+}
+
+inline void* Node_arena::allocate(size_t bytes) {
+  size_t cls = size_class(bytes);
+  if (cls == 0) {
+    cls = 1;
+  }
+  bytes_in_use += cls * GRANULARITY;
+  if (cls * GRANULARITY <= MAX_SMALL) {
+    Free_block* block = free_lists[cls];
+    if (block) {
+      free_lists[cls] = block->next;
+      return block;
+    }
+    return allocate_from_chunk(cls * GRANULARITY, GRANULARITY);
+  }
+  auto* block = static_cast<Large_block*>(::operator new(sizeof(Large_block) + cls * GRANULARITY));
+  block->prev = nullptr;
+  block->next = large;
+  if (large) {
+    large->prev = block;
+  }
+  large = block;
+  return block + 1;
+}
+
+inline void* Node_arena::allocate_aligned(size_t bytes, size_t alignment) {
+  if (alignment <= GRANULARITY) {
+    return allocate(bytes);
+  }
+  assert(alignment <= 64 && (alignment & (alignment - 1)) == 0);
+  size_t cls = size_class(bytes);
+  assert(cls > 0 && cls * GRANULARITY <= MAX_SMALL);
+  bytes_in_use += cls * GRANULARITY;
+  // a free block of the size is taken only if it happens to be aligned
+  Free_block* block = free_lists[cls];
+  if (block && (reinterpret_cast<uintptr_t>(block) & (alignment - 1)) == 0) {
+    free_lists[cls] = block->next;
+    return block;
+  }
+  return allocate_from_chunk(cls * GRANULARITY, alignment);
+}
+
+inline void Node_arena::deallocate(void* p, size_t bytes) {
+  size_t cls = size_class(bytes);
+  if (cls == 0) {
+    cls = 1;
+  }
+  assert(bytes_in_use >= cls * GRANULARITY);
+  bytes_in_use -= cls * GRANULARITY;
+  if (cls * GRANULARITY <= MAX_SMALL) {
+    auto* block = static_cast<Free_block*>(p);
+    block->next = free_lists[cls];
+    free_lists[cls] = block;
+    return;
+  }
+  Large_block* block = static_cast<Large_block*>(p) - 1;
+  if (block->prev) {
+    block->prev->next = block->next;
+  } else {
+    large = block->next;
+  }
+  if (block->next) {
+    block->next->prev = block->prev;
+  }
+  ::operator delete(block);
+}
+
+inline void Node_arena::release() {
+  for (char* chunk : chunks) {
+    ::operator delete(chunk);
+  }
+  chunks.clear();
+  while (large) {
+    Large_block* next = large->next;
+    ::operator delete(large);
+    large = next;
+  }
+  for (auto& list : free_lists) {
+    list = nullptr;
+  }
+  cur = end = nullptr;
+  bytes_in_use = 0;
+}
+
+#endif // NODE_ARENA_H
@@ -0,0 +1,357 @@
+#ifndef PAGE_CACHE_H
+#define PAGE_CACHE_H
+
+#include <cassert>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#ifndef ISL_PAGE_SIZE
+#define ISL_PAGE_SIZE 4096
+#endif
+
+#ifndef ISL_PAGE_CHUNK_SIZE
+#define ISL_PAGE_CHUNK_SIZE 256 // pages are cut into chunks of this size for small objects
+#endif
+
+#ifndef ISL_PAGE_CACHE_BYTES
+#define ISL_PAGE_CACHE_BYTES (256 << 20) // default memory budget of a page cache
+#endif
+
+typedef uint32_t Page_id;  // 0 is no page
+typedef uint32_t Chunk_id; // page * chunks per page + chunk in the page, 0 is no chunk
+
+class Page_cache;
+
+// pins a cached page, the cache does not evict or reuse it while a reference exists
+class Page_ref
+{
+  friend class Page_cache;
+  struct Frame;
+
+  Frame* frame;
+
+  explicit Page_ref(Frame* frame);
+
+public:
+  Page_ref() : frame(nullptr) {}
+  Page_ref(const Page_ref& other);
+  Page_ref(Page_ref&& other) : frame(other.frame) { other.frame = nullptr; }
+  Page_ref& operator=(Page_ref other) {
+    std::swap(frame, other.frame);
+    return *this;
+  }
+  ~Page_ref();
+
+  explicit operator bool() const { return frame != nullptr; }
+  Page_id id() const;
+  char* data() const;
+  template <class T>
+  T* as() const { return reinterpret_cast<T*>(data()); }
+};
+
+struct Page_ref::Frame {
+  Page_id id;
+  uint32_t pins;
+  bool dirty;
+  Frame* prev; // LRU list, most recently used first
+  Frame* next;
+  char* data;
+};
+
+inline Page_ref::Page_ref(Frame* frame) : frame(frame) {
+  ++frame->pins;
+}
+
+inline Page_ref::Page_ref(const Page_ref& other) : frame(other.frame) {
+  if (frame)
+    ++frame->pins;
+}
+
+inline Page_ref::~Page_ref() {
+  if (frame)
+    --frame->pins;
+}
+
+inline Page_id Page_ref::id() const {
+  return frame->id;
+}
+
+inline char* Page_ref::data() const {
+  return frame->data;
+}
+
+// Fixed-size pages of a scratch file with an LRU cache of at most budget bytes in front of it.
+// The file is created in a directory and unlinked at once, so it goes away with the cache.
+// Pages are read on a miss and written back when a dirty page is evicted; pinned pages
+// are never evicted, the cache grows past its budget while all of its pages are pinned.
+// Freed pages are reused by later allocations. Small objects take chunks of a page, the pages
+// of chunks stay allocated and freed chunks are reused. Not synchronized.
+class Page_cache
+{
+public:
+  static const std::size_t page_size = ISL_PAGE_SIZE;
+  static const std::size_t chunk_size = ISL_PAGE_CHUNK_SIZE;
+  static const uint32_t chunks_per_page = static_cast<uint32_t>(page_size / chunk_size);
+  static_assert(page_size % chunk_size == 0, "pages are cut into whole chunks");
+
+  struct Stats {
+    uint64_t hits;
+    uint64_t reads;  // misses
+    uint64_t writes; // write-backs of evicted or flushed pages
+  };
+
+private:
+  typedef Page_ref::Frame Frame;
+
+  struct Frame_deleter {
+    void operator()(Frame* f) const {
+      std::free(f->data);
+      delete f;
+    }
+  };
+
+  int fd;
+  std::string path;
+  std::size_t capacity; // frames
+  std::vector<std::unique_ptr<Frame, Frame_deleter>> pool;
+  std::vector<Frame*> spare; // frames holding no page
+  std::unordered_map<Page_id, Frame*> frames;
+  Frame lru;                 // sentinel of the LRU list
+  std::vector<Page_id> free_pages;
+  std::vector<Chunk_id> free_chunks;
+  Page_id page_count;        // pages in the file, page 0 is never used
+  Stats stats;
+
+  void fail(const char* what) const {
+    throw std::runtime_error(path + ": " + what + ": " + std::strerror(errno));
+  }
+  void unlink_frame(Frame* f) {
+    f->prev->next = f->next;
+    f->next->prev = f->prev;
+  }
+  void push_front(Frame* f) {
+    f->next = lru.next;
+    f->prev = &lru;
+    lru.next->prev = f;
+    lru.next = f;
+  }
+  void write_back(Frame* f);
+  void read_page(Frame* f);
+  // a frame for page id, taken from the spare frames, the least recently used unpinned page or new
+  Frame* take_frame(Page_id id);
+
+public:
+  // TMPDIR or /tmp
+  static std::string scratch_dir() {
+    const char* dir = std::getenv("TMPDIR");
+    return dir && *dir ? dir : "/tmp";
+  }
+
+  // scratch file in dir with a cache of budget bytes, at least a few pages
+  explicit Page_cache(const std::string& dir, std::size_t budget = ISL_PAGE_CACHE_BYTES);
+  Page_cache(const Page_cache&) = delete;
+  Page_cache& operator=(const Page_cache&) = delete;
+  ~Page_cache();
+
+  // for reading, or for writing when write is set: the page goes back to the file once evicted
+  Page_ref fetch(Page_id id, bool write = false);
+  // zero filled page for writing
+  Page_ref allocate();
+  // frees the page, the reference must be the only one
+  void release(Page_ref&& page);
+
+  Chunk_id allocate_chunk();
+  void release_chunk(Chunk_id id) { free_chunks.push_back(id); }
+  // the page holding the chunk, chunk_data finds the chunk in it
+  Page_ref fetch_chunk(Chunk_id id, bool write = false) { return fetch(id / chunks_per_page, write); }
+  static char* chunk_data(const Page_ref& page, Chunk_id id) {
+    return page.data() + (id % chunks_per_page) * chunk_size;
+  }
+
+  // writes all dirty pages back
+  void flush();
+  // frees all pages and truncates the file
+  void clear();
+
+  std::size_t budget() const { return capacity * page_size; }
+  // bytes of the file and of the cached pages
+  uint64_t file_size() const { return uint64_t(page_count) * page_size; }
+  std::size_t cached_bytes() const { return frames.size() * page_size; }
+  const Stats& statistics() const { return stats; }
+  void reset_statistics() { stats = Stats(); }
+};
+
+inline Page_cache::Page_cache(const std::string& dir, std::size_t budget)
+: fd(-1), path(dir + "/isl-pages-XXXXXX"), capacity(std::max<std::size_t>(budget / page_size, 8)),
+  page_count(1), stats()
+{
+  std::vector<char> name(path.begin(), path.end());
+  name.push_back('\0');
+  fd = ::mkstemp(name.data());
+  if (fd < 0)
+    fail("cannot create page file");
+  path = name.data();
+  ::unlink(path.c_str());
+  lru.prev = lru.next = &lru;
+}
+
+inline Page_cache::~Page_cache() {
+  ::close(fd);
+}
+
+inline void Page_cache::write_back(Frame* f) {
+  off_t offset = static_cast<off_t>(f->id) * static_cast<off_t>(page_size);
+  for (std::size_t done = 0; done < page_size;) {
+    ssize_t n = ::pwrite(fd, f->data + done, page_size - done, offset + done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      fail("write");
+    done += static_cast<std::size_t>(n);
+  }
+  f->dirty = false;
+  ++stats.writes;
+}
+
+inline void Page_cache::read_page(Frame* f) {
+  off_t offset = static_cast<off_t>(f->id) * static_cast<off_t>(page_size);
+  for (std::size_t done = 0; done < page_size;) {
+    ssize_t n = ::pread(fd, f->data + done, page_size - done, offset + done);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0)
+      fail("read");
+    if (n == 0) {
+      // allocated but never written back
+      std::memset(f->data + done, 0, page_size - done);
+      break;
+    }
+    done += static_cast<std::size_t>(n);
+  }
+  ++stats.reads;
+}
+
+inline Page_cache::Frame* Page_cache::take_frame(Page_id id) {
+  Frame* f = nullptr;
+  if (!spare.empty()) {
+    f = spare.back();
+    spare.pop_back();
+  } else if (pool.size() >= capacity) {
+    for (Frame* v = lru.prev; v != &lru; v = v->prev) {
+      if (v->pins == 0) {
+        f = v;
+        break;
+      }
+    }
+    if (f) {
+      if (f->dirty)
+        write_back(f);
+      unlink_frame(f);
+      frames.erase(f->id);
+    }
+  }
+  if (!f) {
+    void* data = nullptr;
+    if (::posix_memalign(&data, 64, page_size) != 0)
+      throw std::bad_alloc();
+    pool.emplace_back(new Frame());
+    f = pool.back().get();
+    f->data = static_cast<char*>(data);
+  }
+  f->id = id;
+  f->pins = 0;
+  f->dirty = false;
+  frames.emplace(id, f);
+  push_front(f);
+  return f;
+}
+
+inline Page_ref Page_cache::fetch(Page_id id, bool write) {
+  assert(id != 0 && id < page_count);
+  auto it = frames.find(id);
+  Frame* f;
+  if (it != frames.end()) {
+    f = it->second;
+    if (lru.next != f) {
+      unlink_frame(f);
+      push_front(f);
+    }
+    ++stats.hits;
+  } else {
+    f = take_frame(id);
+    read_page(f);
+  }
+  f->dirty |= write;
+  return Page_ref(f);
+}
+
+inline Page_ref Page_cache::allocate() {
+  Page_id id;
+  if (!free_pages.empty()) {
+    id = free_pages.back();
+    free_pages.pop_back();
+  } else {
+    id = page_count++;
+  }
+  Frame* f = take_frame(id);
+  std::memset(f->data, 0, page_size);
+  f->dirty = true;
+  return Page_ref(f);
+}
+
+inline void Page_cache::release(Page_ref&& page) {
+  Frame* f = page.frame;
+  page.frame = nullptr;
+  assert(f->pins == 1);
+  f->pins = 0;
+  f->dirty = false;
+  unlink_frame(f);
+  frames.erase(f->id);
+  free_pages.push_back(f->id);
+  spare.push_back(f);
+}
+
+inline Chunk_id Page_cache::allocate_chunk() {
+  if (free_chunks.empty()) {
+    Page_id page = allocate().id();
+    for (uint32_t c = chunks_per_page; c-- > 0;)
+      free_chunks.push_back(page * chunks_per_page + c);
+  }
+  Chunk_id id = free_chunks.back();
+  free_chunks.pop_back();
+  return id;
+}
+
+inline void Page_cache::flush() {
+  for (Frame* f = lru.next; f != &lru; f = f->next) {
+    if (f->dirty)
+      write_back(f);
+  }
+}
+
+inline void Page_cache::clear() {
+  for (Frame* f = lru.next; f != &lru; f = f->next) {
+    assert(f->pins == 0);
+    spare.push_back(f);
+  }
+  lru.prev = lru.next = &lru;
+  frames.clear();
+  free_pages.clear();
+  free_chunks.clear();
+  page_count = 1;
+  if (::ftruncate(fd, 0) != 0)
+    fail("truncate");
+}
+
+#endif // PAGE_CACHE_H
@@ -0,0 +1,552 @@
+#ifndef PAGED_INDEX_H
+#define PAGED_INDEX_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <vector>
+
+#include "Page_cache.h"
+
+// where a Paged_index lives, kept by its owner. A single record is kept in front, a few records
+// in a chunk of a page and only larger indexes take pages of their own
+template <class Record>
+struct Paged_index_root {
+  Page_id root;   // 0 without pages of its own
+  uint32_t first; // leftmost leaf, or the chunk holding the records
+  uint32_t size;
+  Record front;   // first record, valid while not empty
+};
+
+// Sorted multiset of fixed-size records in the pages of a Page_cache, a B+-tree whose leaves
+// are linked both ways. Equal records are not told apart, erase takes any one of them.
+// Leaves are freed once empty and inner pages once they lose their last child, pages are not
+// merged otherwise. The index keeps no state of its own besides the root passed to every call,
+// so any number of indexes share one cache.
+template <class Record, class Compare>
+class Paged_index
+{
+  static_assert(std::is_trivially_copyable<Record>::value, "records are copied to pages as raw memory");
+
+  struct Page_header {
+    uint32_t count; // records of a leaf, children of an inner page
+    uint32_t level; // 0 for leaves
+    Page_id prev;   // leaves only
+    Page_id next;
+  };
+  static_assert(sizeof(Page_header) % alignof(Record) == 0, "page header breaks record alignment");
+
+public:
+  typedef Paged_index_root<Record> Root;
+
+  // inner pages hold capacity - 1 separators followed by capacity children
+  static const uint32_t leaf_capacity = (Page_cache::page_size - sizeof(Page_header)) / sizeof(Record);
+  static const uint32_t inner_capacity =
+      (Page_cache::page_size - sizeof(Page_header) + sizeof(Record)) / (sizeof(Record) + sizeof(Page_id));
+  static_assert(leaf_capacity >= 4 && inner_capacity >= 4, "records too large for a page");
+  // indexes of two up to chunk_capacity records are kept in a chunk
+  static const uint32_t chunk_capacity = static_cast<uint32_t>(Page_cache::chunk_size / sizeof(Record));
+
+private:
+  static const int max_height = 32;
+
+  // inner pages from the root down to the parent of a leaf, with the child taken at each of them
+  struct Path {
+    Page_id page[max_height];
+    uint32_t slot[max_height];
+    int height;
+  };
+
+  Page_cache& cache;
+  Compare cmp;
+
+  static Page_header* header(const Page_ref& p) { return p.as<Page_header>(); }
+  // records of a leaf, separators of an inner page
+  static Record* records(const Page_ref& p) { return reinterpret_cast<Record*>(p.data() + sizeof(Page_header)); }
+  static Page_id* children(const Page_ref& p) {
+    return reinterpret_cast<Page_id*>(p.data() + sizeof(Page_header) + (inner_capacity - 1) * sizeof(Record));
+  }
+  static Record* chunk_records(const Page_ref& p, Chunk_id c) {
+    return reinterpret_cast<Record*>(Page_cache::chunk_data(p, c));
+  }
+  static bool in_chunk(const Root& r) { return !r.root && r.size > 1; }
+
+  // leaf where the first record not less than x is, unless all of its records are less
+  Page_ref descend(Page_id root, const Record& x, Path& path, bool write);
+  // moves path and leaf to the next leaf, false at the last one
+  bool next_leaf(Path& path, Page_ref& leaf, bool write);
+  // path to the first leaf
+  void first_path(const Root& r, Path& path);
+  void insert_child(Root& r, const Path& path, Record sep, Page_id child);
+  // unlinks and frees an empty leaf, then its ancestors that are left without children
+  void remove_leaf(Root& r, const Path& path, Page_ref&& leaf);
+  void update_front(Root& r);
+  // records of an index without pages of its own
+  void small_records(const Root& r, std::vector<Record>& out) const;
+  void clear_small(Root& r);
+  // moves the records of a tree left with a single leaf of few records to a chunk
+  void shrink(Root& r);
+
+public:
+  Paged_index(Page_cache& cache, Compare cmp = Compare()) : cache(cache), cmp(cmp) {}
+
+  void insert(Root& r, const Record& x);
+  // erases one record equal to x, false if there is none
+  bool erase(Root& r, const Record& x);
+  // erases the longest prefix whose records satisfy pred, appending them to out
+  template <class Pred>
+  void erase_prefix(Root& r, Pred pred, std::vector<Record>& out);
+  // builds the index from a sorted range, r must be empty
+  void assign_sorted(Root& r, const Record* first, const Record* last);
+
+  // calls fn(record) in order until it returns false
+  template <class Fn>
+  void scan(const Root& r, Fn fn) const;
+  template <class Pred>
+  std::size_t count_prefix(const Root& r, Pred pred) const;
+};
+
+template <class Record, class Compare>
+Page_ref Paged_index<Record, Compare>::descend(Page_id root, const Record& x, Path& path, bool write) {
+  path.height = 0;
+  Page_ref p = cache.fetch(root, write);
+  while (header(p)->level > 0) {
+    const Record* seps = records(p);
+    uint32_t c = static_cast<uint32_t>(std::lower_bound(seps, seps + header(p)->count - 1, x, cmp) - seps);
+    assert(path.height < max_height);
+    path.page[path.height] = p.id();
+    path.slot[path.height] = c;
+    ++path.height;
+    p = cache.fetch(children(p)[c], write);
+  }
+  return p;
+}
+
+template <class Record, class Compare>
+bool Paged_index<Record, Compare>::next_leaf(Path& path, Page_ref& leaf, bool write) {
+  int d = path.height - 1;
+  Page_ref p;
+  for (; d >= 0; --d) {
+    p = cache.fetch(path.page[d], write);
+    if (path.slot[d] + 1 < header(p)->count)
+      break;
+  }
+  if (d < 0)
+    return false;
+  ++path.slot[d];
+  for (;;) {
+    Page_ref child = cache.fetch(children(p)[path.slot[d]], write);
+    if (header(child)->level == 0) {
+      leaf = child;
+      return true;
+    }
+    ++d;
+    path.page[d] = child.id();
+    path.slot[d] = 0;
+    p = child;
+  }
+}
+
+template <class Record, class Compare>
+void Paged_index<Record, Compare>::first_path(const Root& r, Path& path) {
+  path.height = 0;
+  for (Page_id id = r.root;;) {
+    Page_ref p = cache.fetch(id, true);
+    if (header(p)->level == 0)
+      return;
+    path.page[path.height] = id;
+    path.slot[path.height] = 0;
+    ++path.height;
+    id = children(p)[0];
+  }
+}
+
+template <class Record, class Compare>
+void Paged_index<Record, Compare>::insert_child(Root& r, const Path& path, Record sep, Page_id child) {
+  // the new child goes right after the one at the slot of the path, sep between them
+  for (int d = path.height - 1; d >= 0; --d) {
+    Page_ref p = cache.fetch(path.page[d], true);
+    Page_header* h = header(p);
+    Record* seps = records(p);
+    Page_id* kids = children(p);
+    uint32_t c = path.slot[d];
+    if (h->count < inner_capacity) {
+      std::memmove(seps + c + 1, seps + c, (h->count - 1 - c) * sizeof(Record));
+      std::memmove(kids + c + 2, kids + c + 1, (h->count - 1 - c) * sizeof(Page_id));
+      seps[c] = sep;
+      kids[c + 1] = child;
+      ++h->count;
+      return;
+    }
+    std::vector<Record> all_seps(seps, seps + h->count - 1);
+    std::vector<Page_id> all_kids(kids, kids + h->count);
+    all_seps.insert(all_seps.begin() + c, sep);
+    all_kids.insert(all_kids.begin() + c + 1, child);
+    uint32_t left = static_cast<uint32_t>(all_kids.size() / 2);
+    Page_ref q = cache.allocate();
+    Page_header* qh = header(q);
+    qh->level = h->level;
+    qh->count = static_cast<uint32_t>(all_kids.size()) - left;
+    h->count = left;
+    std::copy(all_seps.begin(), all_seps.begin() + left - 1, seps);
+    std::copy(all_kids.begin(), all_kids.begin() + left, kids);
+    std::copy(all_seps.begin() + left, all_seps.end(), records(q));
+    std::copy(all_kids.begin() + left, all_kids.end(), children(q));
+    sep = all_seps[left - 1];
+    child = q.id();
+  }
+  Page_ref root = cache.allocate();
+  Page_header* h = header(root);
+  h->level = static_cast<uint32_t>(path.height) + 1;
+  h->count = 2;
+  records(root)[0] = sep;
+  children(root)[0] = r.root;
+  children(root)[1] = child;
+  r.root = root.id();
+}
+
+template <class Record, class Compare>
+void Paged_index<Record, Compare>::remove_leaf(Root& r, const Path& path, Page_ref&& leaf) {
+  Page_header* h = header(leaf);
+  assert(h->count == 0);
+  if (h->prev)
+    header(cache.fetch(h->prev, true))->next = h->next;
+  else
+    r.first = h->next;
+  if (h->next)
+    header(cache.fetch(h->next, true))->prev = h->prev;
+  cache.release(std::move(leaf));
+
+  int d = path.height - 1;
+  for (; d >= 0; --d) {
+    Page_ref p = cache.fetch(path.page[d], true);
+    Page_header* ph = header(p);
+    if (ph->count == 1) {
+      cache.release(std::move(p));
+      continue;
+    }
+    // drop the child and the separator on one side of it
+    uint32_t c = path.slot[d];
+    uint32_t s = c > 0 ? c - 1 : 0;
+    std::memmove(records(p) + s, records(p) + s + 1, (ph->count - 2 - s) * sizeof(Record));
+    std::memmove(children(p) + c, children(p) + c + 1, (ph->count - 1 - c) * sizeof(Page_id));
+    --ph->count;
+    break;
+  }
+  if (d < 0) {
+    r.root = 0;
+    return;
+  }
+  for (;;) {
+    Page_ref root = cache.fetch(r.root, true);
+    if (header(root)->level == 0 || header(root)->count > 1)
+      return;
+    r.root = children(root)[0];
+    cache.release(std::move(root));
+  }
+}
+
+template <class Record, class Compare>
+void Paged_index<Record, Compare>::update_front(Root& r) {
+  if (r.size > 0)
+    r.front = records(cache.fetch(r.first))[0];
+}
+
+template <class Record, class Compare>
+void Paged_index<Record, Compare>::small_records(const Root& r, std::vector<Record>& out) const {
+  if (r.size == 1) {
+    out.push_back(r.front);
+  } else if (in_chunk(r)) {
+    Page_ref p = cache.fetch_chunk(r.first);
+    const Record* rec = chunk_records(p, r.first);
+    out.insert(out.end(), rec, rec + r.size);
+  }
+}
+
+template <class Record, class Compare>
+void Paged_index<Record, Compare>::clear_small(Root& r) {
+  if (in_chunk(r))
+    cache.release_chunk(r.first);
+  r.first = 0;
+  r.size = 0;
+}
+
+template <class Record, class Compare>
+void Paged_index<Record, Compare>::shrink(Root& r) {
+  if (!r.root || r.root != r.first || r.size > std::max<uint32_t>(chunk_capacity / 2, 1))
+    return;
+  Page_ref p = cache.fetch(r.root);
+  std::vector<Record> rest(records(p), records(p) + header(p)->count);
+  cache.release(std::move(p));
+  r.root = r.first = 0;
+  r.size = 0;
+  assign_sorted(r, rest.data(), rest.data() + rest.size());
+}
+
+template <class Record, class Compare>
+void Paged_index<Record, Compare>::insert(Root& r, const Record& x) {
+  if (in_chunk(r) && r.size < chunk_capacity) {
+    Page_ref p = cache.fetch_chunk(r.first, true);
+    Record* rec = chunk_records(p, r.first);
+    uint32_t pos = static_cast<uint32_t>(std::lower_bound(rec, rec + r.size, x, cmp) - rec);
+    std::memmove(rec + pos + 1, rec + pos, (r.size - pos) * sizeof(Record));
+    rec[pos] = x;
+    ++r.size;
+    r.front = rec[0];
+    return;
+  }
+  if (!r.root) {
+    // the next size does not fit where the records are
+    std::vector<Record> all;
+    small_records(r, all);
+    all.insert(std::lower_bound(all.begin(), all.end(), x, cmp), x);
+    clear_small(r);
+    assign_sorted(r, all.data(), all.data() + all.size());
+    return;
+  }
+  Path path;
+  Page_ref leaf = descend(r.root, x, path, true);
+  Page_header* h = header(leaf);
+  uint32_t pos = static_cast<uint32_t>(std::lower_bound(records(leaf), records(leaf) + h->count, x, cmp) - records(leaf));
+  bool at_front = pos == 0 && leaf.id() == r.first;
+  if (h->count == leaf_capacity) {
+    uint32_t half = h->count / 2;
+    Page_ref right = cache.allocate();
+    Page_header* rh = header(right);
+    std::memcpy(records(right), records(leaf) + half, (h->count - half) * sizeof(Record));
+    rh->count = h->count - half;
+    h->count = half;
+    rh->prev = leaf.id();
+    rh->next = h->next;
+    if (h->next)
+      header(cache.fetch(h->next, true))->prev = right.id();
+    h->next = right.id();
+    Record sep = records(right)[0];
+    if (pos > half) {
+      leaf = right;
+      h = rh;
+      pos -= half;
+    }
+    Record* rec = records(leaf);
+    std::memmove(rec + pos + 1, rec + pos, (h->count - pos) * sizeof(Record));
+    rec[pos] = x;
+    ++h->count;
+    insert_child(r, path, sep, right.id());
+  } else {
+    Record* rec = records(leaf);
+    std::memmove(rec + pos + 1, rec + pos, (h->count - pos) * sizeof(Record));
+    rec[pos] = x;
+    ++h->count;
+  }
+  ++r.size;
+  if (at_front)
+    r.front = x;
+}
+
+template <class Record, class Compare>
+bool Paged_index<Record, Compare>::erase(Root& r, const Record& x) {
+  if (r.size == 1) {
+    if (cmp(x, r.front) || cmp(r.front, x))
+      return false;
+    r.size = 0;
+    return true;
+  }
+  if (in_chunk(r)) {
+    Page_ref p = cache.fetch_chunk(r.first, true);
+    Record* rec = chunk_records(p, r.first);
+    uint32_t pos = static_cast<uint32_t>(std::lower_bound(rec, rec + r.size, x, cmp) - rec);
+    if (pos == r.size || cmp(x, rec[pos]))
+      return false;
+    std::memmove(rec + pos, rec + pos + 1, (r.size - pos - 1) * sizeof(Record));
+    --r.size;
+    r.front = rec[0];
+    if (r.size == 1) {
+      cache.release_chunk(r.first);
+      r.first = 0;
+    }
+    return true;
+  }
+  if (!r.root)
+    return false;
+  Path path;
+  Page_ref leaf = descend(r.root, x, path, true);
+  uint32_t pos = static_cast<uint32_t>(std::lower_bound(records(leaf), records(leaf) + header(leaf)->count, x, cmp) - records(leaf));
+  // all records of the leaf are less than x, the next one starts with the first not less
+  if (pos == header(leaf)->count) {
+    if (!next_leaf(path, leaf, true))
+      return false;
+    pos = 0;
+  }
+  if (cmp(x, records(leaf)[pos]))
+    return false;
+  Page_header* h = header(leaf);
+  Record* rec = records(leaf);
+  std::memmove(rec + pos, rec + pos + 1, (h->count - pos - 1) * sizeof(Record));
+  --h->count;
+  --r.size;
+  if (h->count == 0) {
+    remove_leaf(r, path, std::move(leaf));
+    update_front(r);
+  } else if (pos == 0 && leaf.id() == r.first) {
+    r.front = rec[0];
+  }
+  leaf = Page_ref();
+  shrink(r);
+  return true;
+}
+
+template <class Record, class Compare>
+template <class Pred>
+void Paged_index<Record, Compare>::erase_prefix(Root& r, Pred pred, std::vector<Record>& out) {
+  if (r.size == 1) {
+    if (pred(r.front)) {
+      out.push_back(r.front);
+      r.size = 0;
+    }
+    return;
+  }
+  if (in_chunk(r)) {
+    Page_ref p = cache.fetch_chunk(r.first, true);
+    Record* rec = chunk_records(p, r.first);
+    uint32_t k = 0;
+    while (k < r.size && pred(rec[k]))
+      ++k;
+    out.insert(out.end(), rec, rec + k);
+    std::memmove(rec, rec + k, (r.size - k) * sizeof(Record));
+    r.size -= k;
+    r.front = rec[0];
+    if (r.size <= 1) {
+      cache.release_chunk(r.first);
+      r.first = 0;
+    }
+    return;
+  }
+  bool done = false;
+  while (r.size > 0 && !done) {
+    Page_ref leaf = cache.fetch(r.first, true);
+    Page_header* h = header(leaf);
+    Record* rec = records(leaf);
+    uint32_t k = 0;
+    while (k < h->count && pred(rec[k]))
+      ++k;
+    out.insert(out.end(), rec, rec + k);
+    r.size -= k;
+    if (k < h->count) {
+      std::memmove(rec, rec + k, (h->count - k) * sizeof(Record));
+      h->count -= k;
+      r.front = rec[0];
+      done = true;
+    } else {
+      h->count = 0;
+      Path path;
+      first_path(r, path);
+      remove_leaf(r, path, std::move(leaf));
+    }
+  }
+  shrink(r);
+}
+
+template <class Record, class Compare>
+void Paged_index<Record, Compare>::assign_sorted(Root& r, const Record* first, const Record* last) {
+  assert(r.size == 0);
+  if (first == last)
+    return;
+  r.size = static_cast<uint32_t>(last - first);
+  r.front = *first;
+  if (r.size == 1)
+    return;
+  if (r.size <= chunk_capacity) {
+    r.first = cache.allocate_chunk();
+    Page_ref p = cache.fetch_chunk(r.first, true);
+    std::memcpy(chunk_records(p, r.first), first, r.size * sizeof(Record));
+    return;
+  }
+  std::vector<Page_id> pages;
+  std::vector<Record> fronts;
+  Page_ref prev;
+  for (const Record* b = first; b != last;) {
+    uint32_t n = static_cast<uint32_t>(std::min<std::size_t>(last - b, leaf_capacity));
+    Page_ref p = cache.allocate();
+    header(p)->count = n;
+    std::memcpy(records(p), b, n * sizeof(Record));
+    if (prev) {
+      header(prev)->next = p.id();
+      header(p)->prev = prev.id();
+    }
+    pages.push_back(p.id());
+    fronts.push_back(*b);
+    prev = p;
+    b += n;
+  }
+  r.first = pages.front();
+  for (uint32_t level = 1; pages.size() > 1; ++level) {
+    std::vector<Page_id> up;
+    std::vector<Record> up_fronts;
+    for (std::size_t b = 0; b < pages.size(); b += inner_capacity) {
+      uint32_t n = static_cast<uint32_t>(std::min<std::size_t>(pages.size() - b, inner_capacity));
+      Page_ref p = cache.allocate();
+      header(p)->count = n;
+      header(p)->level = level;
+      std::copy(fronts.begin() + b + 1, fronts.begin() + b + n, records(p));
+      std::copy(pages.begin() + b, pages.begin() + b + n, children(p));
+      up.push_back(p.id());
+      up_fronts.push_back(fronts[b]);
+    }
+    pages.swap(up);
+    fronts.swap(up_fronts);
+  }
+  r.root = pages.front();
+}
+
+template <class Record, class Compare>
+template <class Fn>
+void Paged_index<Record, Compare>::scan(const Root& r, Fn fn) const {
+  if (r.size == 1) {
+    fn(r.front);
+    return;
+  }
+  if (in_chunk(r)) {
+    Page_ref p = cache.fetch_chunk(r.first);
+    const Record* rec = chunk_records(p, r.first);
+    for (uint32_t k = 0; k < r.size; ++k) {
+      if (!fn(rec[k]))
+        return;
+    }
+    return;
+  }
+  for (Page_id id = r.first; id;) {
+    Page_ref p = cache.fetch(id);
+    const Record* rec = records(p);
+    for (uint32_t k = 0; k < header(p)->count; ++k) {
+      if (!fn(rec[k]))
+        return;
+    }
+    id = header(p)->next;
+  }
+}
+
+template <class Record, class Compare>
+template <class Pred>
+std::size_t Paged_index<Record, Compare>::count_prefix(const Root& r, Pred pred) const {
+  std::size_t count = 0;
+  scan(r, [&](const Record& x) {
+    if (!pred(x))
+      return false;
+    ++count;
+    return true;
+  });
+  return count;
+}
+
+template <class Record, class Compare>
+const uint32_t Paged_index<Record, Compare>::leaf_capacity;
+
+template <class Record, class Compare>
+const uint32_t Paged_index<Record, Compare>::inner_capacity;
+
+template <class Record, class Compare>
+const uint32_t Paged_index<Record, Compare>::chunk_capacity;
+
+#endif // PAGED_INDEX_H
@@ -0,0 +1,864 @@
+#ifndef PAGED_INTERVAL_SKIP_LIST_H
+#define PAGED_INTERVAL_SKIP_LIST_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#include "Page_cache.h"
+#include "Paged_index.h"
+#include "Parallel_for.h"
+
+#include <boost/random/linear_congruential.hpp>
+
+// Interval skip list kept in the pages of a scratch file behind an LRU page cache, for sets
+// of intervals larger than memory. Same updates and stabbing queries as Interval_skip_list,
+// without handles.
+// A node of level l is promoted to level l + 1 with probability 1 / fanout instead of 1 / 2,
+// and the nodes of level l between two taller ones are stored together: the taller node on
+// the left keeps them in the directory of level l, a short chain of pages of node records.
+// A search reads one directory per level, so it loads O(log_B n) directory pages.
+// Intervals are placed as in Interval_skip_list, at the leftmost of the tallest nodes they
+// contain. Every node record carries the roots of its lbound and rbound indexes, B+-trees in
+// pages of the same cache, together with their first intervals. The first interval tells
+// whether a prefix of the index contains the query point, so a stabbing query reads index
+// pages only of nodes that report intervals.
+template <class Interval_>
+class Paged_interval_skip_list
+{
+public:
+  typedef Interval_ Interval;
+  typedef typename Interval::Value Value;
+
+private:
+  static_assert(std::is_trivially_copyable<Interval>::value, "intervals are stored in pages as raw memory");
+  static_assert(std::is_trivially_copyable<Value>::value, "keys are stored in pages as raw memory");
+
+  static const int max_level = 10;
+
+  struct inf_cmp {
+    bool operator()(const Interval& a, const Interval& b) const;
+  };
+  struct sup_cmp {
+    bool operator()(const Interval& a, const Interval& b) const;
+  };
+  typedef Paged_index<Interval, inf_cmp> Lbound_index;
+  typedef Paged_index<Interval, sup_cmp> Rbound_index;
+  typedef Paged_index_root<Interval> Index_root;
+
+  struct Node {
+    Value key;
+    uint32_t owner_count; // number of intervals with inf equal to key
+    uint32_t top;         // max_level for the header
+    Index_root lbound;    // ordered by inf_cmp
+    Index_root rbound;    // ordered by sup_cmp
+    Page_id down[max_level]; // directories of the levels below top, 0 when empty
+  };
+
+  // a directory page holds node records in key order and links to the next page of the chain
+  struct Dir_header {
+    uint32_t count;
+    Page_id next;
+  };
+  static_assert(sizeof(Dir_header) % alignof(Node) == 0, "directory header breaks node alignment");
+
+public:
+  static const uint32_t dir_capacity = (Page_cache::page_size - sizeof(Dir_header)) / sizeof(Node);
+  // mean number of nodes in a directory, half a page leaves room before the chain grows
+  static const uint32_t fanout = dir_capacity / 2 > 2 ? dir_capacity / 2 : 2;
+
+private:
+  // node record with the page holding it pinned, no page for the header
+  struct Node_ref {
+    Page_ref page;
+    Node* node = nullptr;
+  };
+
+  // search path for a key
+  struct Path {
+    Node_ref pred[max_level]; // node whose directory of level l takes the key
+    Node_ref succ[max_level]; // first node of level l or above with key not less, null at the end
+    bool own[max_level];      // succ is in the directory of level l of pred, not a taller node
+  };
+
+  mutable Page_cache cache; // queries load pages too
+  Node header;
+  std::size_t count;
+  boost::rand48 random;
+
+  static Dir_header* dir_header(const Page_ref& p) { return p.as<Dir_header>(); }
+  static Node* dir_nodes(const Page_ref& p) { return reinterpret_cast<Node*>(p.data() + sizeof(Dir_header)); }
+
+  // pages are fetched read-only while searching, a record change marks its page dirty
+  void mark_dirty(const Page_ref& p) {
+    if (p)
+      cache.fetch(p.id(), true);
+  }
+
+  Lbound_index lbound_index() const { return Lbound_index(cache); }
+  Rbound_index rbound_index() const { return Rbound_index(cache); }
+
+  int random_level();
+  // fills path and returns the level of the node with key k, -1 if there is none
+  int find_path(const Value& k, Path& path);
+
+  void place(const Node_ref& node, const Interval& i);
+  // move the prefix of an index of from whose intervals contain the key of to into to
+  void move_lbound(const Node_ref& from, const Node_ref& to);
+  void move_rbound(const Node_ref& from, const Node_ref& to);
+
+  // calls fn(node_ref) for the nodes of the directory of level l of owner with keys less than k
+  template <class Fn>
+  void for_each_before(const Node& owner, int l, const Value& k, Fn fn);
+  // cuts the directory of level l of owner before the first key greater than k, returns the rest
+  Page_id split_dir(const Node_ref& owner, int l, const Value& k);
+  void insert_dir(const Node_ref& owner, int l, const Node& node);
+  void erase_dir(const Node_ref& owner, int l, const Value& k);
+  // appends the chain starting at head to the directory of level l of owner
+  void concat_dir(const Node_ref& owner, int l, Page_id head);
+
+  void insert_node(const Interval& i, Path& path);
+  void remove_node(Path& path, int t);
+  void bulk_build(std::vector<Interval>& intervals);
+  void collect_all(const Node& v, std::vector<Interval>& out);
+
+  template <class Fn>
+  void scan_prefix(const Index_root& r, bool by_sup, const Value& value, Fn& fn) const;
+  // calls fn(interval) for the intervals containing value
+  template <class Fn>
+  void stab(const Value& value, Fn fn) const;
+
+public:
+  // scratch file in TMPDIR with a cache of ISL_PAGE_CACHE_BYTES
+  Paged_interval_skip_list();
+  // scratch file in dir with a cache of cache_bytes
+  explicit Paged_interval_skip_list(const std::string& dir, std::size_t cache_bytes = ISL_PAGE_CACHE_BYTES);
+  Paged_interval_skip_list(const Paged_interval_skip_list&) = delete;
+  Paged_interval_skip_list& operator=(const Paged_interval_skip_list&) = delete;
+
+  void seed(boost::rand48::result_type x0);
+
+  void insert(const Interval& i);
+  // a batch at least as large as the list rebuilds it from intervals sorted in memory
+  template <class InputIterator>
+  int insert(InputIterator b, InputIterator e);
+
+  bool remove(const Interval& i);
+
+  bool is_contained(const Value& value) const;
+  template <class OutputIterator>
+  OutputIterator find_intervals(const Value& value, OutputIterator out) const;
+  std::size_t count_intervals(const Value& value) const;
+
+  void clear();
+
+  int size() const;
+
+  const Page_cache::Stats& page_statistics() const { return cache.statistics(); }
+  void reset_page_statistics() { cache.reset_statistics(); }
+  // bytes of the page file
+  uint64_t file_size() const { return cache.file_size(); }
+};
+
+template <class Interval>
+bool Paged_interval_skip_list<Interval>::inf_cmp::operator()(const Interval& a, const Interval& b) const
+{
+  if (a.inf() != b.inf())
+    return a.inf() < b.inf();
+  if (a.inf_closed() != b.inf_closed())
+    return a.inf_closed();
+  if (a.sup() != b.sup())
+    return a.sup() > b.sup();
+  if (a.sup_closed() != b.sup_closed())
+    return a.sup_closed();
+  return false;
+}
+
+template <class Interval>
+bool Paged_interval_skip_list<Interval>::sup_cmp::operator()(const Interval& a, const Interval& b) const
+{
+  if (a.sup() != b.sup())
+    return a.sup() > b.sup();
+  if (a.sup_closed() != b.sup_closed())
+    return a.sup_closed();
+  if (a.inf() != b.inf())
+    return a.inf() < b.inf();
+  if (a.inf_closed() != b.inf_closed())
+    return a.inf_closed();
+  return false;
+}
+
+template <class Interval>
+Paged_interval_skip_list<Interval>::Paged_interval_skip_list()
+  : cache(Page_cache::scratch_dir())
+  , header()
+  , count(0)
+  , random(std::random_device()())
+{
+  header.top = max_level;
+}
+
+template <class Interval>
+Paged_interval_skip_list<Interval>::Paged_interval_skip_list(const std::string& dir, std::size_t cache_bytes)
+  : cache(dir, cache_bytes)
+  , header()
+  , count(0)
+  , random(std::random_device()())
+{
+  header.top = max_level;
+}
+
+template <class Interval>
+void Paged_interval_skip_list<Interval>::seed(boost::rand48::result_type x0) {
+  random.seed(x0);
+}
+
+template <class Interval>
+int Paged_interval_skip_list<Interval>::random_level() {
+  int lvl = 0;
+  while (lvl < max_level - 1 && random() % fanout == 0) {
+    ++lvl;
+  }
+  return lvl;
+}
+
+template <class Interval>
+int Paged_interval_skip_list<Interval>::find_path(const Value& k, Path& path) {
+  int found = -1;
+  Node_ref v{Page_ref(), &header};
+  Node_ref bound{Page_ref(), nullptr};
+  for (int l = max_level - 1; l >= 0; --l) {
+    path.pred[l] = v;
+    path.own[l] = false;
+    for (Page_id id = v.node->down[l]; id && !path.own[l];) {
+      Page_ref p = cache.fetch(id);
+      Node* nodes = dir_nodes(p);
+      uint32_t j = 0;
+      for (; j < dir_header(p)->count && nodes[j].key < k; ++j) {
+      }
+      if (j > 0) {
+        v = Node_ref{p, &nodes[j - 1]};
+      }
+      if (j < dir_header(p)->count) {
+        bound = Node_ref{p, &nodes[j]};
+        path.own[l] = true;
+        if (nodes[j].key == k) {
+          found = l;
+        }
+      }
+      id = dir_header(p)->next;
+    }
+    path.succ[l] = bound;
+  }
+  return found;
+}
+
+template <class Interval>
+void Paged_interval_skip_list<Interval>::place(const Node_ref& node, const Interval& i) {
+  mark_dirty(node.page);
+  lbound_index().insert(node.node->lbound, i);
+  rbound_index().insert(node.node->rbound, i);
+}
+
+template <class Interval>
+void Paged_interval_skip_list<Interval>::move_lbound(const Node_ref& from, const Node_ref& to) {
+  const Value& key = to.node->key;
+  if (from.node->lbound.size == 0 || !from.node->lbound.front.contains_or_inf(key)) {
+    return;
+  }
+  mark_dirty(from.page);
+  std::vector<Interval> moved;
+  lbound_index().erase_prefix(from.node->lbound, [&](const Interval& i) { return i.contains_or_inf(key); }, moved);
+  for (const Interval& i : moved) {
+    bool erased = rbound_index().erase(from.node->rbound, i);
+    assert(erased);
+    (void)erased;
+    place(to, i);
+  }
+}
+
+template <class Interval>
+void Paged_interval_skip_list<Interval>::move_rbound(const Node_ref& from, const Node_ref& to) {
+  const Value& key = to.node->key;
+  if (from.node->rbound.size == 0 || !from.node->rbound.front.contains_or_inf(key)) {
+    return;
+  }
+  mark_dirty(from.page);
+  std::vector<Interval> moved;
+  rbound_index().erase_prefix(from.node->rbound, [&](const Interval& i) { return i.contains_or_inf(key); }, moved);
+  for (const Interval& i : moved) {
+    bool erased = lbound_index().erase(from.node->lbound, i);
+    assert(erased);
+    (void)erased;
+    place(to, i);
+  }
+}
+
+template <class Interval>
+template <class Fn>
+void Paged_interval_skip_list<Interval>::for_each_before(const Node& owner, int l, const Value& k, Fn fn) {
+  for (Page_id id = owner.down[l]; id;) {
+    Page_ref p = cache.fetch(id);
+    Node* nodes = dir_nodes(p);
+    for (uint32_t j = 0; j < dir_header(p)->count; ++j) {
+      if (!(nodes[j].key < k)) {
+        return;
+      }
+      fn(Node_ref{p, &nodes[j]});
+    }
+    id = dir_header(p)->next;
+  }
+}
+
+template <class Interval>
+Page_id Paged_interval_skip_list<Interval>::split_dir(const Node_ref& owner, int l, const Value& k) {
+  Page_ref prev;
+  for (Page_id id = owner.node->down[l]; id;) {
+    Page_ref p = cache.fetch(id);
+    Dir_header* h = dir_header(p);
+    Node* nodes = dir_nodes(p);
+    uint32_t j = 0;
+    for (; j < h->count && nodes[j].key < k; ++j) {
+    }
+    if (j == 0) {
+      if (prev) {
+        mark_dirty(prev);
+        dir_header(prev)->next = 0;
+      } else {
+        mark_dirty(owner.page);
+        owner.node->down[l] = 0;
+      }
+      return id;
+    }
+    if (j < h->count) {
+      mark_dirty(p);
+      Page_ref q = cache.allocate();
+      std::memcpy(dir_nodes(q), nodes + j, (h->count - j) * sizeof(Node));
+      dir_header(q)->count = h->count - j;
+      dir_header(q)->next = h->next;
+      h->count = j;
+      h->next = 0;
+      return q.id();
+    }
+    prev = p;
+    id = h->next;
+  }
+  return 0;
+}
+
+template <class Interval>
+void Paged_interval_skip_list<Interval>::insert_dir(const Node_ref& owner, int l, const Node& node) {
+  if (!owner.node->down[l]) {
+    Page_ref p = cache.allocate();
+    dir_header(p)->count = 1;
+    dir_nodes(p)[0] = node;
+    mark_dirty(owner.page);
+    owner.node->down[l] = p.id();
+    return;
+  }
+  // the first page whose last key is greater, or the last page
+  Page_ref p = cache.fetch(owner.node->down[l]);
+  while (dir_nodes(p)[dir_header(p)->count - 1].key < node.key && dir_header(p)->next) {
+    p = cache.fetch(dir_header(p)->next);
+  }
+  mark_dirty(p);
+  Dir_header* h = dir_header(p);
+  uint32_t pos = 0;
+  for (; pos < h->count && dir_nodes(p)[pos].key < node.key; ++pos) {
+  }
+  if (h->count == dir_capacity) {
+    uint32_t half = h->count / 2;
+    Page_ref q = cache.allocate();
+    std::memcpy(dir_nodes(q), dir_nodes(p) + half, (h->count - half) * sizeof(Node));
+    dir_header(q)->count = h->count - half;
+    dir_header(q)->next = h->next;
+    h->count = half;
+    h->next = q.id();
+    if (pos > half) {
+      p = q;
+      h = dir_header(p);
+      pos -= half;
+    }
+  }
+  Node* nodes = dir_nodes(p);
+  std::memmove(nodes + pos + 1, nodes + pos, (h->count - pos) * sizeof(Node));
+  nodes[pos] = node;
+  ++h->count;
+}
+
+template <class Interval>
+void Paged_interval_skip_list<Interval>::erase_dir(const Node_ref& owner, int l, const Value& k) {
+  Page_ref prev;
+  for (Page_id id = owner.node->down[l]; id;) {
+    Page_ref p = cache.fetch(id);
+    Dir_header* h = dir_header(p);
+    Node* nodes = dir_nodes(p);
+    for (uint32_t j = 0; j < h->count; ++j) {
+      if (nodes[j].key == k) {
+        mark_dirty(p);
+        std::memmove(nodes + j, nodes + j + 1, (h->count - j - 1) * sizeof(Node));
+        if (--h->count == 0) {
+          if (prev) {
+            mark_dirty(prev);
+            dir_header(prev)->next = h->next;
+          } else {
+            mark_dirty(owner.page);
+            owner.node->down[l] = h->next;
+          }
+          cache.release(std::move(p));
+        }
+        return;
+      }
+    }
+    prev = p;
+    id = h->next;
+  }
+  assert(false); // no node with key k
+}
+
+template <class Interval>
+void Paged_interval_skip_list<Interval>::concat_dir(const Node_ref& owner, int l, Page_id head) {
+  if (!head) {
+    return;
+  }
+  if (!owner.node->down[l]) {
+    mark_dirty(owner.page);
+    owner.node->down[l] = head;
+    return;
+  }
+  Page_ref tail = cache.fetch(owner.node->down[l]);
+  while (dir_header(tail)->next) {
+    tail = cache.fetch(dir_header(tail)->next);
+  }
+  mark_dirty(tail);
+  Page_ref first = cache.fetch(head);
+  Dir_header* th = dir_header(tail);
+  Dir_header* fh = dir_header(first);
+  if (th->count + fh->count <= dir_capacity) {
+    std::memcpy(dir_nodes(tail) + th->count, dir_nodes(first), fh->count * sizeof(Node));
+    th->count += fh->count;
+    th->next = fh->next;
+    cache.release(std::move(first));
+  } else {
+    th->next = head;
+  }
+}
+
+template <class Interval>
+void Paged_interval_skip_list<Interval>::insert(const Interval& i) {
+  Path path;
+  int t = find_path(i.inf(), path);
+  if (t < 0) {
+    insert_node(i, path);
+  } else {
+    // the node of inf takes the interval unless a taller node on the path does
+    mark_dirty(path.succ[t].page);
+    ++path.succ[t].node->owner_count;
+    for (int l = max_level - 1; l >= t; --l) {
+      Node* s = path.succ[l].node;
+      if (s && i.contains_or_inf(s->key)) {
+        place(path.succ[l], i);
+        break;
+      }
+    }
+  }
+  ++count;
+}
+
+// same steps as inserting a node into the interval skip list. The nodes passed on a level
+// are the ones of the directory of pred with keys less than inf, the next node is succ
+// when it is in that directory
+template <class Interval>
+void Paged_interval_skip_list<Interval>::insert_node(const Interval& i, Path& path) {
+  const Value& lbound = i.inf();
+  int lvl = random_level();
+  Node node = Node();
+  node.key = lbound;
+  node.owner_count = 1;
+  node.top = lvl;
+  const Node_ref node_ref{Page_ref(), &node};
+
+  // phase 1: the first taller node on the path that the interval contains
+  bool placed = false;
+  for (int l = max_level - 1; l > lvl && !placed; --l) {
+    Node* s = path.succ[l].node;
+    if (s && i.contains_or_inf(s->key)) {
+      place(path.succ[l], i);
+      placed = true;
+    }
+  }
+  if (!placed) {
+    place(node_ref, i);
+  }
+  if (path.own[lvl]) {
+    // node of the same height right to the new one
+    move_lbound(path.succ[lvl], node_ref);
+  }
+
+  // phase 2: steal from the nodes below the new one
+  for (int l = lvl - 1; l >= 0; --l) {
+    for_each_before(*path.pred[l].node, l, lbound, [&](const Node_ref& v) { move_rbound(v, node_ref); });
+    if (path.own[l]) {
+      move_lbound(path.succ[l], node_ref);
+    }
+  }
+
+  // the nodes below the new one and right of it move to its directories, records left of it
+  // keep their place so the pred nodes stay valid
+  for (int l = lvl - 1; l >= 0; --l) {
+    node.down[l] = split_dir(path.pred[l], l, lbound);
+  }
+  insert_dir(path.pred[lvl], lvl, node);
+}
+
+template <class Interval>
+template <class InputIterator>
+int Paged_interval_skip_list<Interval>::insert(InputIterator b, InputIterator e) {
+  std::vector<Interval> intervals(b, e);
+  int inserted = static_cast<int>(intervals.size());
+  if (intervals.size() < count) {
+    for (const Interval& i : intervals) {
+      insert(i);
+    }
+    return inserted;
+  }
+  if (count > 0) {
+    collect_all(header, intervals);
+    cache.clear();
+    header = Node();
+    header.top = max_level;
+  }
+  count = intervals.size();
+  bulk_build(intervals);
+  return inserted;
+}
+
+template <class Interval>
+void Paged_interval_skip_list<Interval>::collect_all(const Node& v, std::vector<Interval>& out) {
+  for (uint32_t l = 0; l < v.top; ++l) {
+    for (Page_id id = v.down[l]; id;) {
+      Page_ref p = cache.fetch(id);
+      for (uint32_t j = 0; j < dir_header(p)->count; ++j) {
+        const Node& u = dir_nodes(p)[j];
+        lbound_index().scan(u.lbound, [&](const Interval& i) {
+          out.push_back(i);
+          return true;
+        });
+        collect_all(u, out);
+      }
+      id = dir_header(p)->next;
+    }
+  }
+}
+
+template <class Interval>
+void Paged_interval_skip_list<Interval>::bulk_build(std::vector<Interval>& intervals) {
+  inf_cmp inf_less;
+  parallel_sort(intervals.begin(), intervals.end(), inf_less);
+
+  // distinct infs with their heights
+  std::vector<Value> keys;
+  std::vector<uint8_t> tops;
+  std::vector<uint32_t> owner_counts;
+  std::vector<uint32_t> owners(intervals.size());
+  for (std::size_t i = 0; i < intervals.size(); ++i) {
+    if (i == 0 || intervals[i].inf() != intervals[i - 1].inf()) {
+      keys.push_back(intervals[i].inf());
+      tops.push_back(static_cast<uint8_t>(random_level()));
+      owner_counts.push_back(0);
+    }
+    ++owner_counts.back();
+    owners[i] = static_cast<uint32_t>(keys.size() - 1);
+  }
+  // next key of at least the same height, where the top forward pointer of a node leads
+  const uint32_t key_count = static_cast<uint32_t>(keys.size());
+  std::vector<uint32_t> next(key_count);
+  std::vector<uint32_t> stack;
+  for (uint32_t s = key_count; s-- > 0;) {
+    while (!stack.empty() && tops[stack.back()] < tops[s]) {
+      stack.pop_back();
+    }
+    next[s] = stack.empty() ? key_count : stack.back();
+    stack.push_back(s);
+  }
+
+  // the interval goes to the leftmost of the tallest keys it contains,
+  // climbing from its inf by top level pointers visits every new maximum height
+  const std::size_t block = 4096;
+  parallel_for((intervals.size() + block - 1) / block, [&](std::size_t b) {
+    for (std::size_t k = b * block; k < std::min(intervals.size(), (b + 1) * block); ++k) {
+      uint32_t best = owners[k];
+      for (uint32_t s = best; next[s] < key_count && intervals[k].contains(keys[next[s]]);) {
+        s = next[s];
+        if (tops[s] > tops[best]) {
+          best = s;
+        }
+      }
+      owners[k] = best;
+    }
+  });
+  std::vector<uint32_t> order(intervals.size());
+  for (uint32_t k = 0; k < order.size(); ++k) {
+    order[k] = k;
+  }
+  parallel_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+    if (owners[a] != owners[b]) {
+      return owners[a] < owners[b];
+    }
+    return inf_less(intervals[a], intervals[b]);
+  });
+
+  // nodes in key order, each appended to the directory of its level in the node that
+  // was the last taller one. Directories are filled up, later inserts split them
+  Page_id owner_page[max_level]; // 0 for the header
+  uint32_t owner_slot[max_level];
+  Page_id tail[max_level];
+  std::fill(owner_page, owner_page + max_level, 0);
+  std::fill(tail, tail + max_level, 0);
+  std::vector<Interval> lb, rb;
+  std::size_t run = 0;
+  for (uint32_t s = 0; s < key_count; ++s) {
+    Node node = Node();
+    node.key = keys[s];
+    node.owner_count = owner_counts[s];
+    node.top = tops[s];
+    lb.clear();
+    for (; run < order.size() && owners[order[run]] == s; ++run) {
+      lb.push_back(intervals[order[run]]);
+    }
+    rb = lb;
+    std::sort(rb.begin(), rb.end(), sup_cmp());
+    lbound_index().assign_sorted(node.lbound, lb.data(), lb.data() + lb.size());
+    rbound_index().assign_sorted(node.rbound, rb.data(), rb.data() + rb.size());
+
+    int t = tops[s];
+    Page_ref p;
+    if (tail[t]) {
+      p = cache.fetch(tail[t], true);
+    }
+    if (!p || dir_header(p)->count == dir_capacity) {
+      Page_ref q = cache.allocate();
+      if (p) {
+        dir_header(p)->next = q.id();
+      } else if (owner_page[t]) {
+        dir_nodes(cache.fetch(owner_page[t], true))[owner_slot[t]].down[t] = q.id();
+      } else {
+        header.down[t] = q.id();
+      }
+      p = q;
+      tail[t] = q.id();
+    }
+    uint32_t slot = dir_header(p)->count++;
+    dir_nodes(p)[slot] = node;
+    for (int l = 0; l < t; ++l) {
+      owner_page[l] = p.id();
+      owner_slot[l] = slot;
+      tail[l] = 0;
+    }
+  }
+}
+
+template <class Interval>
+bool Paged_interval_skip_list<Interval>::remove(const Interval& i) {
+  Path path;
+  int t = find_path(i.inf(), path);
+  if (t < 0) {
+    return false;
+  }
+  const Node_ref* holder = nullptr;
+  for (int l = max_level - 1; l >= t && !holder; --l) {
+    Node* s = path.succ[l].node;
+    if (s && i.contains_or_inf(s->key)) {
+      holder = &path.succ[l];
+    }
+  }
+  assert(holder);
+  if (!lbound_index().erase(holder->node->lbound, i)) {
+    return false;
+  }
+  mark_dirty(holder->page);
+  bool erased = rbound_index().erase(holder->node->rbound, i);
+  assert(erased);
+  (void)erased;
+  --count;
+  mark_dirty(path.succ[t].page);
+  if (--path.succ[t].node->owner_count == 0) {
+    remove_node(path, t);
+  }
+  return true;
+}
+
+// same steps as removing a node from the interval skip list, then the directories
+// of the removed node join the ones of the nodes left of it
+template <class Interval>
+void Paged_interval_skip_list<Interval>::remove_node(Path& path, int t) {
+  Node_ref rm_ref = path.succ[t];
+  Node& rm_node = *rm_ref.node;
+  const Value key = rm_node.key;
+
+  // the next node of level t is the one after rm_node in its directory or the next taller one
+  Node_ref next;
+  bool after = false;
+  for (Page_id id = path.pred[t].node->down[t]; id && !next.node;) {
+    Page_ref p = cache.fetch(id);
+    for (uint32_t j = 0; j < dir_header(p)->count; ++j) {
+      if (after) {
+        next = Node_ref{p, &dir_nodes(p)[j]};
+        break;
+      }
+      after = dir_nodes(p)[j].key == key;
+    }
+    id = dir_header(p)->next;
+  }
+  if (!next.node && t + 1 < max_level) {
+    next = path.succ[t + 1];
+  }
+  if (next.node) {
+    move_rbound(rm_ref, next);
+  }
+  for (int l = t - 1; l >= 0; --l) {
+    for_each_before(*path.pred[l].node, l, key, [&](const Node_ref& v) { move_lbound(rm_ref, v); });
+    if (rm_node.down[l]) {
+      Page_ref p = cache.fetch(rm_node.down[l]);
+      move_rbound(rm_ref, Node_ref{p, &dir_nodes(p)[0]});
+    }
+  }
+  assert(rm_node.lbound.size == 0 && rm_node.rbound.size == 0);
+  next = Node_ref();
+
+  for (int l = t - 1; l >= 0; --l) {
+    concat_dir(path.pred[l], l, rm_node.down[l]);
+  }
+  // the page of rm_node may go away, only its owner stays pinned
+  Node_ref owner = path.pred[t];
+  rm_ref = Node_ref();
+  for (int l = 0; l < max_level; ++l) {
+    path.pred[l] = path.succ[l] = Node_ref();
+  }
+  erase_dir(owner, t, key);
+}
+
+// calls fn(interval) for the prefix of an index whose intervals contain value
+template <class Interval>
+template <class Fn>
+void Paged_interval_skip_list<Interval>::scan_prefix(const Index_root& r, bool by_sup, const Value& value, Fn& fn) const {
+  if (r.size == 0 || !r.front.contains(value)) {
+    return;
+  }
+  auto report = [&](const Interval& i) {
+    if (!i.contains(value)) {
+      return false;
+    }
+    fn(i);
+    return true;
+  };
+  if (by_sup) {
+    rbound_index().scan(r, report);
+  } else {
+    lbound_index().scan(r, report);
+  }
+}
+
+template <class Interval>
+bool Paged_interval_skip_list<Interval>::is_contained(const Value& value) const {
+  // the first interval of an index decides, no index page is read
+  const Node* v = &header;
+  Page_ref v_page;
+  for (int l = max_level - 1; l >= 0; --l) {
+    for (Page_id id = v->down[l]; id;) {
+      Page_ref p = cache.fetch(id);
+      const Node* nodes = dir_nodes(p);
+      uint32_t j = 0;
+      for (; j < dir_header(p)->count && nodes[j].key < value; ++j) {
+        if (nodes[j].rbound.size && nodes[j].rbound.front.contains(value))
+          return true;
+      }
+      if (j > 0) {
+        v = &nodes[j - 1];
+        v_page = p;
+      }
+      if (j < dir_header(p)->count) {
+        if (nodes[j].lbound.size && nodes[j].lbound.front.contains(value))
+          return true;
+        if (nodes[j].key == value)
+          return false;
+        break;
+      }
+      id = dir_header(p)->next;
+    }
+  }
+  return false;
+}
+
+template <class Interval>
+template <class Fn>
+void Paged_interval_skip_list<Interval>::stab(const Value& value, Fn fn) const {
+  const Node* v = &header;
+  Page_ref v_page;
+  for (int l = max_level - 1; l >= 0; --l) {
+    for (Page_id id = v->down[l]; id;) {
+      Page_ref p = cache.fetch(id);
+      const Node* nodes = dir_nodes(p);
+      uint32_t j = 0;
+      for (; j < dir_header(p)->count && nodes[j].key < value; ++j) {
+        scan_prefix(nodes[j].rbound, true, value, fn);
+      }
+      if (j > 0) {
+        v = &nodes[j - 1];
+        v_page = p;
+      }
+      if (j < dir_header(p)->count) {
+        // for the node with key == value, intervals with open inf at value are cut off by lbound
+        scan_prefix(nodes[j].lbound, false, value, fn);
+        if (nodes[j].key == value)
+          return;
+        break;
+      }
+      id = dir_header(p)->next;
+    }
+  }
+}
+
+template <class Interval>
+template <class OutputIterator>
+OutputIterator Paged_interval_skip_list<Interval>::find_intervals(const Value& value, OutputIterator out) const {
+  stab(value, [&](const Interval& i) {
+    out = i;
+    ++out;
+  });
+  return out;
+}
+
+template <class Interval>
+std::size_t Paged_interval_skip_list<Interval>::count_intervals(const Value& value) const {
+  std::size_t n = 0;
+  stab(value, [&](const Interval&) { ++n; });
+  return n;
+}
+
+template <class Interval>
+void Paged_interval_skip_list<Interval>::clear() {
+  cache.clear();
+  header = Node();
+  header.top = max_level;
+  count = 0;
+}
+
+template <class Interval>
+int Paged_interval_skip_list<Interval>::size() const {
+  return static_cast<int>(count);
+}
+
+template <class Interval>
+const uint32_t Paged_interval_skip_list<Interval>::dir_capacity;
+
+template <class Interval>
+const uint32_t Paged_interval_skip_list<Interval>::fanout;
+
+#endif // PAGED_INTERVAL_SKIP_LIST_H
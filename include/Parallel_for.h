@@ -0,0 +1,96 @@
+#ifndef PARALLEL_FOR_H
+#define PARALLEL_FOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <thread>
+#include <vector>
+
+#ifndef ISL_MAX_THREADS
+#define ISL_MAX_THREADS 0 // 0 means std::thread::hardware_concurrency()
+#endif
+
+inline std::size_t parallel_workers()
+{
+  std::size_t n = ISL_MAX_THREADS > 0 ? ISL_MAX_THREADS : std::thread::hardware_concurrency();
+  return std::max<std::size_t>(n, 1);
+}
+
+// set on the threads of a running parallel_for, nested calls run on the calling thread
+inline bool& in_parallel_for()
+{
+  thread_local bool inside = false;
+  return inside;
+}
+
+// calls fn(i) for every i in [0, n) on up to parallel_workers() threads including the calling one,
+// tasks are handed out one by one so uneven tasks balance themselves
+template <class Fn>
+void parallel_for(std::size_t n, Fn fn)
+{
+  std::size_t workers = in_parallel_for() ? 1 : std::min(n, parallel_workers());
+  if (workers <= 1) {
+    for (std::size_t i = 0; i < n; ++i) {
+      fn(i);
+    }
+    return;
+  }
+  std::atomic<std::size_t> next(0);
+  auto work = [&]() {
+    in_parallel_for() = true;
+    for (std::size_t i; (i = next.fetch_add(1)) < n;) {
+      fn(i);
+    }
+    in_parallel_for() = false;
+  };
+  std::vector<std::thread> threads;
+  threads.reserve(workers - 1);
+  for (std::size_t w = 1; w < workers; ++w) {
+    threads.emplace_back(work);
+  }
+  work();
+  for (std::thread& t : threads) {
+    t.join();
+  }
+}
+
+#ifndef ISL_PARALLEL_SORT_MIN
+#define ISL_PARALLEL_SORT_MIN 32768 // shorter ranges are sorted by the calling thread
+#endif
+
+// sorts chunks of the range in parallel and merges them pairwise, each round of merges in parallel
+template <class RandomAccessIterator, class Compare>
+void parallel_sort(RandomAccessIterator first, RandomAccessIterator last, Compare cmp)
+{
+  typedef typename std::iterator_traits<RandomAccessIterator>::value_type T;
+  std::size_t n = last - first;
+  std::size_t chunks = 1;
+  while (!in_parallel_for() && chunks < parallel_workers() && n / (chunks * 2) >= ISL_PARALLEL_SORT_MIN / 2)
+    chunks *= 2;
+  if (chunks == 1) {
+    std::sort(first, last, cmp);
+    return;
+  }
+  auto bound = [&](std::size_t c) { return n / chunks * c + std::min(c, n % chunks); };
+  parallel_for(chunks, [&](std::size_t c) {
+    std::sort(first + bound(c), first + bound(c + 1), cmp);
+  });
+  std::vector<T> buffer(n);
+  bool in_buffer = false;
+  for (std::size_t width = 1; width < chunks; width *= 2) {
+    parallel_for(chunks / (width * 2), [&](std::size_t m) {
+      std::size_t b = bound(2 * m * width), mid = bound((2 * m + 1) * width), e = bound((2 * m + 2) * width);
+      if (in_buffer)
+        std::merge(buffer.begin() + b, buffer.begin() + mid, buffer.begin() + mid, buffer.begin() + e, first + b, cmp);
+      else
+        std::merge(first + b, first + mid, first + mid, first + e, buffer.begin() + b, cmp);
+    });
+    in_buffer = !in_buffer;
+  }
+  if (in_buffer)
+    std::copy(buffer.begin(), buffer.end(), first);
+}
+
+#endif // PARALLEL_FOR_H
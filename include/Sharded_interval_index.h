@@ -0,0 +1,461 @@
+#ifndef SHARDED_INTERVAL_INDEX_H
+#define SHARDED_INTERVAL_INDEX_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <utility>
+#include <vector>
+
+#include "Interval_cartesian_tree.h"
+#include "Interval_skip_list.h"
+#include "Parallel_for.h"
+
+#ifndef ISL_SHARD_IMBALANCE
+#define ISL_SHARD_IMBALANCE 2 // rebalance when a shard grows this many times over the average
+#endif
+
+#ifndef ISL_SHARD_MIN_SIZE
+#define ISL_SHARD_MIN_SIZE 4096 // shards smaller than this never trigger a rebalance
+#endif
+
+#ifndef ISL_SHARD_CHECK_PERIOD
+#define ISL_SHARD_CHECK_PERIOD 65536 // single updates between two balance checks
+#endif
+
+// Interval index split by key ranges into shards, each one an Index_ under its own lock,
+// so updates and queries in different ranges run in parallel.
+// Shard s covers keys [bounds[s - 1], bounds[s]). An interval is stored in every shard it overlaps,
+// a stabbing query therefore asks a single shard and a window query reports an interval
+// only from the first shard where it meets the window.
+// Shard bounds follow the quantiles of the interval infs and are recomputed when the shards drift apart.
+// A single update locks all shards the interval spans, in ascending order, so it is atomic across them.
+// A batch insert fills the shards one by one.
+template <class Interval_, template <class> class Index_ = Interval_skip_list>
+class Sharded_interval_index
+{
+public:
+  typedef Interval_ Interval;
+  typedef typename Interval::Value Value;
+  typedef Index_<Interval> Index;
+
+private:
+  struct Shard {
+    mutable std::shared_timed_mutex mutex;
+    Index index;
+  };
+
+  // the shard layout is read locked by every operation and write locked by rebalance()
+  mutable std::shared_timed_mutex layout;
+  std::vector<Value> bounds;
+  std::vector<std::unique_ptr<Shard>> shards;
+  std::size_t max_shards;
+  std::atomic<std::size_t> count;
+  std::atomic<std::size_t> updates;      // intervals inserted or removed so far
+  std::atomic<std::size_t> rebalanced_at; // updates at the last rebalance
+  bool seeded;
+  boost::rand48::result_type seed_value;
+
+  std::size_t shard_of(const Value& v) const;
+  // shards with a point of the interval from l to r, [first, last]
+  std::pair<std::size_t, std::size_t> shards_of(const Value& l, const Value& r, bool lb, bool rb) const;
+  std::pair<std::size_t, std::size_t> shards_of(const Interval& i) const;
+  // write locks shards [first, last] in ascending order, the caller holds the layout lock
+  std::vector<std::unique_lock<std::shared_timed_mutex>> lock_shards(std::pair<std::size_t, std::size_t> range) const;
+  void make_shards(std::size_t n);
+  template <class ForwardIterator>
+  void fill_shards(ForwardIterator b, ForwardIterator e);
+  bool is_unbalanced() const;
+  void maybe_rebalance();
+  void rebalance_impl();
+
+  template <class OutputIterator>
+  struct Offset_output {
+    OutputIterator out;
+    std::size_t offset;
+
+    template <class Pair>
+    Offset_output& operator=(const Pair& p) {
+      out = std::make_pair(p.first + offset, p.second);
+      ++out;
+      return *this;
+    }
+    Offset_output& operator*() { return *this; }
+    Offset_output& operator++() { return *this; }
+    Offset_output& operator++(int) { return *this; }
+  };
+
+public:
+  // max_shards == 0 takes one shard per hardware thread
+  explicit Sharded_interval_index(std::size_t max_shards = 0);
+  template <class InputIterator>
+  Sharded_interval_index(InputIterator b, InputIterator e, std::size_t max_shards = 0);
+  Sharded_interval_index(const Sharded_interval_index&) = delete;
+  Sharded_interval_index& operator=(const Sharded_interval_index&) = delete;
+
+  void seed(boost::rand48::result_type x0);
+
+  void insert(const Interval& i);
+  // spreads the batch over the shards and loads them in parallel
+  template <class InputIterator>
+  int insert(InputIterator b, InputIterator e);
+  bool remove(const Interval& I);
+  void clear();
+  // recomputes shard bounds from the current intervals and reloads all shards
+  void rebalance();
+
+  bool is_contained(const Value& value) const;
+  template <class OutputIterator>
+  OutputIterator find_intervals(const Value& value, OutputIterator out) const;
+  template <class RandomAccessIterator, class OutputIterator>
+  OutputIterator find_intervals_sorted(RandomAccessIterator qb, RandomAccessIterator qe, OutputIterator out) const;
+  template <class OutputIterator>
+  OutputIterator find_overlapping(const Value& l, const Value& r, bool lb, bool rb, OutputIterator out) const;
+  std::size_t count_intervals(const Value& value) const;
+  std::size_t count_overlapping(const Value& l, const Value& r, bool lb, bool rb) const;
+
+  int size() const;
+  std::size_t shard_count() const;
+};
+
+template <class Interval>
+using Sharded_interval_skip_list = Sharded_interval_index<Interval, Interval_skip_list>;
+
+template <class Interval>
+using Sharded_interval_cartesian_tree = Sharded_interval_index<Interval, Interval_cartesian_tree>;
+
+template <class Interval_, template <class> class Index_>
+Sharded_interval_index<Interval_, Index_>::Sharded_interval_index(std::size_t max_shards)
+  : max_shards(max_shards > 0 ? max_shards : parallel_workers()), count(0), updates(0), rebalanced_at(0),
+    seeded(false), seed_value(0)
+{
+  make_shards(1);
+}
+
+template <class Interval_, template <class> class Index_>
+template <class InputIterator>
+Sharded_interval_index<Interval_, Index_>::Sharded_interval_index(InputIterator b, InputIterator e, std::size_t max_shards)
+  : Sharded_interval_index(max_shards)
+{
+  insert(b, e);
+}
+
+template <class Interval_, template <class> class Index_>
+void Sharded_interval_index<Interval_, Index_>::seed(boost::rand48::result_type x0)
+{
+  std::unique_lock<std::shared_timed_mutex> lock(layout);
+  seeded = true;
+  seed_value = x0;
+  for (std::size_t s = 0; s < shards.size(); ++s) {
+    shards[s]->index.seed(x0 + s);
+  }
+}
+
+template <class Interval_, template <class> class Index_>
+std::size_t Sharded_interval_index<Interval_, Index_>::shard_of(const Value& v) const
+{
+  return std::upper_bound(bounds.begin(), bounds.end(), v) - bounds.begin();
+}
+
+template <class Interval_, template <class> class Index_>
+std::pair<std::size_t, std::size_t>
+Sharded_interval_index<Interval_, Index_>::shards_of(const Value& l, const Value& r, bool lb, bool rb) const
+{
+  std::size_t first = shard_of(l);
+  std::size_t last = shard_of(r);
+  // an open end at a shard bound does not reach into the shard starting there,
+  // an empty interval is kept where its inf is
+  if (last > first && !rb && r == bounds[last - 1])
+    --last;
+  if (l == r && !(lb && rb))
+    last = first;
+  return std::make_pair(first, last);
+}
+
+template <class Interval_, template <class> class Index_>
+std::pair<std::size_t, std::size_t>
+Sharded_interval_index<Interval_, Index_>::shards_of(const Interval& i) const
+{
+  return shards_of(i.inf(), i.sup(), i.inf_closed(), i.sup_closed());
+}
+
+template <class Interval_, template <class> class Index_>
+std::vector<std::unique_lock<std::shared_timed_mutex>>
+Sharded_interval_index<Interval_, Index_>::lock_shards(std::pair<std::size_t, std::size_t> range) const
+{
+  std::vector<std::unique_lock<std::shared_timed_mutex>> locks;
+  locks.reserve(range.second - range.first + 1);
+  for (std::size_t s = range.first; s <= range.second; ++s) {
+    locks.emplace_back(shards[s]->mutex);
+  }
+  return locks;
+}
+
+template <class Interval_, template <class> class Index_>
+void Sharded_interval_index<Interval_, Index_>::make_shards(std::size_t n)
+{
+  shards.clear();
+  for (std::size_t s = 0; s < n; ++s) {
+    shards.emplace_back(new Shard);
+    if (seeded)
+      shards.back()->index.seed(seed_value + s);
+  }
+}
+
+// bulk loads the shards, the caller holds the layout lock
+template <class Interval_, template <class> class Index_>
+template <class ForwardIterator>
+void Sharded_interval_index<Interval_, Index_>::fill_shards(ForwardIterator b, ForwardIterator e)
+{
+  std::vector<std::vector<Interval>> parts(shards.size());
+  for (ForwardIterator it = b; it != e; ++it) {
+    auto range = shards_of(*it);
+    for (std::size_t s = range.first; s <= range.second; ++s) {
+      parts[s].push_back(*it);
+    }
+  }
+  parallel_for(shards.size(), [&](std::size_t s) {
+    std::unique_lock<std::shared_timed_mutex> lock(shards[s]->mutex);
+    shards[s]->index.insert(parts[s].begin(), parts[s].end());
+  });
+}
+
+// a rebalance reloads everything, so at least count / 2 updates must pass between two of them
+template <class Interval_, template <class> class Index_>
+bool Sharded_interval_index<Interval_, Index_>::is_unbalanced() const
+{
+  if (updates.load() - rebalanced_at.load() < count.load() / 2)
+    return false;
+  std::size_t largest = 0;
+  std::size_t stored = 0;
+  for (const auto& shard : shards) {
+    std::shared_lock<std::shared_timed_mutex> lock(shard->mutex);
+    largest = std::max<std::size_t>(largest, shard->index.size());
+    stored += shard->index.size();
+  }
+  if (largest < ISL_SHARD_MIN_SIZE)
+    return false;
+  return shards.size() < max_shards || largest > ISL_SHARD_IMBALANCE * stored / shards.size();
+}
+
+template <class Interval_, template <class> class Index_>
+void Sharded_interval_index<Interval_, Index_>::maybe_rebalance()
+{
+  {
+    std::shared_lock<std::shared_timed_mutex> lock(layout);
+    if (!is_unbalanced())
+      return;
+  }
+  std::unique_lock<std::shared_timed_mutex> lock(layout);
+  if (is_unbalanced())
+    rebalance_impl();
+}
+
+template <class Interval_, template <class> class Index_>
+void Sharded_interval_index<Interval_, Index_>::rebalance()
+{
+  std::unique_lock<std::shared_timed_mutex> lock(layout);
+  rebalance_impl();
+}
+
+// every interval is collected once, from the shard of its inf
+template <class Interval_, template <class> class Index_>
+void Sharded_interval_index<Interval_, Index_>::rebalance_impl()
+{
+  std::vector<Interval> intervals;
+  intervals.reserve(count.load());
+  for (std::size_t s = 0; s < shards.size(); ++s) {
+    for (const Interval& i : shards[s]->index) {
+      if (shard_of(i.inf()) == s)
+        intervals.push_back(i);
+    }
+  }
+  std::vector<Value> infs;
+  infs.reserve(intervals.size());
+  for (const Interval& i : intervals) {
+    infs.push_back(i.inf());
+  }
+  std::sort(infs.begin(), infs.end());
+  bounds.clear();
+  for (std::size_t s = 1; s < max_shards && !infs.empty(); ++s) {
+    const Value& q = infs[s * infs.size() / max_shards];
+    if (bounds.empty() ? infs.front() < q : bounds.back() < q)
+      bounds.push_back(q);
+  }
+  make_shards(bounds.size() + 1);
+  fill_shards(intervals.begin(), intervals.end());
+  rebalanced_at = updates.load();
+}
+
+template <class Interval_, template <class> class Index_>
+void Sharded_interval_index<Interval_, Index_>::insert(const Interval& i)
+{
+  {
+    std::shared_lock<std::shared_timed_mutex> lock(layout);
+    auto range = shards_of(i);
+    auto shard_locks = lock_shards(range);
+    for (std::size_t s = range.first; s <= range.second; ++s) {
+      shards[s]->index.insert(i);
+    }
+    ++count;
+  }
+  if (++updates % ISL_SHARD_CHECK_PERIOD == 0)
+    maybe_rebalance();
+}
+
+template <class Interval_, template <class> class Index_>
+template <class InputIterator>
+int Sharded_interval_index<Interval_, Index_>::insert(InputIterator b, InputIterator e)
+{
+  std::vector<Interval> batch(b, e);
+  {
+    std::shared_lock<std::shared_timed_mutex> lock(layout);
+    fill_shards(batch.begin(), batch.end());
+    count += batch.size();
+    updates += batch.size();
+  }
+  maybe_rebalance();
+  return static_cast<int>(batch.size());
+}
+
+template <class Interval_, template <class> class Index_>
+bool Sharded_interval_index<Interval_, Index_>::remove(const Interval& I)
+{
+  {
+    std::shared_lock<std::shared_timed_mutex> lock(layout);
+    auto range = shards_of(I);
+    auto shard_locks = lock_shards(range);
+    // a batch insert may have reached only some of the shards yet
+    for (std::size_t s = range.first; s <= range.second; ++s) {
+      if (!shards[s]->index.contains(I))
+        return false;
+    }
+    for (std::size_t s = range.first; s <= range.second; ++s) {
+      shards[s]->index.remove(I);
+    }
+    --count;
+  }
+  // removals skew the shards as much as inserts do
+  if (++updates % ISL_SHARD_CHECK_PERIOD == 0)
+    maybe_rebalance();
+  return true;
+}
+
+template <class Interval_, template <class> class Index_>
+void Sharded_interval_index<Interval_, Index_>::clear()
+{
+  std::unique_lock<std::shared_timed_mutex> lock(layout);
+  bounds.clear();
+  make_shards(1);
+  count = 0;
+  rebalanced_at = updates.load();
+}
+
+template <class Interval_, template <class> class Index_>
+bool Sharded_interval_index<Interval_, Index_>::is_contained(const Value& value) const
+{
+  std::shared_lock<std::shared_timed_mutex> lock(layout);
+  const Shard& shard = *shards[shard_of(value)];
+  std::shared_lock<std::shared_timed_mutex> shard_lock(shard.mutex);
+  return shard.index.is_contained(value);
+}
+
+template <class Interval_, template <class> class Index_>
+template <class OutputIterator>
+OutputIterator Sharded_interval_index<Interval_, Index_>::find_intervals(const Value& value, OutputIterator out) const
+{
+  std::shared_lock<std::shared_timed_mutex> lock(layout);
+  const Shard& shard = *shards[shard_of(value)];
+  std::shared_lock<std::shared_timed_mutex> shard_lock(shard.mutex);
+  return shard.index.find_intervals(value, out);
+}
+
+// sorted queries fall into consecutive runs, one per shard
+template <class Interval_, template <class> class Index_>
+template <class RandomAccessIterator, class OutputIterator>
+OutputIterator Sharded_interval_index<Interval_, Index_>::find_intervals_sorted(RandomAccessIterator qb, RandomAccessIterator qe, OutputIterator out) const
+{
+  std::shared_lock<std::shared_timed_mutex> lock(layout);
+  for (RandomAccessIterator run = qb; run != qe;) {
+    std::size_t s = shard_of(*run);
+    RandomAccessIterator run_end = s < bounds.size() ? std::lower_bound(run, qe, bounds[s]) : qe;
+    const Shard& shard = *shards[s];
+    std::shared_lock<std::shared_timed_mutex> shard_lock(shard.mutex);
+    Offset_output<OutputIterator> shifted{out, static_cast<std::size_t>(run - qb)};
+    out = shard.index.find_intervals_sorted(run, run_end, shifted).out;
+    run = run_end;
+  }
+  return out;
+}
+
+// in shard s the window is clipped to the shard, intervals which also meet the window
+// left of the shard were reported by an earlier shard
+template <class Interval_, template <class> class Index_>
+template <class OutputIterator>
+OutputIterator Sharded_interval_index<Interval_, Index_>::find_overlapping(const Value& l, const Value& r, bool lb, bool rb, OutputIterator out) const
+{
+  std::shared_lock<std::shared_timed_mutex> lock(layout);
+  auto range = shards_of(l, r, lb, rb);
+  std::vector<Interval> found;
+  for (std::size_t s = range.first; s <= range.second; ++s) {
+    const Shard& shard = *shards[s];
+    std::shared_lock<std::shared_timed_mutex> shard_lock(shard.mutex);
+    found.clear();
+    shard.index.find_overlapping(s == range.first ? l : bounds[s - 1], s == range.second ? r : bounds[s],
+                                 s == range.first ? lb : true, s == range.second ? rb : false,
+                                 std::back_inserter(found));
+    for (const Interval& i : found) {
+      if (s == range.first || !i.overlaps(l, bounds[s - 1], lb, false)) {
+        out = i;
+        ++out;
+      }
+    }
+  }
+  return out;
+}
+
+template <class Interval_, template <class> class Index_>
+std::size_t Sharded_interval_index<Interval_, Index_>::count_intervals(const Value& value) const
+{
+  std::shared_lock<std::shared_timed_mutex> lock(layout);
+  const Shard& shard = *shards[shard_of(value)];
+  std::shared_lock<std::shared_timed_mutex> shard_lock(shard.mutex);
+  return shard.index.count_intervals(value);
+}
+
+template <class Interval_, template <class> class Index_>
+std::size_t Sharded_interval_index<Interval_, Index_>::count_overlapping(const Value& l, const Value& r, bool lb, bool rb) const
+{
+  std::shared_lock<std::shared_timed_mutex> lock(layout);
+  auto range = shards_of(l, r, lb, rb);
+  std::size_t result = 0;
+  for (std::size_t s = range.first; s <= range.second; ++s) {
+    const Shard& shard = *shards[s];
+    std::shared_lock<std::shared_timed_mutex> shard_lock(shard.mutex);
+    result += shard.index.count_overlapping(s == range.first ? l : bounds[s - 1], s == range.second ? r : bounds[s],
+                                            s == range.first ? lb : true, s == range.second ? rb : false);
+    // those also meeting the window left of the shard contain the shard bound
+    if (s != range.first)
+      result -= shard.index.count_overlapping(l, bounds[s - 1], lb, false);
+  }
+  return result;
+}
+
+template <class Interval_, template <class> class Index_>
+int Sharded_interval_index<Interval_, Index_>::size() const
+{
+  return static_cast<int>(count.load());
+}
+
+template <class Interval_, template <class> class Index_>
+std::size_t Sharded_interval_index<Interval_, Index_>::shard_count() const
+{
+  std::shared_lock<std::shared_timed_mutex> lock(layout);
+  return shards.size();
+}
+
+#endif // SHARDED_INTERVAL_INDEX_H
@@ -0,0 +1,837 @@
+#ifndef UNROLLED_INTERVAL_SKIP_LIST_H
+#define UNROLLED_INTERVAL_SKIP_LIST_H
+
+#include <algorithm>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <type_traits>
+#include <vector>
+
+#include "Flat_index.h"
+#include "Interval_slab.h"
+#include "Node_arena.h"
+
+#include <boost/random/linear_congruential.hpp>
+#include <boost/random/geometric_distribution.hpp>
+#include <boost/random/variate_generator.hpp>
+
+#ifndef ISL_UNROLLED_BLOCK_KEYS
+#define ISL_UNROLLED_BLOCK_KEYS 16 // average number of keys per block
+#endif
+
+template <class Interval_>
+class Unrolled_interval_skip_list;
+
+// block of an unrolled interval skip list. The first key is the head, it has a tower of
+// topLevel + 1 forward pointers to the heads of next blocks. The following keys have no tower,
+// they stand for nodes of height 0 between the head and the next block.
+// Every key has a slot of intervals, the slots of a block share its two indexes:
+// slot j takes positions [starts()[j], starts()[j + 1]) in both of them
+template <class Interval_>
+class UnrolledSLnode
+{
+private:
+  typedef UnrolledSLnode<Interval_> Self;
+  typedef Self* Self_ptr;
+  typedef Interval_ Interval;
+  typedef typename Interval::Value Value;
+  typedef Interval_slab<Interval_> Container;
+  typedef typename Container::Handle Interval_handle;
+
+  static_assert(std::is_trivially_copyable<Value>::value, "keys are moved within a block as raw memory");
+
+  template <class Derived>
+  struct handle_cmp {
+    const Container& container;
+    explicit handle_cmp(const Container& container) : container(container) {}
+    const Interval& get(Interval_handle h) const { return container[h]; }
+    const Interval& get(const Interval& i) const { return i; }
+    template <class A, class B>
+    bool operator()(const A& a, const B& b) const {
+      return static_cast<const Derived&>(*this).less(get(a), get(b));
+    }
+  };
+
+  // same order as in the interval skip list, it agrees with the slot order in the block
+  struct inf_cmp : handle_cmp<inf_cmp> {
+    using handle_cmp<inf_cmp>::handle_cmp;
+    bool less(const Interval& a, const Interval& b) const;
+  };
+
+  // slot first, then the order of the interval skip list
+  struct sup_cmp : handle_cmp<sup_cmp> {
+    const Self& node;
+    sup_cmp(const Container& container, const Self& node) : handle_cmp<sup_cmp>(container), node(node) {}
+    bool less(const Interval& a, const Interval& b) const;
+  };
+
+  Value* keys_;     // keys()[0] is the head, unused in the header
+  uint32_t size;     // number of keys
+  uint32_t capacity;
+  int topLevel;
+  Flat_index<Interval_handle> lbound_idx; // ordered by inf_cmp
+  Flat_index<Interval_handle> rbound_idx; // ordered by sup_cmp
+  // topLevel + 1 forward pointers follow the block in the same arena block
+
+  explicit UnrolledSLnode(int top_level);
+
+  static size_t block_size(int top_level);
+  // keys, then owner counts, then slot starts
+  static size_t arrays_size(uint32_t capacity);
+
+  Self_ptr* forward() { return reinterpret_cast<Self_ptr*>(this + 1); }
+  Self_ptr const* forward() const { return reinterpret_cast<Self_ptr const*>(this + 1); }
+  Value* keys() { return keys_; }
+  const Value* keys() const { return keys_; }
+  // number of intervals with inf equal to the key
+  uint32_t* owner_counts() { return reinterpret_cast<uint32_t*>(keys_ + capacity); }
+  uint32_t* starts() { return owner_counts() + capacity; }
+  const uint32_t* starts() const { return reinterpret_cast<const uint32_t*>(keys_ + capacity) + capacity; }
+  const Value& head() const { return keys_[0]; }
+
+  // slot of intervals with given inf, the head slot also takes intervals starting before the block
+  uint32_t slot_of(const Value& inf) const;
+  uint32_t slot_size(uint32_t j) const { return starts()[j + 1] - starts()[j]; }
+
+  friend class Unrolled_interval_skip_list<Interval_>;
+};
+
+// Interval skip list with several keys per node, same API for updates and stabbing queries.
+// An interval is stored in the slot it would take in the interval skip list where
+// the keys after a block head are nodes of height 0, so within a block the search
+// is a linear scan over a short sorted array and the block indexes are shared by its keys.
+// A new key starts a block with probability 1 / ISL_UNROLLED_BLOCK_KEYS
+template <class Interval_>
+class Unrolled_interval_skip_list
+{
+private:
+  typedef Interval_ Interval;
+  typedef typename Interval::Value Value;
+  typedef UnrolledSLnode<Interval> Node;
+  typedef typename Node::inf_cmp inf_cmp;
+  typedef typename Node::sup_cmp sup_cmp;
+
+  static const int MAX_LEVEL = 48;
+
+public:
+  typedef typename Interval_slab<Interval>::Handle Interval_handle;
+
+private:
+  Interval_slab<Interval> container;
+  // block whose indexes hold the interval, indexed by handle
+  std::vector<Node*> owners;
+
+  int maxLevel;
+  boost::rand48 random;
+  boost::geometric_distribution<> prob;
+  boost::variate_generator<boost::rand48&, boost::geometric_distribution<>> die;
+  Node_arena arena;  // blocks with their forward pointers, key arrays and indexes
+  Node* header;
+
+  int random_level();  // level of a new block, -1 for a key added to an existing block
+  Node* create_node(int top_level, uint32_t capacity);
+  void destroy_node(Node* node);
+  void reserve(Node* node, uint32_t capacity);
+
+  // predecessors of key on every level, update[0] is the block whose range takes key
+  void find_path(const Value& key, Node** update) const;
+  // slot of key in update[0] or its successor block, false if key is absent
+  bool find_key(const Value& key, Node* const* update, Node*& node, uint32_t& j) const;
+  // block and slot for an interval whose inf is already a key
+  void find_slot(const Interval& i, Node* const* update, Node*& node, uint32_t& j) const;
+
+  void insert_key(Node* node, uint32_t j, const Value& key);
+  void erase_key(Node* node, uint32_t j);
+  void place(const Interval_handle& ih, Node* node, uint32_t j);
+  void unplace(const Interval_handle& ih, Node* node, uint32_t j);
+  // move the prefix of a slot matching the head or key of slot k of to into that slot
+  void move_lbound(Node* from, uint32_t j, Node* to, uint32_t k);
+  void move_rbound(Node* from, uint32_t j, Node* to, uint32_t k);
+  // appends the keys from slot first on of from with their intervals to to
+  void move_keys(Node* from, uint32_t first, Node* to);
+
+  void insert_impl(const Interval_handle& ih);
+  void insert_block(const Interval_handle& ih, Node** update, int lvl);
+  // drops one owner of the key and unlinks it when no interval starts there
+  void release_key(const Value& key, Node** update);
+  void remove_block(Node* rm_node, Node** update);
+
+  template <class OutputIterator, class IdxType>
+  void collect(const IdxType& idx, const Node* node, uint32_t j, const Value& value, OutputIterator& out) const;
+  template <class IdxType>
+  bool front_contains(const IdxType& idx, const Node* node, uint32_t j, const Value& value) const;
+
+public:
+  Unrolled_interval_skip_list();
+  template <class InputIterator>
+  Unrolled_interval_skip_list(InputIterator b, InputIterator e);
+  Unrolled_interval_skip_list(const Unrolled_interval_skip_list&) = delete;
+  Unrolled_interval_skip_list& operator=(const Unrolled_interval_skip_list&) = delete;
+
+  void seed(boost::rand48::result_type x0);
+
+  // the handle stays valid until the interval is removed
+  Interval_handle insert(const Interval& i);
+  template <class InputIterator>
+  int insert(InputIterator b, InputIterator e);
+
+  bool remove(const Interval& I);
+  // removes exactly the interval inserted under ih
+  void remove(Interval_handle ih);
+
+  bool is_contained(const Value& value) const;
+  template <class OutputIterator>
+  OutputIterator find_intervals(const Value& value, OutputIterator out) const;
+
+  void clear();
+
+  int size() const;
+
+  typedef typename Interval_slab<Interval>::const_iterator const_iterator;
+
+  const_iterator begin() const {
+    return container.begin();
+  }
+
+  const_iterator end() const {
+    return container.end();
+  }
+};
+
+template <class Interval>
+bool UnrolledSLnode<Interval>::inf_cmp::less(const Interval& a, const Interval& b) const
+{
+  if (a.inf() != b.inf())
+    return a.inf() < b.inf();
+  if (a.inf_closed() != b.inf_closed())
+    return a.inf_closed();
+  if (a.sup() != b.sup())
+    return a.sup() > b.sup();
+  if (a.sup_closed() != b.sup_closed())
+    return a.sup_closed();
+  return false;
+}
+
+template <class Interval>
+bool UnrolledSLnode<Interval>::sup_cmp::less(const Interval& a, const Interval& b) const
+{
+  uint32_t sa = node.slot_of(a.inf());
+  uint32_t sb = node.slot_of(b.inf());
+  if (sa != sb)
+    return sa < sb;
+  if (a.sup() != b.sup())
+    return a.sup() > b.sup();
+  if (a.sup_closed() != b.sup_closed())
+    return a.sup_closed();
+  if (a.inf() != b.inf())
+    return a.inf() < b.inf();
+  if (a.inf_closed() != b.inf_closed())
+    return a.inf_closed();
+  return false;
+}
+
+template <class Interval>
+UnrolledSLnode<Interval>::UnrolledSLnode(int top_level)
+  : keys_(nullptr)
+  , size(0)
+  , capacity(0)
+  , topLevel(top_level)
+{
+  std::fill(forward(), forward() + top_level + 1, nullptr);
+}
+
+template <class Interval>
+size_t UnrolledSLnode<Interval>::block_size(int top_level) {
+  static_assert(sizeof(Self) % alignof(Self_ptr) == 0, "forward pointers must be aligned");
+  return sizeof(Self) + (top_level + 1) * sizeof(Self_ptr);
+}
+
+template <class Interval>
+size_t UnrolledSLnode<Interval>::arrays_size(uint32_t capacity) {
+  static_assert(alignof(Value) >= alignof(uint32_t), "counts follow the keys");
+  return capacity * sizeof(Value) + (2 * capacity + 1) * sizeof(uint32_t);
+}
+
+template <class Interval>
+uint32_t UnrolledSLnode<Interval>::slot_of(const Value& inf) const {
+  return static_cast<uint32_t>(std::upper_bound(keys_ + 1, keys_ + size, inf) - keys_ - 1);
+}
+
+template <class Interval>
+Unrolled_interval_skip_list<Interval>::Unrolled_interval_skip_list()
+  : maxLevel(0)
+  , random(std::random_device()())
+  , prob(0.5)
+  , die(random, prob)
+{
+  header = create_node(MAX_LEVEL - 1, 4);
+}
+
+template <class Interval>
+template <class InputIterator>
+Unrolled_interval_skip_list<Interval>::Unrolled_interval_skip_list(InputIterator b, InputIterator e)
+  : maxLevel(0)
+  , random(std::random_device()())
+  , prob(0.5)
+  , die(random, prob)
+{
+  header = create_node(MAX_LEVEL - 1, 4);
+  insert(b, e);
+}
+
+// the head slot exists from the start, in the header it only takes no intervals
+template <class Interval>
+UnrolledSLnode<Interval>* Unrolled_interval_skip_list<Interval>::create_node(int top_level, uint32_t capacity) {
+  void* block = arena.allocate(Node::block_size(top_level));
+  Node* node = new (block) Node(top_level);
+  node->capacity = capacity;
+  node->keys_ = static_cast<Value*>(arena.allocate(Node::arrays_size(capacity)));
+  node->size = 1;
+  node->owner_counts()[0] = 0;
+  node->starts()[0] = 0;
+  node->starts()[1] = 0;
+  return node;
+}
+
+template <class Interval>
+void Unrolled_interval_skip_list<Interval>::destroy_node(Node* node) {
+  node->lbound_idx.clear(arena);
+  node->rbound_idx.clear(arena);
+  arena.deallocate(node->keys_, Node::arrays_size(node->capacity));
+  arena.deallocate(node, Node::block_size(node->topLevel));
+}
+
+template <class Interval>
+void Unrolled_interval_skip_list<Interval>::reserve(Node* node, uint32_t capacity) {
+  if (capacity <= node->capacity) {
+    return;
+  }
+  capacity = std::max(capacity, 2 * node->capacity);
+  Value* keys = static_cast<Value*>(arena.allocate(Node::arrays_size(capacity)));
+  uint32_t* counts = reinterpret_cast<uint32_t*>(keys + capacity);
+  std::memcpy(keys, node->keys(), node->size * sizeof(Value));
+  std::memcpy(counts, node->owner_counts(), node->size * sizeof(uint32_t));
+  std::memcpy(counts + capacity, node->starts(), (node->size + 1) * sizeof(uint32_t));
+  arena.deallocate(node->keys_, Node::arrays_size(node->capacity));
+  node->keys_ = keys;
+  node->capacity = capacity;
+}
+
+template <class Interval_>
+void Unrolled_interval_skip_list<Interval_>::seed(boost::rand48::result_type x0) {
+  random.seed(x0);
+}
+
+template <class Interval>
+int Unrolled_interval_skip_list<Interval>::random_level()
+{
+  if (random() % ISL_UNROLLED_BLOCK_KEYS != 0) {
+    return -1;
+  }
+  return std::min(die(), MAX_LEVEL - 1);
+}
+
+template <class Interval>
+void Unrolled_interval_skip_list<Interval>::find_path(const Value& key, Node** update) const {
+  Node* v = header;
+  for (int i = MAX_LEVEL - 1; i > maxLevel; --i) {
+    update[i] = header;
+  }
+  for (int i = maxLevel; i >= 0; --i) {
+    while (v->forward()[i] && v->forward()[i]->head() < key) {
+      v = v->forward()[i];
+    }
+    update[i] = v;
+  }
+}
+
+template <class Interval>
+bool Unrolled_interval_skip_list<Interval>::find_key(const Value& key, Node* const* update,
+                                                     Node*& node, uint32_t& j) const {
+  Node* next = update[0]->forward()[0];
+  if (next && next->head() == key) {
+    node = next;
+    j = 0;
+    return true;
+  }
+  node = update[0];
+  j = 1;
+  while (j < node->size && node->keys()[j] < key) {
+    ++j;
+  }
+  return j < node->size && node->keys()[j] == key;
+}
+
+// the first head on the search path that the interval contains, else the slot of its inf
+template <class Interval>
+void Unrolled_interval_skip_list<Interval>::find_slot(const Interval& i, Node* const* update,
+                                                      Node*& node, uint32_t& j) const {
+  for (int l = maxLevel; l >= 0; --l) {
+    Node* next = update[l]->forward()[l];
+    if (next && i.contains_or_inf(next->head())) {
+      node = next;
+      j = 0;
+      return;
+    }
+  }
+  bool found = find_key(i.inf(), update, node, j);
+  assert(found);
+  (void)found;
+}
+
+template <class Interval>
+void Unrolled_interval_skip_list<Interval>::insert_key(Node* node, uint32_t j, const Value& key) {
+  reserve(node, node->size + 1);
+  Value* keys = node->keys();
+  uint32_t* counts = node->owner_counts();
+  uint32_t* starts = node->starts();
+  std::memmove(keys + j + 1, keys + j, (node->size - j) * sizeof(Value));
+  std::memmove(counts + j + 1, counts + j, (node->size - j) * sizeof(uint32_t));
+  std::memmove(starts + j + 1, starts + j, (node->size + 1 - j) * sizeof(uint32_t));
+  keys[j] = key;
+  counts[j] = 0;
+  ++node->size;
+}
+
+template <class Interval>
+void Unrolled_interval_skip_list<Interval>::erase_key(Node* node, uint32_t j) {
+  assert(j > 0 && node->slot_size(j) == 0 && node->owner_counts()[j] == 0);
+  Value* keys = node->keys();
+  uint32_t* counts = node->owner_counts();
+  uint32_t* starts = node->starts();
+  std::memmove(keys + j, keys + j + 1, (node->size - j - 1) * sizeof(Value));
+  std::memmove(counts + j, counts + j + 1, (node->size - j - 1) * sizeof(uint32_t));
+  std::memmove(starts + j, starts + j + 1, (node->size - j) * sizeof(uint32_t));
+  --node->size;
+}
+
+template <class Interval>
+void Unrolled_interval_skip_list<Interval>::place(const Interval_handle& ih, Node* node, uint32_t j) {
+  node->lbound_idx.insert(ih, inf_cmp(container), arena);
+  node->rbound_idx.insert(ih, sup_cmp(container, *node), arena);
+  uint32_t* starts = node->starts();
+  for (uint32_t s = j + 1; s <= node->size; ++s) {
+    ++starts[s];
+  }
+  owners[ih] = node;
+}
+
+// intervals equal to the one under ih may precede it in both indexes
+template <class Interval>
+void Unrolled_interval_skip_list<Interval>::unplace(const Interval_handle& ih, Node* node, uint32_t j) {
+  auto it = node->lbound_idx.lower_bound(ih, inf_cmp(container));
+  while (*it != ih) {
+    ++it;
+    assert(it != node->lbound_idx.end());
+  }
+  node->lbound_idx.erase(it, arena);
+  auto it2 = node->rbound_idx.lower_bound(ih, sup_cmp(container, *node));
+  while (*it2 != ih) {
+    ++it2;
+    assert(it2 != node->rbound_idx.end());
+  }
+  node->rbound_idx.erase(it2, arena);
+  uint32_t* starts = node->starts();
+  for (uint32_t s = j + 1; s <= node->size; ++s) {
+    --starts[s];
+  }
+}
+
+template <class Interval>
+void Unrolled_interval_skip_list<Interval>::move_lbound(Node* from, uint32_t j, Node* to, uint32_t k) {
+  const Value& key = to->keys()[k];
+  std::vector<Interval_handle> moved;
+  uint32_t n = from->slot_size(j);
+  auto first = from->lbound_idx.nth(from->starts()[j]);
+  auto it = first;
+  for (; n > 0 && container[*it].contains_or_inf(key); --n, ++it) {
+    moved.push_back(*it);
+  }
+  if (moved.empty()) {
+    return;
+  }
+  from->lbound_idx.erase(first, it, arena);
+  for (auto const& ih : moved) {
+    auto it2 = from->rbound_idx.lower_bound(ih, sup_cmp(container, *from));
+    while (*it2 != ih) {
+      ++it2;
+    }
+    from->rbound_idx.erase(it2, arena);
+  }
+  uint32_t* starts = from->starts();
+  for (uint32_t s = j + 1; s <= from->size; ++s) {
+    starts[s] -= static_cast<uint32_t>(moved.size());
+  }
+  for (auto const& ih : moved) {
+    place(ih, to, k);
+  }
+}
+
+template <class Interval>
+void Unrolled_interval_skip_list<Interval>::move_rbound(Node* from, uint32_t j, Node* to, uint32_t k) {
+  const Value& key = to->keys()[k];
+  std::vector<Interval_handle> moved;
+  uint32_t n = from->slot_size(j);
+  auto first = from->rbound_idx.nth(from->starts()[j]);
+  auto it = first;
+  for (; n > 0 && container[*it].contains_or_inf(key); --n, ++it) {
+    moved.push_back(*it);
+  }
+  if (moved.empty()) {
+    return;
+  }
+  from->rbound_idx.erase(first, it, arena);
+  for (auto const& ih : moved) {
+    auto it2 = from->lbound_idx.lower_bound(ih, inf_cmp(container));
+    while (*it2 != ih) {
+      ++it2;
+    }
+    from->lbound_idx.erase(it2, arena);
+  }
+  uint32_t* starts = from->starts();
+  for (uint32_t s = j + 1; s <= from->size; ++s) {
+    starts[s] -= static_cast<uint32_t>(moved.size());
+  }
+  for (auto const& ih : moved) {
+    place(ih, to, k);
+  }
+}
+
+// the moved keys are greater than all keys of to, so are the infs of their intervals
+template <class Interval>
+void Unrolled_interval_skip_list<Interval>::move_keys(Node* from, uint32_t first, Node* to) {
+  if (first >= from->size) {
+    return;
+  }
+  uint32_t pos = from->starts()[first];
+  std::vector<Interval_handle> lb(from->lbound_idx.nth(pos), from->lbound_idx.end());
+  std::vector<Interval_handle> rb(from->rbound_idx.nth(pos), from->rbound_idx.end());
+  from->lbound_idx.erase(from->lbound_idx.nth(pos), from->lbound_idx.end(), arena);
+  from->rbound_idx.erase(from->rbound_idx.nth(pos), from->rbound_idx.end(), arena);
+
+  uint32_t count = from->size - first;
+  reserve(to, to->size + count);
+  std::memcpy(to->keys() + to->size, from->keys() + first, count * sizeof(Value));
+  std::memcpy(to->owner_counts() + to->size, from->owner_counts() + first, count * sizeof(uint32_t));
+  uint32_t* starts = to->starts();
+  for (uint32_t s = first; s < from->size; ++s) {
+    starts[to->size + 1] = starts[to->size] + from->slot_size(s);
+    ++to->size;
+  }
+  from->size = first;
+
+  if (to->lbound_idx.empty()) {
+    to->lbound_idx.assign_sorted(lb.data(), lb.data() + lb.size(), arena);
+    to->rbound_idx.assign_sorted(rb.data(), rb.data() + rb.size(), arena);
+  } else {
+    for (auto const& ih : lb) {
+      to->lbound_idx.insert(ih, inf_cmp(container), arena);
+    }
+    for (auto const& ih : rb) {
+      to->rbound_idx.insert(ih, sup_cmp(container, *to), arena);
+    }
+  }
+  for (auto const& ih : lb) {
+    owners[ih] = to;
+  }
+}
+
+template <class Interval>
+void Unrolled_interval_skip_list<Interval>::insert_impl(const Interval_handle& ih) {
+  const Interval& i = container[ih];
+  Node* update[MAX_LEVEL];
+  find_path(i.inf(), update);
+  Node* node;
+  uint32_t j;
+  if (find_key(i.inf(), update, node, j)) {
+    ++node->owner_counts()[j];
+    find_slot(i, update, node, j);
+    place(ih, node, j);
+    return;
+  }
+  int lvl = random_level();
+  if (lvl >= 0) {
+    insert_block(ih, update, lvl);
+    return;
+  }
+  insert_key(node, j, i.inf());
+  node->owner_counts()[j] = 1;
+  find_slot(i, update, node, j);
+  place(ih, node, j);
+}
+
+// same steps as inserting a node into the interval skip list, the keys of update[0]
+// after the new one are the nodes of height 0 between it and the next block
+template <class Interval>
+void Unrolled_interval_skip_list<Interval>::insert_block(const Interval_handle& ih, Node** update, int lvl) {
+  const Interval& i = container[ih];
+  const Value& lbound = i.inf();
+  Node* v = update[0];
+  uint32_t j = v->slot_of(lbound) + 1;
+  Node* new_node = create_node(lvl, std::max<uint32_t>(4, v->size - j + 1));
+  new_node->keys()[0] = lbound;
+  new_node->owner_counts()[0] = 1;
+  move_keys(v, j, new_node);
+
+  // phase 1: heads above the new block that the interval contains
+  bool placed = false;
+  for (int l = std::max(maxLevel, lvl); l > lvl && !placed; --l) {
+    Node* next = update[l]->forward()[l];
+    if (next && i.contains_or_inf(next->head())) {
+      place(ih, next, 0);
+      placed = true;
+    }
+  }
+  if (!placed) {
+    place(ih, new_node, 0);
+  }
+
+  Node* next = update[lvl]->forward()[lvl];
+  if (next && next->topLevel == lvl) {
+    move_lbound(next, 0, new_node, 0);
+  }
+  new_node->forward()[lvl] = next;
+  update[lvl]->forward()[lvl] = new_node;
+
+  // phase 2: steal from the blocks below the new one
+  Node* prev_right = next;
+  for (int l = lvl - 1; l >= 0; --l) {
+    for (Node* u = update[l + 1]; u != update[l];) {
+      u = u->forward()[l];
+      move_rbound(u, 0, new_node, 0);
+    }
+    next = update[l]->forward()[l];
+    if (next && next != prev_right) {
+      move_lbound(next, 0, new_node, 0);
+      prev_right = next;
+    }
+    new_node->forward()[l] = next;
+    update[l]->forward()[l] = new_node;
+  }
+  // and from the keys of height 0 before it
+  for (uint32_t s = 1; s < v->size; ++s) {
+    move_rbound(v, s, new_node, 0);
+  }
+  maxLevel = std::max(maxLevel, lvl);
+}
+
+template <class Interval>
+typename Unrolled_interval_skip_list<Interval>::Interval_handle
+Unrolled_interval_skip_list<Interval>::insert(const Interval& i)
+{
+  Interval_handle ih = container.insert(i);
+  if (ih >= owners.size()) {
+    owners.resize(ih + 1);
+  }
+  insert_impl(ih);
+  return ih;
+}
+
+template <class Interval>
+template <class InputIterator>
+int Unrolled_interval_skip_list<Interval>::insert(InputIterator b, InputIterator e) {
+  int inserted = 0;
+  for (; b != e; ++b) {
+    insert(*b);
+    ++inserted;
+  }
+  return inserted;
+}
+
+template <class Interval>
+bool Unrolled_interval_skip_list<Interval>::remove(const Interval& I)
+{
+  Node* update[MAX_LEVEL];
+  find_path(I.inf(), update);
+  Node* node;
+  uint32_t j;
+  if (!find_key(I.inf(), update, node, j)) {
+    return false;
+  }
+  find_slot(I, update, node, j);
+  auto it = node->lbound_idx.find(I, inf_cmp(container));
+  if (it == node->lbound_idx.end()) {
+    return false;
+  }
+  Interval_handle ih = *it;
+  unplace(ih, node, j);
+  release_key(I.inf(), update);
+  container.erase(ih);
+  return true;
+}
+
+template <class Interval>
+void Unrolled_interval_skip_list<Interval>::remove(Interval_handle ih)
+{
+  assert(container.is_alive(ih));
+  const Interval& i = container[ih];
+  Node* node = owners[ih];
+  unplace(ih, node, node->slot_of(i.inf()));
+  Node* update[MAX_LEVEL];
+  find_path(i.inf(), update);
+  release_key(i.inf(), update);
+  container.erase(ih);
+}
+
+template <class Interval>
+void Unrolled_interval_skip_list<Interval>::release_key(const Value& key, Node** update)
+{
+  Node* node;
+  uint32_t j;
+  bool found = find_key(key, update, node, j);
+  assert(found);
+  (void)found;
+  if (--node->owner_counts()[j] > 0) {
+    return;
+  }
+  if (j > 0) {
+    erase_key(node, j);
+  } else {
+    remove_block(node, update);
+  }
+}
+
+// same steps as removing a node from the interval skip list, then the keys
+// of the removed block join its predecessor
+template <class Interval>
+void Unrolled_interval_skip_list<Interval>::remove_block(Node* rm_node, Node** update)
+{
+  int top = rm_node->topLevel;
+  Node* next = rm_node->forward()[top];
+  if (next) {
+    move_rbound(rm_node, 0, next, 0);
+  }
+  update[top]->forward()[top] = next;
+  for (int l = top - 1; l >= 0; --l) {
+    for (Node* u = update[l + 1]; u != update[l];) {
+      u = u->forward()[l];
+      move_lbound(rm_node, 0, u, 0);
+    }
+    next = rm_node->forward()[l];
+    if (next && next != rm_node->forward()[l + 1]) {
+      move_rbound(rm_node, 0, next, 0);
+    }
+    update[l]->forward()[l] = next;
+  }
+  Node* v = update[0];
+  for (uint32_t s = 1; s < v->size; ++s) {
+    move_lbound(rm_node, 0, v, s);
+  }
+  assert(rm_node->slot_size(0) == 0);
+  move_keys(rm_node, 1, v);
+  destroy_node(rm_node);
+}
+
+// prefix of slot j whose intervals contain value
+template <class Interval>
+template <class OutputIterator, class IdxType>
+void Unrolled_interval_skip_list<Interval>::collect(const IdxType& idx, const Node* node, uint32_t j,
+                                                   const Value& value, OutputIterator& out) const {
+  uint32_t n = node->slot_size(j);
+  if (n == 0) {
+    return;
+  }
+  for (auto it = idx.nth(node->starts()[j]); n > 0 && container[*it].contains(value); --n, ++it) {
+    out = container[*it];
+    ++out;
+  }
+}
+
+template <class Interval>
+template <class IdxType>
+bool Unrolled_interval_skip_list<Interval>::front_contains(const IdxType& idx, const Node* node, uint32_t j,
+                                                          const Value& value) const {
+  return node->slot_size(j) > 0 && container[*idx.nth(node->starts()[j])].contains(value);
+}
+
+template <class Interval>
+bool Unrolled_interval_skip_list<Interval>::is_contained(const Value& value) const {
+  const Node* v = header;
+  for (int i = maxLevel; i >= 0; --i) {
+    const Node* next;
+    while ((next = v->forward()[i]) && next->head() < value) {
+      v = next;
+      if (front_contains(v->rbound_idx, v, 0, value))
+        return true;
+    }
+    if (next) {
+      if (front_contains(next->lbound_idx, next, 0, value))
+        return true;
+      if (next->head() == value)
+        return false;
+    }
+  }
+  const uint32_t* starts = v->starts();
+  uint32_t j = 1;
+  if (j < v->size && v->keys()[j] < value) {
+    uint32_t pos = starts[1];
+    auto it = v->rbound_idx.nth(pos);
+    for (; j < v->size && v->keys()[j] < value; ++j) {
+      for (; pos < starts[j]; ++pos) {
+        ++it;
+      }
+      if (pos < starts[j + 1] && container[*it].contains(value))
+        return true;
+    }
+  }
+  return j < v->size && front_contains(v->lbound_idx, v, j, value);
+}
+
+template <class Interval>
+template <class OutputIterator>
+OutputIterator Unrolled_interval_skip_list<Interval>::find_intervals(const Value& value, OutputIterator out) const {
+  const Node* v = header;
+  const Node* prev_right = nullptr;
+  for (int i = maxLevel; i >= 0; --i) {
+    const Node* next;
+    while ((next = v->forward()[i]) && next->head() < value) {
+      v = next;
+      collect(v->rbound_idx, v, 0, value, out);
+    }
+    if (next && next != prev_right) {
+      collect(next->lbound_idx, next, 0, value, out);
+      if (next->head() == value) {
+        return out;
+      }
+      prev_right = next;
+    }
+  }
+  // keys of height 0 in one pass over the rbound index, the key after them is the head already visited
+  const uint32_t* starts = v->starts();
+  uint32_t j = 1;
+  if (j < v->size && v->keys()[j] < value) {
+    uint32_t pos = starts[1];
+    auto it = v->rbound_idx.nth(pos);
+    for (; j < v->size && v->keys()[j] < value; ++j) {
+      for (; pos < starts[j]; ++pos) {
+        ++it;
+      }
+      for (; pos < starts[j + 1] && container[*it].contains(value); ++pos, ++it) {
+        out = container[*it];
+        ++out;
+      }
+    }
+  }
+  if (j < v->size) {
+    collect(v->lbound_idx, v, j, value, out);
+  }
+  return out;
+}
+
+template <class Interval>
+void Unrolled_interval_skip_list<Interval>::clear() {
+  arena.release();
+  header = create_node(MAX_LEVEL - 1, 4);
+  container.clear();
+  owners.clear();
+  maxLevel = 0;
+}
+
+template <class Interval_>
+int Unrolled_interval_skip_list<Interval_>::size() const {
+  return container.size();
+}
+
+#endif // UNROLLED_INTERVAL_SKIP_LIST_H
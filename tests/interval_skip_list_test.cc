@@ -2,12 +2,30 @@
 #include "../include/Interval_skip_list.h"
 #include "../include/Interval_cartesian_tree.h"
 #include "../include/Interval_skip_list_interval.h"
+#include "../include/Interval_soa.h"
+#include "../include/Concurrent_interval_skip_list.h"
+#include "../include/Sharded_interval_index.h"
+#include "../include/Unrolled_interval_skip_list.h"
+#include "../include/Logged_interval_index.h"
+#include "../include/Buffered_interval_index.h"
+#include "../include/Interval_skip_list_map.h"
+#include "../include/Paged_interval_skip_list.h"
 
 #include <CGAL/Interval_skip_list.h>
 #include <CGAL/Interval_skip_list_interval.h>
 #include <gtest/gtest.h>
+#include <boost/iterator/transform_iterator.hpp>
 
+#include <atomic>
+#include <csignal>
+#include <cstdio>
+#include <fstream>
+#include <list>
 #include <random>
+#include <sstream>
+#include <thread>
+
+#include <sys/resource.h>
 
 auto isl_seed = std::random_device()();
 //auto isl_seed = 2160381622;
@@ -15,15 +33,69 @@ auto seed = std::random_device()();
 
 typedef Interval_skip_list_interval<double> Interval_t;
 
-//typedef Interval_skip_list<Interval_t> ISL_t;
-typedef Interval_cartesian_tree<Interval_t> ISL_t;
-
+template <class ISL_t>
 size_t count_stabs(typename Interval_t::Value const& q, ISL_t& isl) { // CGAL find_intervals not marked as const
   size_t cnt = 0;
   isl.find_intervals(q, count_iterator<size_t>(cnt));
   return cnt;
 }
 
+// keys uniform in [-n / 8, n / 8], short intervals with a few long ones
+template <class Gen>
+Interval_t random_interval(Gen& gen, int n) {
+  std::uniform_int_distribution<int> uniform(-n / 8, n / 8);
+  int inf = uniform(gen);
+  int sup = inf + static_cast<int>(gen() % 10) + (gen() % 20 == 0 ? n / 8 : 0);
+  return Interval_t(inf, sup, gen() & 1, gen() & 1);
+}
+
+template <class Interval>
+std::vector<Interval> sorted(std::vector<Interval> intervals) {
+  std::sort(intervals.begin(), intervals.end(), interval_tuple_comparator<Interval>());
+  return intervals;
+}
+
+// the intervals satisfying pred, sorted
+template <class Interval, class Pred>
+std::vector<Interval> brute_force(std::vector<Interval> const& intervals, Pred pred) {
+  std::vector<Interval> expected;
+  std::copy_if(intervals.begin(), intervals.end(), std::back_inserter(expected), pred);
+  return sorted(expected);
+}
+
+// compares the intervals index reports for q with a brute force scan, returns the expected ones
+template <class Index, class Interval>
+std::vector<Interval> expect_found(Index& index, typename Interval::Value const& q,
+                                   std::vector<Interval> const& intervals) {
+  auto expected = brute_force(intervals, [&q](Interval const& i) { return i.contains(q); });
+  std::vector<Interval> found;
+  index.find_intervals(q, std::back_inserter(found));
+  EXPECT_EQ(expected, sorted(found));
+  return expected;
+}
+
+// expect_found with the counting and membership queries
+template <class Index, class Interval>
+std::vector<Interval> expect_stab(Index& index, typename Interval::Value const& q,
+                                  std::vector<Interval> const& intervals) {
+  auto expected = expect_found(index, q, intervals);
+  EXPECT_EQ(expected.size(), index.count_intervals(q));
+  EXPECT_EQ(!expected.empty(), index.is_contained(q));
+  return expected;
+}
+
+template <class Index, class Interval>
+void expect_overlapping(Index& index, typename Interval::Value const& l, typename Interval::Value const& r,
+                        bool lb, bool rb, std::vector<Interval> const& intervals) {
+  auto expected = brute_force(intervals, [&](Interval const& i) { return i.overlaps(l, r, lb, rb); });
+  std::vector<Interval> found;
+  index.find_overlapping(l, r, lb, rb, std::back_inserter(found));
+  EXPECT_EQ(expected, sorted(found));
+  EXPECT_EQ(expected.size(), index.count_overlapping(l, r, lb, rb));
+}
+
+// the fixture runs on both engines
+template <class ISL_t>
 class ISLTest : public ::testing::Test {
 protected:
   ISL_t isl;
@@ -39,21 +111,16 @@ protected:
   void expect_find_intervals(typename Interval_t::Value const& q,
                              std::vector<Interval_t> const& intervals)
   {
-    std::vector<Interval_t> found;
-    std::copy_if(intervals.begin(), intervals.end(), std::back_inserter(found), [&q](Interval_t const& interval) {
-      return interval.contains(q);
-    });
-    std::vector<Interval_t> from_isl;
-    isl.find_intervals(q, std::back_inserter(from_isl));
-    std::sort(found.begin(), found.end(), interval_tuple_comparator<Interval_t>());
-    std::sort(from_isl.begin(), from_isl.end(), interval_tuple_comparator<Interval_t>());
-    EXPECT_EQ(found, from_isl);
+    expect_found(isl, q, intervals);
   }
 
   template<int N>
   void RandomTest();
 };
 
+typedef ::testing::Types<Interval_skip_list<Interval_t>, Interval_cartesian_tree<Interval_t>> Engines;
+TYPED_TEST_SUITE(ISLTest, Engines);
+
 extern "C" {
 void __ubsan_on_report() {
   FAIL() << "Encountered an undefined behavior sanitizer error";
@@ -66,234 +133,249 @@ void __tsan_on_report() {
 }
 }  // extern "C"
 
-TEST_F(ISLTest, Empty) {
-  ISL_t new_isl;
+TYPED_TEST(ISLTest, Empty) {
+  TypeParam new_isl;
 
   EXPECT_EQ(0, new_isl.size());
   EXPECT_EQ(new_isl.begin(), new_isl.end());
 }
 
-TEST_F(ISLTest, RangeConstructor) {
+TYPED_TEST(ISLTest, RangeConstructor) {
   std::vector<Interval_t> intervals({
     Interval_t(-1, 1, true, true),
     Interval_t(-1, 0, true, true),
     Interval_t(0, 1, true, true)
   });
   for (auto const& i : intervals) {
-    isl.insert(i);
+    this->isl.insert(i);
   }
-  ISL_t other(intervals.begin(), intervals.end());
-  EXPECT_EQ(isl.size(), other.size());
-  auto it1 = isl.begin();
+  TypeParam other(intervals.begin(), intervals.end());
+  EXPECT_EQ(this->isl.size(), other.size());
+  auto it1 = this->isl.begin();
   auto it2 = other.begin();
-  for (size_t i = 0; i < isl.size(); ++i) {
+  for (size_t i = 0; i < this->isl.size(); ++i) {
     EXPECT_EQ(*it1, *it2);
     ++it1;
     ++it2;
   }
 }
 
-TEST_F(ISLTest, Insert) {
+TYPED_TEST(ISLTest, Insert) {
   Interval_t i(-2, 3, true, false);
-  isl.insert(i);
-  EXPECT_EQ(1, isl.size());
-  EXPECT_EQ(i, *isl.begin());
+  this->isl.insert(i);
+  EXPECT_EQ(1, this->isl.size());
+  EXPECT_EQ(i, *this->isl.begin());
 }
 
-TEST_F(ISLTest, InsertMultiple) {
+TYPED_TEST(ISLTest, InsertMultiple) {
   std::vector<Interval_t> intervals({
     Interval_t(-5, 4, true, true),
     Interval_t(-3, 5, false, true),
     Interval_t(0, 0, true, true)
   });
   for (auto const& interval : intervals) {
-    isl.insert(interval);
+    this->isl.insert(interval);
   }
-  std::vector<Interval_t> from_isl(isl.begin(), isl.end());
+  std::vector<Interval_t> from_isl(this->isl.begin(), this->isl.end());
   std::sort(intervals.begin(), intervals.end(), interval_tuple_comparator<Interval_t>());
   std::sort(from_isl.begin(), from_isl.end(), interval_tuple_comparator<Interval_t>());
   EXPECT_EQ(intervals, from_isl);
 }
 
-TEST_F(ISLTest, InsertDuplicates) {
+TYPED_TEST(ISLTest, InsertDuplicates) {
   Interval_t interval(-10, 0, false, true);
   int const copies = 3;
   for (int i = 0; i < copies; ++i) {
-    isl.insert(interval);
+    this->isl.insert(interval);
   }
-  EXPECT_EQ(copies, isl.size());
-  auto it = isl.begin();
+  EXPECT_EQ(copies, this->isl.size());
+  auto it = this->isl.begin();
   for (int i = 0; i < copies; ++i) {
     EXPECT_EQ(interval, *it);
     ++it;
   }
 }
 
-TEST_F(ISLTest, InsertSimilar) {
+TYPED_TEST(ISLTest, InsertSimilar) {
   double const inf = 5.0;
   double const sup = 7.0;
   std::vector<Interval_t> intervals({
       Interval_t(inf, sup, true, true),
       Interval_t(inf, sup, false, true)
   });
-  isl.insert(intervals[0]);
-  isl.insert(intervals[1]);
-  EXPECT_EQ(2, isl.size());
-  std::vector<Interval_t> from_isl(isl.begin(), isl.end());
+  this->isl.insert(intervals[0]);
+  this->isl.insert(intervals[1]);
+  EXPECT_EQ(2, this->isl.size());
+  std::vector<Interval_t> from_isl(this->isl.begin(), this->isl.end());
   std::sort(intervals.begin(), intervals.end(), interval_tuple_comparator<Interval_t>());
   std::sort(from_isl.begin(), from_isl.end(), interval_tuple_comparator<Interval_t>());
   EXPECT_EQ(intervals, from_isl);
 }
 
-TEST_F(ISLTest, RemoveFromEmpty) {
-  EXPECT_FALSE(isl.remove(Interval_t(-2, 1, true, true)));
-  EXPECT_EQ(0, isl.size());
+TYPED_TEST(ISLTest, RemoveFromEmpty) {
+  EXPECT_FALSE(this->isl.remove(Interval_t(-2, 1, true, true)));
+  EXPECT_EQ(0, this->isl.size());
 }
 
-TEST_F(ISLTest, Remove) {
+TYPED_TEST(ISLTest, Remove) {
   Interval_t interval(10, 11, false, true);
-  isl.insert(interval);
-  EXPECT_TRUE(isl.remove(interval));
-  EXPECT_EQ(0, isl.size());
+  this->isl.insert(interval);
+  EXPECT_TRUE(this->isl.remove(interval));
+  EXPECT_EQ(0, this->isl.size());
 }
 
-TEST_F(ISLTest, RemoveNonExistent) {
+TYPED_TEST(ISLTest, RemoveNonExistent) {
   Interval_t interval(-2, 2, true, true);
   Interval_t nonexistent(-1, 1, true, true);
-  isl.insert(interval);
-  EXPECT_FALSE(isl.remove(nonexistent));
-  EXPECT_EQ(1, isl.size());
-  EXPECT_EQ(interval, *isl.begin());
+  this->isl.insert(interval);
+  EXPECT_FALSE(this->isl.remove(nonexistent));
+  EXPECT_EQ(1, this->isl.size());
+  EXPECT_EQ(interval, *this->isl.begin());
 }
 
-TEST_F(ISLTest, RemoveDuplicate) {
+TYPED_TEST(ISLTest, RemoveDuplicate) {
   Interval_t interval(-3, 3, false, true);
   int const copies = 3;
   for (int i = 0; i < copies; ++i) {
-    isl.insert(interval);
+    this->isl.insert(interval);
   }
-  EXPECT_TRUE(isl.remove(interval));
-  EXPECT_EQ(copies - 1, isl.size());
-  auto it = isl.begin();
+  EXPECT_TRUE(this->isl.remove(interval));
+  EXPECT_EQ(copies - 1, this->isl.size());
+  auto it = this->isl.begin();
   for (int i = 0; i < copies - 1; ++i) {
     EXPECT_EQ(*it, interval);
     ++it;
   }
 }
 
-TEST_F(ISLTest, RemoveSimilar) {
+TYPED_TEST(ISLTest, RemoveSimilar) {
   double const inf = 5.0;
   double const sup = 7.0;
   std::vector<Interval_t> intervals({
       Interval_t(inf, sup, true, true),
       Interval_t(inf, sup, false, true)
   });
-  isl.insert(intervals[0]);
-  isl.insert(intervals[1]);
-  EXPECT_TRUE(isl.remove(intervals[0]));
-  EXPECT_EQ(1, isl.size());
-  EXPECT_EQ(intervals[1], *isl.begin());
+  this->isl.insert(intervals[0]);
+  this->isl.insert(intervals[1]);
+  EXPECT_TRUE(this->isl.remove(intervals[0]));
+  EXPECT_EQ(1, this->isl.size());
+  EXPECT_EQ(intervals[1], *this->isl.begin());
 }
 
-TEST_F(ISLTest, ClearEmpty) {
-  isl.clear();
-  EXPECT_EQ(0, isl.size());
-  EXPECT_EQ(isl.begin(), isl.end());
+TYPED_TEST(ISLTest, RemoveByHandle) {
+  Interval_t interval(-3, 3, false, true);
+  Interval_t other(0, 4, true, true);
+  auto first = this->isl.insert(interval);
+  auto second = this->isl.insert(interval);
+  this->isl.insert(other);
+  this->isl.remove(second);
+  EXPECT_EQ(2, this->isl.size());
+  EXPECT_EQ(2, count_stabs(1, this->isl));
+  this->isl.remove(first);
+  EXPECT_EQ(1, this->isl.size());
+  EXPECT_EQ(other, *this->isl.begin());
+  EXPECT_FALSE(this->isl.remove(interval));
 }
 
-TEST_F(ISLTest, Clear) {
+TYPED_TEST(ISLTest, ClearEmpty) {
+  this->isl.clear();
+  EXPECT_EQ(0, this->isl.size());
+  EXPECT_EQ(this->isl.begin(), this->isl.end());
+}
+
+TYPED_TEST(ISLTest, Clear) {
   for (int i = 0; i < 5; ++i) {
-    isl.insert(Interval_t(i - 8, i + 3, true, false));
+    this->isl.insert(Interval_t(i - 8, i + 3, true, false));
   }
-  EXPECT_EQ(5, isl.size());
-  isl.clear();
-  EXPECT_EQ(0, isl.size());
-  EXPECT_EQ(isl.begin(), isl.end());
+  EXPECT_EQ(5, this->isl.size());
+  this->isl.clear();
+  EXPECT_EQ(0, this->isl.size());
+  EXPECT_EQ(this->isl.begin(), this->isl.end());
 }
 
-TEST_F(ISLTest, IsContainedEmpty) {
-  EXPECT_FALSE(isl.is_contained(42));
+TYPED_TEST(ISLTest, IsContainedEmpty) {
+  EXPECT_FALSE(this->isl.is_contained(42));
 }
 
-TEST_F(ISLTest, IsContainedSingleOpen) {
+TYPED_TEST(ISLTest, IsContainedSingleOpen) {
   double const inf = -1;
   double const sup = 5;
-  isl.insert(Interval_t(inf, sup, false, false));
-  EXPECT_FALSE(isl.is_contained(inf - 1));
-  EXPECT_FALSE(isl.is_contained(inf));
-  EXPECT_TRUE(isl.is_contained((inf + sup) / 2.0));
-  EXPECT_FALSE(isl.is_contained(sup));
-  EXPECT_FALSE(isl.is_contained(sup + 1));
+  this->isl.insert(Interval_t(inf, sup, false, false));
+  EXPECT_FALSE(this->isl.is_contained(inf - 1));
+  EXPECT_FALSE(this->isl.is_contained(inf));
+  EXPECT_TRUE(this->isl.is_contained((inf + sup) / 2.0));
+  EXPECT_FALSE(this->isl.is_contained(sup));
+  EXPECT_FALSE(this->isl.is_contained(sup + 1));
 }
 
-TEST_F(ISLTest, IsContainedSingleClosed) {
+TYPED_TEST(ISLTest, IsContainedSingleClosed) {
   double const inf = -1;
   double const sup = 5;
-  isl.insert(Interval_t(inf, sup, true, true));
-  EXPECT_FALSE(isl.is_contained(inf - 1));
-  EXPECT_TRUE(isl.is_contained(inf));
-  EXPECT_TRUE(isl.is_contained((inf + sup) / 2.0));
-  EXPECT_TRUE(isl.is_contained(sup));
-  EXPECT_FALSE(isl.is_contained(sup + 1));
+  this->isl.insert(Interval_t(inf, sup, true, true));
+  EXPECT_FALSE(this->isl.is_contained(inf - 1));
+  EXPECT_TRUE(this->isl.is_contained(inf));
+  EXPECT_TRUE(this->isl.is_contained((inf + sup) / 2.0));
+  EXPECT_TRUE(this->isl.is_contained(sup));
+  EXPECT_FALSE(this->isl.is_contained(sup + 1));
 }
 
-TEST_F(ISLTest, IsContainedSemiopen) {
+TYPED_TEST(ISLTest, IsContainedSemiopen) {
   double const x[] = {-1, 3, 5};
-  isl.insert(Interval_t(x[0], x[1], true, false));
-  isl.insert(Interval_t(x[1], x[2], false, true));
-  EXPECT_TRUE(isl.is_contained(x[0]));
-  EXPECT_TRUE(isl.is_contained((x[0] + x[1]) / 2.0));
-  EXPECT_FALSE(isl.is_contained(x[1]));
-  EXPECT_TRUE(isl.is_contained((x[1] + x[2]) / 2.0));
-  EXPECT_TRUE(isl.is_contained(x[2]));
+  this->isl.insert(Interval_t(x[0], x[1], true, false));
+  this->isl.insert(Interval_t(x[1], x[2], false, true));
+  EXPECT_TRUE(this->isl.is_contained(x[0]));
+  EXPECT_TRUE(this->isl.is_contained((x[0] + x[1]) / 2.0));
+  EXPECT_FALSE(this->isl.is_contained(x[1]));
+  EXPECT_TRUE(this->isl.is_contained((x[1] + x[2]) / 2.0));
+  EXPECT_TRUE(this->isl.is_contained(x[2]));
 }
 
-TEST_F(ISLTest, IsContainedSemiopenOverlaping) {
+TYPED_TEST(ISLTest, IsContainedSemiopenOverlaping) {
   double const inf = -7;
   double const sup = -1;
-  isl.insert(Interval_t(inf, sup, false, true));
-  isl.insert(Interval_t(inf, sup, true, false));
+  this->isl.insert(Interval_t(inf, sup, false, true));
+  this->isl.insert(Interval_t(inf, sup, true, false));
   for (double x : {inf, (inf + sup) / 2.0, sup}) {
-    EXPECT_TRUE(isl.is_contained(x));
+    EXPECT_TRUE(this->isl.is_contained(x));
   }
-  EXPECT_FALSE(isl.is_contained(inf - 1));
-  EXPECT_FALSE(isl.is_contained(sup + 1));
+  EXPECT_FALSE(this->isl.is_contained(inf - 1));
+  EXPECT_FALSE(this->isl.is_contained(sup + 1));
 }
 
-TEST_F(ISLTest, IsContainedMultiple) {
+TYPED_TEST(ISLTest, IsContainedMultiple) {
   double x[] = {-11, -5, -1, 3};
-  isl.insert(Interval_t(x[0], x[1]));
-  isl.insert(Interval_t(x[2], x[3]));
-  EXPECT_FALSE(isl.is_contained(x[0] - 10));
-  EXPECT_TRUE(isl.is_contained((x[0] + x[1]) / 2.0));
-  EXPECT_FALSE(isl.is_contained((x[1] + x[2]) / 2.0));
-  EXPECT_TRUE(isl.is_contained((x[2] + x[3]) / 2.0));
-  EXPECT_FALSE(isl.is_contained(x[3] + 10));
+  this->isl.insert(Interval_t(x[0], x[1]));
+  this->isl.insert(Interval_t(x[2], x[3]));
+  EXPECT_FALSE(this->isl.is_contained(x[0] - 10));
+  EXPECT_TRUE(this->isl.is_contained((x[0] + x[1]) / 2.0));
+  EXPECT_FALSE(this->isl.is_contained((x[1] + x[2]) / 2.0));
+  EXPECT_TRUE(this->isl.is_contained((x[2] + x[3]) / 2.0));
+  EXPECT_FALSE(this->isl.is_contained(x[3] + 10));
 }
 
-TEST_F(ISLTest, IsContainedOverlaping) {
+TYPED_TEST(ISLTest, IsContainedOverlaping) {
   double x[] = {-5, 0, 3};
-  isl.insert(Interval_t(x[0], x[1], true, true));
-  isl.insert(Interval_t(x[0], x[2], true, true));
-  EXPECT_TRUE(isl.is_contained((x[0] + x[1]) / 2.0));
-  EXPECT_TRUE(isl.is_contained((x[1] + x[2]) / 2.0));
-  EXPECT_FALSE(isl.is_contained(x[2] + 100));
+  this->isl.insert(Interval_t(x[0], x[1], true, true));
+  this->isl.insert(Interval_t(x[0], x[2], true, true));
+  EXPECT_TRUE(this->isl.is_contained((x[0] + x[1]) / 2.0));
+  EXPECT_TRUE(this->isl.is_contained((x[1] + x[2]) / 2.0));
+  EXPECT_FALSE(this->isl.is_contained(x[2] + 100));
 }
 
-TEST_F(ISLTest, FindIntervals) {
+TYPED_TEST(ISLTest, FindIntervals) {
   int const n = 10;
   double const d = 3.0;
   std::vector<Interval_t> intervals(n);
   for (int i = 0; i < n; ++i) {
     intervals[i] = Interval_t(i, i + d);
-    isl.insert(intervals[i]);
+    this->isl.insert(intervals[i]);
   }
   for (int i = -1; i <= n + d + 1; ++i) {
-    expect_find_intervals(i, intervals);
+    this->expect_find_intervals(i, intervals);
   }
 }
 
-TEST_F(ISLTest, FindIntervalsRandomInsertOrder) {
+TYPED_TEST(ISLTest, FindIntervalsRandomInsertOrder) {
   const int n = 100;
   const double d = 30.0;
 
@@ -302,39 +384,39 @@ TEST_F(ISLTest, FindIntervalsRandomInsertOrder) {
     intervals.emplace_back(i, i + d);
   }
 
-  std::shuffle(intervals.begin(), intervals.end(), gen);
+  std::shuffle(intervals.begin(), intervals.end(), this->gen);
   for (auto const& i : intervals) {
-    isl.insert(i);
+    this->isl.insert(i);
   }
 
   for (int i = 0; i < n + d; ++i) {
-    expect_find_intervals(i, intervals);
+    this->expect_find_intervals(i, intervals);
   }
 }
 
-TEST_F(ISLTest, FindIntervalsSemiopen) {
+TYPED_TEST(ISLTest, FindIntervalsSemiopen) {
   double const inf = -5;
   double const sup = 8;
   Interval_t intervals[] = {
       Interval_t(inf, sup, false, true),
       Interval_t(inf, sup, true, false)
   };
-  isl.insert(intervals[0]);
-  isl.insert(intervals[1]);
+  this->isl.insert(intervals[0]);
+  this->isl.insert(intervals[1]);
   std::vector<Interval_t> found;
-  isl.find_intervals(inf, std::back_inserter(found));
+  this->isl.find_intervals(inf, std::back_inserter(found));
   EXPECT_EQ(1, found.size());
   EXPECT_EQ(intervals[1], found[0]);
   found.clear();
-  isl.find_intervals((inf + sup) / 2.0, std::back_inserter(found));
+  this->isl.find_intervals((inf + sup) / 2.0, std::back_inserter(found));
   EXPECT_EQ(2, found.size());
   found.clear();
-  isl.find_intervals(sup, std::back_inserter(found));
+  this->isl.find_intervals(sup, std::back_inserter(found));
   EXPECT_EQ(1, found.size());
   EXPECT_EQ(intervals[0], found[0]);
 }
 
-TEST_F(ISLTest, FindIntervalsDuplicates) {
+TYPED_TEST(ISLTest, FindIntervalsDuplicates) {
   double x[] = {0, 5, 12};
   std::vector<Interval_t> intervals({
       Interval_t(x[0], x[1]),
@@ -342,129 +424,222 @@ TEST_F(ISLTest, FindIntervalsDuplicates) {
       Interval_t(x[0], x[1])
   });
   for (auto const& interval : intervals) {
-    isl.insert(interval);
+    this->isl.insert(interval);
   }
   std::vector<Interval_t> found;
-  isl.find_intervals(x[1], std::back_inserter(found));
+  this->isl.find_intervals(x[1], std::back_inserter(found));
   EXPECT_EQ(2, found.size());
   EXPECT_EQ(intervals[0], found[0]);
   EXPECT_EQ(intervals[0], found[1]);
 }
 
-TEST_F(ISLTest, InsertRemoveOverlaped) {
+TYPED_TEST(ISLTest, InsertRemoveOverlaped) {
   const size_t n = 5;
 
   for (int i = 0; i < 2 * n; i += 2) {
-    isl.insert(Interval_t(i, i + 1));
+    this->isl.insert(Interval_t(i, i + 1));
   }
   for (int i = 2 * n; i > 0; i -= 2) {
-    isl.insert(Interval_t(i - 1, i));
+    this->isl.insert(Interval_t(i - 1, i));
   }
   for (int i = 1; i < 2 * n; ++i) {
-    EXPECT_EQ(2, count_stabs(i, isl));
+    EXPECT_EQ(2, count_stabs(i, this->isl));
   }
   for (int i = 2 * n; i > 0; i -= 2) {
-    isl.remove(Interval_t(i - 1, i));
+    this->isl.remove(Interval_t(i - 1, i));
   }
-  EXPECT_EQ(n, isl.size());
+  EXPECT_EQ(n, this->isl.size());
   for (int i = 0; i < 2 * n; ++i) {
-    EXPECT_EQ(1, count_stabs(i, isl));
+    EXPECT_EQ(1, count_stabs(i, this->isl));
   }
-  EXPECT_EQ(0, count_stabs(2 * n, isl));
+  EXPECT_EQ(0, count_stabs(2 * n, this->isl));
   for (int i = 0; i < 2 * n; i += 2) {
-    isl.remove(Interval_t(i, i + 1));
+    this->isl.remove(Interval_t(i, i + 1));
   }
-  EXPECT_EQ(0, isl.size());
+  EXPECT_EQ(0, this->isl.size());
 }
 
-TEST_F(ISLTest, SemiopenIntervalsInsertRemove) {
+TYPED_TEST(ISLTest, SemiopenIntervalsInsertRemove) {
   std::list<Interval_t> list;
   Interval_t i1;
   Interval_t i2;
 
   i1 = Interval_t(-5, 0, true, false);
   i2 = Interval_t(0, 5, true, false);
-  isl.insert(i1);
-  isl.insert(i2);
-  isl.find_intervals(0, std::front_inserter(list));
+  this->isl.insert(i1);
+  this->isl.insert(i2);
+  this->isl.find_intervals(0, std::front_inserter(list));
   EXPECT_EQ(1, list.size());
   EXPECT_EQ(i2, *list.begin());
   list.clear();
 
-  isl.remove(i2);
+  this->isl.remove(i2);
   i2 = Interval_t(0, 5, false, true);
-  isl.insert(i2);
-  EXPECT_EQ(0, count_stabs(0, isl));
+  this->isl.insert(i2);
+  EXPECT_EQ(0, count_stabs(0, this->isl));
 
-  isl.remove(i1);
+  this->isl.remove(i1);
   i1 = Interval_t(-5, 0, false, true);
-  isl.insert(i1);
-  isl.find_intervals(0, std::front_inserter(list));
+  this->isl.insert(i1);
+  this->isl.find_intervals(0, std::front_inserter(list));
   EXPECT_EQ(1, list.size());
   EXPECT_EQ(i1, *list.begin());
   list.clear();
 
-  isl.remove(i2);
+  this->isl.remove(i2);
   i2 = Interval_t(0, 5, true, false);
-  isl.insert(i2);
-  EXPECT_EQ(2, count_stabs(0, isl));
+  this->isl.insert(i2);
+  EXPECT_EQ(2, count_stabs(0, this->isl));
 
-  isl.clear();
-  isl.insert(Interval_t(-5, 0, false, false));
-  isl.insert(Interval_t(0, 5, false, false));
-  EXPECT_EQ(0, count_stabs(0, isl));
-  EXPECT_EQ(0, count_stabs(-5, isl));
-  EXPECT_EQ(0, count_stabs(5, isl));
-  EXPECT_EQ(1, count_stabs(-2, isl));
-  EXPECT_EQ(1, count_stabs(3, isl));
+  this->isl.clear();
+  this->isl.insert(Interval_t(-5, 0, false, false));
+  this->isl.insert(Interval_t(0, 5, false, false));
+  EXPECT_EQ(0, count_stabs(0, this->isl));
+  EXPECT_EQ(0, count_stabs(-5, this->isl));
+  EXPECT_EQ(0, count_stabs(5, this->isl));
+  EXPECT_EQ(1, count_stabs(-2, this->isl));
+  EXPECT_EQ(1, count_stabs(3, this->isl));
 }
 
-TEST_F(ISLTest, DuplicatesRemoveFind) {
+TYPED_TEST(ISLTest, DuplicatesRemoveFind) {
   size_t const n = 10;
   Interval_t interval(0, n);
   for (int i = 0; i < n; ++i) {
-    isl.insert(interval);
+    this->isl.insert(interval);
   }
   for (int i = 0; i < n; ++i) {
-    EXPECT_EQ(n - i, count_stabs(0, isl));
-    isl.remove(interval);
+    EXPECT_EQ(n - i, count_stabs(0, this->isl));
+    this->isl.remove(interval);
+  }
+  EXPECT_EQ(0, this->isl.size());
+}
+
+TYPED_TEST(ISLTest, DuplicatesShareEntry) {
+  Interval_t interval(0, 10, true, false);
+  Interval_t other(5, 20);
+  auto first = this->isl.insert(interval);
+  EXPECT_EQ(first, this->isl.insert(interval));
+  this->isl.insert(other);
+  // a batch rebuilding the list adds its copies to the stored interval
+  std::vector<Interval_t> batch(4, interval);
+  batch.push_back(other);
+  this->isl.insert(batch.begin(), batch.end());
+  EXPECT_EQ(8, this->isl.size());
+  EXPECT_EQ(first, this->isl.insert(interval));
+  EXPECT_EQ(9, this->isl.size());
+  EXPECT_EQ(9, std::distance(this->isl.begin(), this->isl.end()));
+
+  std::vector<std::pair<Interval_t, std::size_t>> counted;
+  this->isl.find_intervals_counted(7, std::back_inserter(counted));
+  std::sort(counted.begin(), counted.end(), [](const std::pair<Interval_t, std::size_t>& a,
+                                               const std::pair<Interval_t, std::size_t>& b) {
+    return a.second < b.second;
+  });
+  ASSERT_EQ(2, counted.size());
+  EXPECT_EQ(std::make_pair(other, std::size_t(2)), counted[0]);
+  EXPECT_EQ(std::make_pair(interval, std::size_t(7)), counted[1]);
+  EXPECT_EQ(9, count_stabs(7, this->isl));
+  EXPECT_EQ(9u, this->isl.count_intervals(7));
+  EXPECT_EQ(9u, this->isl.count_overlapping(6, 8, true, true));
+
+  this->isl.remove(first);
+  EXPECT_TRUE(this->isl.remove(interval));
+  EXPECT_EQ(7, this->isl.size());
+  EXPECT_EQ(7u, this->isl.count_intervals(7));
+  for (int i = 0; i < 5; ++i) {
+    EXPECT_TRUE(this->isl.remove(interval));
+  }
+  EXPECT_FALSE(this->isl.remove(interval));
+  EXPECT_EQ(2u, this->isl.count_intervals(7));
+  EXPECT_EQ(0u, this->isl.count_intervals(2));
+}
+
+TYPED_TEST(ISLTest, ForEachIntervalStopsEarly) {
+  int const n = 500;
+  std::uniform_int_distribution<int> uniform(-n / 4, n / 4);
+  for (int i = 0; i < n; ++i) {
+    int inf = uniform(this->gen);
+    int sup = uniform(this->gen);
+    if (inf > sup)
+      std::swap(inf, sup);
+    this->isl.insert(Interval_t(inf, sup, this->gen() & 1, this->gen() & 1));
+  }
+  this->isl.insert(Interval_t(0, 1));
+  this->isl.insert(Interval_t(0, 1));
+  for (int q = -n / 4 - 1; q <= n / 4 + 1; ++q) {
+    std::vector<Interval_t> found;
+    this->isl.find_intervals(q, std::back_inserter(found));
+    std::vector<Interval_t> visited;
+    EXPECT_TRUE(this->isl.for_each_interval(q, [&](const Interval_t& i) {
+      visited.push_back(i);
+      return true;
+    }));
+    std::sort(found.begin(), found.end(), interval_tuple_comparator<Interval_t>());
+    std::sort(visited.begin(), visited.end(), interval_tuple_comparator<Interval_t>());
+    EXPECT_EQ(found, visited);
+
+    int calls = 0;
+    bool completed = this->isl.for_each_interval(q, [&](const Interval_t& i) {
+      EXPECT_TRUE(i.contains(q));
+      ++calls;
+      return false;
+    });
+    EXPECT_EQ(this->isl.is_contained(q), !completed);
+    EXPECT_EQ(completed ? 0 : 1, calls);
+
+    std::size_t handles = 0;
+    this->isl.for_each_handle(q, [&](typename TypeParam::Interval_handle) { ++handles; return true; });
+    // equal intervals share a handle
+    found.erase(std::unique(found.begin(), found.end()), found.end());
+    EXPECT_EQ(found.size(), handles);
   }
-  EXPECT_EQ(0, isl.size());
 }
 
-TEST_F(ISLTest, Epsilon) {
+TYPED_TEST(ISLTest, Epsilon) {
   Interval_t interval(1,
                       static_cast<Interval_t::Value>(1) + std::numeric_limits<Interval_t::Value>::epsilon(),
                       false,
                       true);
-  isl.insert(interval);
-  EXPECT_EQ(1, isl.size());
-  EXPECT_EQ(interval, *isl.begin());
-  EXPECT_EQ(0, count_stabs(interval.inf(), isl));
-  EXPECT_EQ(1, count_stabs(interval.sup(), isl));
-  EXPECT_TRUE(isl.remove(interval));
+  this->isl.insert(interval);
+  EXPECT_EQ(1, this->isl.size());
+  EXPECT_EQ(interval, *this->isl.begin());
+  EXPECT_EQ(0, count_stabs(interval.inf(), this->isl));
+  EXPECT_EQ(1, count_stabs(interval.sup(), this->isl));
+  EXPECT_TRUE(this->isl.remove(interval));
 }
 
-TEST_F(ISLTest, EmptyIntervals) {
+TYPED_TEST(ISLTest, EmptyIntervals) {
   Interval_t i1(2, 2, false, false);
   Interval_t i2(2, 2, true, false);
-  isl.insert(i1);
-  isl.insert(i1);
-  EXPECT_EQ(2, isl.size());
-  EXPECT_EQ(0, count_stabs(2, isl));
-  isl.remove(i1);
-  EXPECT_EQ(1, isl.size());
-  isl.insert(i2);
-  EXPECT_EQ(2, isl.size());
-  EXPECT_EQ(0, count_stabs(2, isl));
-  isl.remove(i1);
-  EXPECT_EQ(1, isl.size());
-  EXPECT_EQ(i2, *isl.begin());
-  EXPECT_TRUE(isl.remove(i2));
+  this->isl.insert(i1);
+  this->isl.insert(i1);
+  EXPECT_EQ(2, this->isl.size());
+  EXPECT_EQ(0, count_stabs(2, this->isl));
+  this->isl.remove(i1);
+  EXPECT_EQ(1, this->isl.size());
+  this->isl.insert(i2);
+  EXPECT_EQ(2, this->isl.size());
+  EXPECT_EQ(0, count_stabs(2, this->isl));
+  this->isl.remove(i1);
+  EXPECT_EQ(1, this->isl.size());
+  EXPECT_EQ(i2, *this->isl.begin());
+  EXPECT_TRUE(this->isl.remove(i2));
+}
+
+TYPED_TEST(ISLTest, EmptyIntervalWithSameInf) {
+  Interval_t empty(-8, -8, true, false);
+  Interval_t interval(-8, 2, true, true);
+  this->isl.insert(Interval_t(-14, 10, true, false));
+  this->isl.insert(empty);
+  this->isl.insert(interval);
+  EXPECT_EQ(2, count_stabs(-8, this->isl));
+  EXPECT_TRUE(this->isl.remove(empty));
+  EXPECT_EQ(2, count_stabs(-8, this->isl));
 }
 
+template <class TypeParam>
 template<int N>
-void ISLTest::RandomTest() {
+void ISLTest<TypeParam>::RandomTest() {
   int const n = N;
   std::uniform_int_distribution<int> uniform(-n, n);
   std::vector<Interval_t> intervals(n);
@@ -486,40 +661,994 @@ void ISLTest::RandomTest() {
   }
 }
 
-TEST_F(ISLTest, Random10) {
-  RandomTest<10>();
+TYPED_TEST(ISLTest, Random10) {
+  this->template RandomTest<10>();
+}
+
+TYPED_TEST(ISLTest, Random100) {
+  this->template RandomTest<100>();
+}
+
+TYPED_TEST(ISLTest, Random1000) {
+  this->template RandomTest<1000>();
+}
+
+TYPED_TEST(ISLTest, Random3000) {
+  this->template RandomTest<3000>();
 }
 
-TEST_F(ISLTest, Random100) {
-  RandomTest<100>();
+TYPED_TEST(ISLTest, InsertRange) {
+  int const n = 1000;
+  std::uniform_int_distribution<int> uniform(-n / 4, n / 4);
+  std::vector<Interval_t> intervals(n);
+  for (auto& interval : intervals) {
+    int inf = uniform(this->gen);
+    int sup = uniform(this->gen);
+    if (inf > sup)
+      std::swap(inf, sup);
+    interval = Interval_t(inf, sup, this->gen() & 1, this->gen() & 1);
+  }
+  // bulk build, then a small batch inserted one by one, then a rebuild
+  EXPECT_EQ(n / 4, this->isl.insert(intervals.begin(), intervals.begin() + n / 4));
+  EXPECT_EQ(10, this->isl.insert(intervals.begin() + n / 4, intervals.begin() + n / 4 + 10));
+  EXPECT_EQ(n - n / 4 - 10, this->isl.insert(intervals.begin() + n / 4 + 10, intervals.end()));
+  EXPECT_EQ(n, this->isl.size());
+  for (int i = 0; i < n; i += 3) {
+    EXPECT_TRUE(this->isl.remove(intervals[i]));
+  }
+  std::vector<Interval_t> left;
+  for (int i = 0; i < n; ++i) {
+    if (i % 3 != 0) {
+      left.push_back(intervals[i]);
+      this->isl.insert(intervals[i]);
+      EXPECT_TRUE(this->isl.remove(intervals[i]));
+    }
+  }
+  for (int q = -n / 4 - 1; q <= n / 4 + 1; ++q) {
+    this->expect_find_intervals(q, left);
+  }
 }
 
-TEST_F(ISLTest, Random1000) {
-  RandomTest<1000>();
+// large enough for the bulk build to sort in parallel
+TYPED_TEST(ISLTest, InsertRangeLarge) {
+  int const n = 200000;
+  std::uniform_int_distribution<int> uniform(-n / 8, n / 8);
+  std::vector<Interval_t> intervals(n);
+  for (auto& interval : intervals) {
+    int inf = uniform(this->gen);
+    interval = Interval_t(inf, inf + static_cast<int>(this->gen() % 100), this->gen() & 1, this->gen() & 1);
+  }
+  EXPECT_EQ(n, this->isl.insert(intervals.begin(), intervals.end()));
+  EXPECT_EQ(n, this->isl.size());
+  for (int k = 0; k < 50; ++k) {
+    this->expect_find_intervals(uniform(this->gen), intervals);
+  }
+  this->isl.clear();
+  EXPECT_EQ(n / 2, this->isl.insert(intervals.begin(), intervals.begin() + n / 2));
+  EXPECT_EQ(n / 2, this->isl.insert(intervals.begin() + n / 2, intervals.end()));
+  for (int k = 0; k < 50; ++k) {
+    this->expect_find_intervals(uniform(this->gen), intervals);
+  }
 }
 
-TEST_F(ISLTest, Random3000) {
-  RandomTest<3000>();
+TYPED_TEST(ISLTest, FindIntervalsSorted) {
+  int const n = 1000;
+  std::uniform_int_distribution<int> uniform(-n / 4, n / 4);
+  for (int i = 0; i < n; ++i) {
+    int inf = uniform(this->gen);
+    int sup = uniform(this->gen);
+    if (inf > sup)
+      std::swap(inf, sup);
+    this->isl.insert(Interval_t(inf, sup, this->gen() & 1, this->gen() & 1));
+  }
+  std::vector<double> queries;
+  for (int q = -n / 4 - 1; q <= n / 4 + 1; ++q) {
+    queries.push_back(q - 0.5);
+    queries.push_back(q);
+    queries.push_back(q);
+  }
+  std::vector<double> few = {-10.5, 0, 0, 7};
+  for (auto const& batch : {queries, few}) {
+    std::vector<std::pair<std::size_t, Interval_t>> pairs;
+    this->isl.find_intervals_sorted(batch.begin(), batch.end(), std::back_inserter(pairs));
+    std::vector<std::vector<Interval_t>> found(batch.size());
+    for (auto const& p : pairs) {
+      ASSERT_LT(p.first, batch.size());
+      found[p.first].push_back(p.second);
+    }
+    for (std::size_t j = 0; j < batch.size(); ++j) {
+      std::vector<Interval_t> expected;
+      this->isl.find_intervals(batch[j], std::back_inserter(expected));
+      std::sort(expected.begin(), expected.end(), interval_tuple_comparator<Interval_t>());
+      std::sort(found[j].begin(), found[j].end(), interval_tuple_comparator<Interval_t>());
+      EXPECT_EQ(expected, found[j]);
+    }
+  }
+}
+
+TYPED_TEST(ISLTest, FindIntervalsBatch) {
+  int const n = 1000;
+  std::uniform_int_distribution<int> uniform(-n / 4, n / 4);
+  std::vector<Interval_t> intervals;
+  for (int i = 0; i < n; ++i) {
+    int inf = uniform(this->gen);
+    int sup = uniform(this->gen);
+    if (inf > sup)
+      std::swap(inf, sup);
+    intervals.emplace_back(inf, sup, this->gen() & 1, this->gen() & 1);
+    this->isl.insert(intervals.back());
+  }
+  std::vector<double> queries;
+  for (int q = -n / 4 - 1; q <= n / 4 + 1; ++q) {
+    queries.push_back(q - 0.5);
+    queries.push_back(q);
+  }
+  std::shuffle(queries.begin(), queries.end(), this->gen);
+  std::vector<double> few = {7, -10.5, 7};
+  for (auto const& batch : {queries, few, std::vector<double>()}) {
+    std::vector<std::pair<std::size_t, Interval_t>> pairs;
+    this->isl.find_intervals_batch(batch.begin(), batch.end(), std::back_inserter(pairs));
+    std::vector<std::vector<Interval_t>> found(batch.size());
+    for (auto const& p : pairs) {
+      ASSERT_LT(p.first, batch.size());
+      found[p.first].push_back(p.second);
+    }
+    for (std::size_t j = 0; j < batch.size(); ++j) {
+      EXPECT_EQ(brute_force(intervals, [&](Interval_t const& i) { return i.contains(batch[j]); }), sorted(found[j]));
+    }
+  }
+}
+
+TYPED_TEST(ISLTest, FindOverlapping) {
+  EXPECT_TRUE(Interval_t(0, 1).overlaps(1, 2, true, true));
+  EXPECT_FALSE(Interval_t(0, 1, true, false).overlaps(1, 2, true, true));
+  EXPECT_FALSE(Interval_t(0, 1).overlaps(1, 2, false, true));
+  EXPECT_TRUE(Interval_t(1, 1).overlaps(0, 2, false, false));
+  EXPECT_FALSE(Interval_t(1, 1, true, false).overlaps(0, 2, true, true));
+  EXPECT_TRUE(Interval_t(0, 3).overlaps(1, 1, true, true));
+
+  int const n = 1000;
+  std::uniform_int_distribution<int> uniform(-n / 4, n / 4);
+  std::vector<Interval_t> intervals(n);
+  for (auto& interval : intervals) {
+    int inf = uniform(this->gen);
+    int sup = uniform(this->gen);
+    if (inf > sup)
+      std::swap(inf, sup);
+    interval = Interval_t(inf, sup, this->gen() & 1, this->gen() & 1);
+    this->isl.insert(interval);
+  }
+  for (int k = 0; k < 500; ++k) {
+    int l = uniform(this->gen);
+    int r = k % 5 == 0 ? l : uniform(this->gen);
+    if (l > r)
+      std::swap(l, r);
+    bool lb = this->gen() & 1;
+    bool rb = this->gen() & 1;
+    expect_overlapping(this->isl, l, r, lb, rb, intervals);
+  }
+}
+
+TYPED_TEST(ISLTest, CountIntervals) {
+  int const n = 1000;
+  std::uniform_int_distribution<int> uniform(-n / 8, n / 8);
+  std::vector<Interval_t> intervals;
+  for (int i = 0; i < n; ++i) {
+    int inf = uniform(this->gen);
+    int sup = uniform(this->gen);
+    if (inf > sup)
+      std::swap(inf, sup);
+    intervals.emplace_back(inf, sup, this->gen() & 1, this->gen() & 1);
+    // copies make node indexes span many leaves
+    intervals.emplace_back(-n / 8, n / 8 - i % 3, true, i % 2);
+  }
+  std::shuffle(intervals.begin(), intervals.end(), this->gen);
+  for (auto const& interval : intervals) {
+    this->isl.insert(interval);
+  }
+  for (int i = 0; i < n / 2; ++i) {
+    EXPECT_TRUE(this->isl.remove(intervals.back()));
+    intervals.pop_back();
+  }
+  for (int q = -n / 8 - 1; q <= n / 8 + 1; ++q) {
+    for (double x : {q - 0.5, double(q)}) {
+      EXPECT_EQ(count_stabs(x, this->isl), this->isl.count_intervals(x));
+    }
+  }
+  for (int k = 0; k < 500; ++k) {
+    int l = uniform(this->gen);
+    int r = k % 5 == 0 ? l : uniform(this->gen);
+    if (l > r)
+      std::swap(l, r);
+    bool lb = this->gen() & 1;
+    bool rb = this->gen() & 1;
+    auto expected = std::count_if(intervals.begin(), intervals.end(), [&](Interval_t const& interval) {
+      return interval.overlaps(l, r, lb, rb);
+    });
+    EXPECT_EQ(expected, this->isl.count_overlapping(l, r, lb, rb));
+  }
+}
+
+TYPED_TEST(ISLTest, CountIntervalsWithCopies) {
+  int const n = 600;
+  std::vector<Interval_t> intervals;
+  // distinct intervals sharing inf fill one node over several leaves, some of them get copies
+  for (int i = 1; i <= n; ++i) {
+    intervals.emplace_back(0, i, true, i % 2);
+    for (int c = 0; c < i % 7 % 3; ++c) {
+      intervals.emplace_back(0, i, true, i % 2);
+    }
+    intervals.emplace_back(-i, i / 2, i % 3 == 0, true);
+  }
+  std::shuffle(intervals.begin(), intervals.end(), this->gen);
+  this->isl.insert(intervals.begin(), intervals.begin() + intervals.size() / 2);
+  for (auto it = intervals.begin() + intervals.size() / 2; it != intervals.end(); ++it) {
+    this->isl.insert(*it);
+  }
+  auto check = [&]() {
+    for (int q = -n / 2; q <= n + 1; q += 7) {
+      for (double x : {q - 0.5, double(q)}) {
+        EXPECT_EQ(count_stabs(x, this->isl), this->isl.count_intervals(x));
+      }
+    }
+    for (int l = -n / 2; l <= n; l += 37) {
+      int r = l + 50;
+      auto expected = std::count_if(intervals.begin(), intervals.end(), [&](Interval_t const& interval) {
+        return interval.overlaps(l, r, l % 2, true);
+      });
+      EXPECT_EQ(expected, this->isl.count_overlapping(l, r, l % 2, true));
+    }
+  };
+  check();
+  // dropping copies by interval and by handle keeps the counts of the rest
+  std::shuffle(intervals.begin(), intervals.end(), this->gen);
+  for (int i = 0; i < n / 2; ++i) {
+    Interval_t interval = intervals.back();
+    intervals.pop_back();
+    if (i % 2) {
+      EXPECT_TRUE(this->isl.remove(interval));
+    } else {
+      typename TypeParam::Interval_handle ih;
+      ASSERT_TRUE(this->isl.contains(interval, ih));
+      this->isl.remove(ih);
+    }
+  }
+  check();
+}
+
+TYPED_TEST(ISLTest, Freeze) {
+  int const n = 1000;
+  std::uniform_int_distribution<int> uniform(-n / 8, n / 8);
+  std::vector<Interval_t> intervals;
+  for (int i = 0; i < n; ++i) {
+    int inf = uniform(this->gen);
+    int sup = uniform(this->gen);
+    if (inf > sup)
+      std::swap(inf, sup);
+    intervals.emplace_back(inf, sup, this->gen() & 1, this->gen() & 1);
+    this->isl.insert(intervals.back());
+  }
+  auto frozen = this->isl.freeze();
+  EXPECT_EQ(n, frozen.size());
+  for (int q = -n / 8 - 1; q <= n / 8 + 1; ++q) {
+    for (double x : {q - 0.5, double(q)}) {
+      expect_stab(frozen, x, intervals);
+    }
+  }
+  for (int k = 0; k < 500; ++k) {
+    int l = uniform(this->gen);
+    int r = k % 5 == 0 ? l : uniform(this->gen);
+    if (l > r)
+      std::swap(l, r);
+    bool lb = this->gen() & 1;
+    bool rb = this->gen() & 1;
+    expect_overlapping(frozen, l, r, lb, rb, intervals);
+  }
+}
+
+TYPED_TEST(ISLTest, SaveFrozen) {
+  int const n = 1000;
+  std::uniform_int_distribution<int> uniform(-n / 8, n / 8);
+  for (int i = 0; i < n; ++i) {
+    int inf = uniform(this->gen);
+    int sup = uniform(this->gen);
+    if (inf > sup)
+      std::swap(inf, sup);
+    this->isl.insert(Interval_t(inf, sup, this->gen() & 1, this->gen() & 1));
+  }
+  std::string const path = ::testing::TempDir() + "isl_frozen_test.idx";
+  this->isl.freeze().save(path);
+  {
+    auto mapped = Frozen_interval_index<Interval_t>::open(path, true);
+    EXPECT_EQ(n, mapped.size());
+    for (int q = -n / 8 - 1; q <= n / 8 + 1; ++q) {
+      for (double x : {q - 0.5, double(q)}) {
+        std::vector<Interval_t> expected;
+        this->isl.find_intervals(x, std::back_inserter(expected));
+        std::vector<Interval_t> found;
+        mapped.find_intervals(x, std::back_inserter(found));
+        std::sort(expected.begin(), expected.end(), interval_tuple_comparator<Interval_t>());
+        std::sort(found.begin(), found.end(), interval_tuple_comparator<Interval_t>());
+        EXPECT_EQ(expected, found);
+      }
+    }
+  }
+
+  std::string bytes;
+  {
+    std::ifstream in(path, std::ios::binary);
+    bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+  }
+  auto write = [&](std::string const& contents) {
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << contents;
+  };
+  // a flipped byte in the arrays is found only by verify
+  std::string corrupt = bytes;
+  corrupt[corrupt.size() - 1] ^= 1;
+  write(corrupt);
+  EXPECT_NO_THROW(Frozen_interval_index<Interval_t>::open(path));
+  EXPECT_THROW(Frozen_interval_index<Interval_t>::open(path, true), std::runtime_error);
+  corrupt = bytes;
+  corrupt[9] ^= 1;
+  write(corrupt);
+  EXPECT_THROW(Frozen_interval_index<Interval_t>::open(path), std::runtime_error);
+  write(bytes.substr(0, bytes.size() - 1));
+  EXPECT_THROW(Frozen_interval_index<Interval_t>::open(path), std::runtime_error);
+  std::remove(path.c_str());
+  EXPECT_THROW(Frozen_interval_index<Interval_t>::open(path), std::runtime_error);
 }
 
-TEST_F(ISLTest, DeathTest) {
+TYPED_TEST(ISLTest, DeathTest) {
   auto create_big_isl = [&](){
     int const n = 1000000;
     std::uniform_int_distribution<int> dist(-n, n);
-    isl.insert(Interval_t(0, 0));
+    this->isl.insert(Interval_t(0, 0));
     for (int i = 0; i < n; ++i) {
-      int inf = dist(gen);
-      int sup = dist(gen);
+      int inf = dist(this->gen);
+      int sup = dist(this->gen);
       if (inf > sup)
         std::swap(inf, sup);
-      isl.insert(Interval_t(inf, sup, gen() % 2, gen() % 2));
+      this->isl.insert(Interval_t(inf, sup, this->gen() % 2, this->gen() % 2));
     }
-    EXPECT_LE(1, count_stabs(0, isl));
+    EXPECT_LE(1, count_stabs(0, this->isl));
     exit(0);
   };
   EXPECT_EXIT(create_big_isl(), testing::ExitedWithCode(0), "");
 }
 
+TEST(ConcurrentISLTest, ReadersDuringUpdates) {
+  Concurrent_interval_skip_list<Interval_t> isl;
+  isl.seed(isl_seed);
+  int const n = 2000;
+  std::atomic<bool> done(false);
+  std::atomic<int> failures(0);
+  // the writer only adds intervals containing 0 and removes the others,
+  // so a reader must never see the count at 0 go down or a reported interval miss 0
+  auto reader = [&]() {
+    std::size_t last = 0;
+    while (!done.load()) {
+      std::vector<Interval_t> found;
+      isl.find_intervals(0, std::back_inserter(found));
+      std::size_t count = isl.count_intervals(0);
+      if (count < last || found.size() > count)
+        ++failures;
+      for (auto const& interval : found) {
+        if (!interval.contains(0))
+          ++failures;
+      }
+      last = count;
+    }
+  };
+  std::vector<std::thread> readers;
+  for (int i = 0; i < 4; ++i) {
+    readers.emplace_back(reader);
+  }
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> uniform(1, n);
+  std::vector<Concurrent_interval_skip_list<Interval_t>::Interval_handle> others;
+  for (int i = 0; i < n; ++i) {
+    isl.insert(Interval_t(-uniform(gen), uniform(gen)));
+    int inf = uniform(gen);
+    others.push_back(isl.insert(Interval_t(inf, inf + uniform(gen))));
+    if (i % 3 == 0) {
+      isl.remove(others.back());
+      others.pop_back();
+    }
+  }
+  done.store(true);
+  for (auto& t : readers) {
+    t.join();
+  }
+  EXPECT_EQ(0, failures.load());
+  EXPECT_EQ(n + static_cast<int>(others.size()), isl.size());
+  EXPECT_EQ(std::size_t(n), isl.count_intervals(0));
+
+  // a single pass range reaches both copies of the list
+  std::istringstream infs("-3 -2 -1");
+  auto to_interval = [](int inf) { return Interval_t(inf, 0); };
+  isl.insert(boost::make_transform_iterator(std::istream_iterator<int>(infs), to_interval),
+             boost::make_transform_iterator(std::istream_iterator<int>(), to_interval));
+  EXPECT_EQ(std::size_t(n + 3), isl.count_intervals(0));
+  isl.remove(Interval_t(-2, 0));
+  EXPECT_EQ(std::size_t(n + 2), isl.count_intervals(0));
+}
+
+template<class Sharded>
+void check_sharded() {
+  Sharded isl(8);
+  std::mt19937 gen(seed);
+  int const n = 2000;
+  std::uniform_int_distribution<int> uniform(-n / 8, n / 8);
+  std::vector<Interval_t> intervals;
+  for (int i = 0; i < n / 2; ++i) {
+    intervals.push_back(random_interval(gen, n));
+  }
+  isl.insert(intervals.begin(), intervals.end());
+  isl.rebalance();
+  EXPECT_LT(1u, isl.shard_count());
+  // parallel inserts into different shards
+  std::vector<std::vector<Interval_t>> parts(4);
+  for (auto& part : parts) {
+    for (int i = 0; i < n / 8; ++i) {
+      part.push_back(random_interval(gen, n));
+      intervals.push_back(part.back());
+    }
+  }
+  std::vector<std::thread> threads;
+  for (auto const& part : parts) {
+    threads.emplace_back([&isl, &part]() {
+      for (auto const& interval : part) {
+        isl.insert(interval);
+      }
+    });
+  }
+  for (auto& t : threads) {
+    t.join();
+  }
+  for (int i = 0; i < n / 4; ++i) {
+    EXPECT_TRUE(isl.remove(intervals.back()));
+    intervals.pop_back();
+  }
+  EXPECT_EQ(static_cast<int>(intervals.size()), isl.size());
+
+  std::vector<double> queries;
+  for (int q = -n / 8 - 1; q <= n / 4 + 1; ++q) {
+    queries.push_back(q - 0.5);
+    queries.push_back(q);
+  }
+  std::vector<std::pair<std::size_t, Interval_t>> pairs;
+  isl.find_intervals_sorted(queries.begin(), queries.end(), std::back_inserter(pairs));
+  std::vector<std::vector<Interval_t>> by_query(queries.size());
+  for (auto const& p : pairs) {
+    by_query[p.first].push_back(p.second);
+  }
+  for (std::size_t j = 0; j < queries.size(); ++j) {
+    EXPECT_EQ(expect_stab(isl, queries[j], intervals), sorted(by_query[j]));
+  }
+  for (int k = 0; k < 300; ++k) {
+    int l = uniform(gen);
+    int r = l + static_cast<int>(gen() % 50) + (k % 3 == 0 ? n / 8 : 0);
+    bool lb = gen() & 1;
+    bool rb = gen() & 1;
+    expect_overlapping(isl, l, r, lb, rb, intervals);
+  }
+}
+
+TEST(ShardedISLTest, MatchesBruteForce) {
+  check_sharded<Sharded_interval_skip_list<Interval_t>>();
+  check_sharded<Sharded_interval_cartesian_tree<Interval_t>>();
+}
+
+template<class Sharded>
+void check_sharded_spanning() {
+  Sharded isl(8);
+  int const n = 2000;
+  std::vector<Interval_t> intervals;
+  for (int i = 0; i < n; ++i) {
+    intervals.emplace_back(i, i + 1);
+  }
+  isl.insert(intervals.begin(), intervals.end());
+  isl.rebalance();
+  ASSERT_LT(1u, isl.shard_count());
+  // an insert and a remove of an interval over all shards must not interleave shard by shard
+  Interval_t spanning(-1, n + 1);
+  int const k = 2000;
+  std::thread inserter([&]() {
+    for (int i = 0; i < k; ++i) {
+      isl.insert(spanning);
+    }
+  });
+  int removed = 0;
+  for (int i = 0; i < k; ++i) {
+    removed += isl.remove(spanning);
+  }
+  inserter.join();
+  while (isl.remove(spanning)) {
+    ++removed;
+  }
+  EXPECT_EQ(k, removed);
+  EXPECT_EQ(n, isl.size());
+  for (int q = 0; q <= n; q += 50) {
+    EXPECT_EQ(std::size_t(q == 0 || q == n ? 1 : 2), isl.count_intervals(q));
+  }
+}
+
+TEST(ShardedISLTest, SpanningUpdatesAreAtomic) {
+  check_sharded_spanning<Sharded_interval_skip_list<Interval_t>>();
+  check_sharded_spanning<Sharded_interval_cartesian_tree<Interval_t>>();
+}
+
+TEST(UnrolledISLTest, MatchesBruteForce) {
+  Unrolled_interval_skip_list<Interval_t> isl;
+  isl.seed(isl_seed);
+  std::mt19937 gen(seed);
+  int const n = 3000;
+  std::vector<Interval_t> intervals;
+  std::vector<Unrolled_interval_skip_list<Interval_t>::Interval_handle> handles;
+  for (int step = 0; step < n; ++step) {
+    if (intervals.empty() || gen() % 3 != 0) {
+      intervals.push_back(random_interval(gen, n));
+      handles.push_back(isl.insert(intervals.back()));
+      continue;
+    }
+    std::size_t k = gen() % intervals.size();
+    isl.remove(handles[k]);
+    intervals.erase(intervals.begin() + k);
+    handles.erase(handles.begin() + k);
+  }
+  // removal by value may take an equal interval under another handle, so it goes last
+  for (std::size_t k = intervals.size(); k-- > 0;) {
+    if (gen() % 3 == 0) {
+      EXPECT_TRUE(isl.remove(intervals[k]));
+      intervals.erase(intervals.begin() + k);
+    }
+  }
+  EXPECT_EQ(static_cast<int>(intervals.size()), isl.size());
+  EXPECT_FALSE(isl.remove(Interval_t(n, n + 1)));
+
+  for (int q = -n / 8 - 1; q <= n / 4 + 1; ++q) {
+    for (double x : {q - 0.5, static_cast<double>(q)}) {
+      EXPECT_EQ(!expect_found(isl, x, intervals).empty(), isl.is_contained(x));
+    }
+  }
+  isl.clear();
+  EXPECT_EQ(0, isl.size());
+  EXPECT_FALSE(isl.is_contained(0));
+}
+
+TEST(IntervalSoaTest, ContainsPrefix) {
+  std::mt19937 gen(seed);
+  for (int rep = 0; rep < 1000; ++rep) {
+    int const n = static_cast<int>(gen() % 40) + 1;
+    std::vector<Interval_t> intervals;
+    Interval_soa<double> soa;
+    for (int i = 0; i < n; ++i) {
+      int inf = static_cast<int>(gen() % 10);
+      intervals.emplace_back(inf, inf + static_cast<int>(gen() % 5), gen() & 1, gen() & 1);
+      soa.set(i, intervals.back());
+    }
+    double x = static_cast<double>(gen() % 24) / 2;
+    std::vector<uint32_t> handles(n);
+    for (auto& h : handles) {
+      h = gen() % n;
+    }
+    // matches first so that the prefix is long enough for the vector kernels
+    std::stable_partition(handles.begin(), handles.end(), [&](uint32_t h) { return intervals[h].contains(x); });
+    handles.push_back(gen() % n);
+    uint32_t expected = 0;
+    while (expected < handles.size() && intervals[handles[expected]].contains(x)) {
+      ++expected;
+    }
+    EXPECT_EQ(expected, soa.contains_prefix(handles.data(), handles.data() + handles.size(), x));
+  }
+}
+
+template <template <class> class Index>
+void check_logged()
+{
+  std::mt19937 gen(seed);
+  std::uniform_int_distribution<int> uniform(-100, 100);
+  std::string const dir = ::testing::TempDir() + "isl_logged_test";
+  std::string const log = dir + "/intervals.log";
+  std::vector<Interval_t> committed, at_crash;
+  auto expect_recovered = [&](Logged_interval_index<Interval_t, Index> const& logged) {
+    std::vector<Interval_t> found(logged.index().begin(), logged.index().end());
+    std::sort(committed.begin(), committed.end(), interval_tuple_comparator<Interval_t>());
+    std::sort(found.begin(), found.end(), interval_tuple_comparator<Interval_t>());
+    EXPECT_EQ(committed, found);
+  };
+  auto copy = [](std::string const& from, std::string const& to) {
+    std::ifstream in(from, std::ios::binary);
+    std::ofstream(to, std::ios::binary | std::ios::trunc) << in.rdbuf();
+  };
+  std::remove(log.c_str());
+  std::remove((dir + "/intervals.checkpoint").c_str());
+  for (int round = 0; round < 4; ++round) {
+    std::vector<Interval_t> live = committed;
+    Logged_interval_index<Interval_t, Index> logged(dir);
+    expect_recovered(logged);
+    for (int k = 0; k < 300; ++k) {
+      if (gen() % 3 != 0 || live.empty()) {
+        int inf = uniform(gen);
+        int sup = uniform(gen);
+        if (inf > sup)
+          std::swap(inf, sup);
+        live.emplace_back(inf, sup, gen() & 1, gen() & 1);
+        logged.insert(live.back());
+      } else {
+        std::size_t j = gen() % live.size();
+        EXPECT_TRUE(logged.remove(live[j]));
+        live.erase(live.begin() + j);
+      }
+      if (k % 50 == 20) {
+        logged.commit();
+        committed = live;
+      }
+    }
+    if (round == 2) {
+      logged.checkpoint();
+      committed = live;
+    }
+    // the files of a crash before the destructor commits, with a torn frame after the last commit
+    copy(log, log + ".crash");
+    std::ofstream(log + ".crash", std::ios::binary | std::ios::app) << "torn";
+    at_crash = committed;
+    committed = live;
+  }
+  copy(log + ".crash", log);
+  committed = at_crash;
+  {
+    Logged_interval_index<Interval_t, Index> logged(dir);
+    expect_recovered(logged);
+    // a crash between writing a checkpoint and replacing the log, the older log is ignored
+    copy(log, log + ".old");
+    logged.checkpoint();
+  }
+  copy(log + ".old", log);
+  Logged_interval_index<Interval_t, Index> logged(dir);
+  expect_recovered(logged);
+  std::remove((log + ".crash").c_str());
+  std::remove((log + ".old").c_str());
+}
+
+TEST(LoggedISLTest, RecoversCommittedUpdates) {
+  check_logged<Interval_skip_list>();
+  check_logged<Interval_cartesian_tree>();
+}
+
+TEST(LoggedISLTest, RetriesFailedWrite) {
+  std::string const path = ::testing::TempDir() + "isl_failed_write.log";
+  Interval_log<Interval_t>::create(path, 1);
+  std::vector<Interval_t> appended;
+  {
+    Interval_log<Interval_t> log(path, sizeof(Log_file_header));
+    for (int i = 0; i < 10; ++i) {
+      appended.emplace_back(i, i + 1);
+      log.append(true, appended.back());
+    }
+    log.commit();
+    // a file size limit inside the next frame fails its write halfway
+    for (int i = 10; i < 40; ++i) {
+      appended.emplace_back(i, i + 1);
+      log.append(true, appended.back());
+    }
+    rlimit limit;
+    ASSERT_EQ(0, getrlimit(RLIMIT_FSIZE, &limit));
+    rlimit tight = limit;
+    tight.rlim_cur = log.size() - 100;
+    auto xfsz = std::signal(SIGXFSZ, SIG_IGN);
+    ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &tight));
+    EXPECT_THROW(log.commit(), std::runtime_error);
+    ASSERT_EQ(0, setrlimit(RLIMIT_FSIZE, &limit));
+    std::signal(SIGXFSZ, xfsz);
+    log.commit();
+  }
+  std::vector<Interval_t> replayed;
+  uint64_t valid = Interval_log<Interval_t>::replay(path, 1, [&](bool insert, const Interval_t& i) {
+    EXPECT_TRUE(insert);
+    replayed.push_back(i);
+  });
+  EXPECT_EQ(appended, replayed);
+  std::ifstream file(path, std::ios::binary | std::ios::ate);
+  EXPECT_EQ(valid, static_cast<uint64_t>(file.tellg()));
+  std::remove(path.c_str());
+}
+
+TEST(PagedISLTest, MatchesBruteForce) {
+  // a cache of a few pages, most accesses go to the file
+  Paged_interval_skip_list<Interval_t> isl(Page_cache::scratch_dir(), 16 * Page_cache::page_size);
+  isl.seed(isl_seed);
+  std::mt19937 gen(seed);
+  int const n = 3000;
+  std::vector<Interval_t> intervals;
+  auto check = [&]() {
+    EXPECT_EQ(static_cast<int>(intervals.size()), isl.size());
+    for (int q = -n / 8 - 1; q <= n / 4 + 1; ++q) {
+      for (double x : {q - 0.5, static_cast<double>(q)}) {
+        expect_stab(isl, x, intervals);
+      }
+    }
+  };
+
+  for (int step = 0; step < n; ++step) {
+    if (intervals.empty() || gen() % 3 != 0) {
+      intervals.push_back(random_interval(gen, n));
+      isl.insert(intervals.back());
+      continue;
+    }
+    std::size_t k = gen() % intervals.size();
+    EXPECT_TRUE(isl.remove(intervals[k]));
+    intervals.erase(intervals.begin() + k);
+  }
+  EXPECT_FALSE(isl.remove(Interval_t(n, n + 1)));
+  check();
+  EXPECT_GT(isl.page_statistics().reads, 0u);
+
+  // removes that find nothing leave the pages clean, evicting them writes nothing
+  isl.reset_page_statistics();
+  for (int q = -n / 8 - 1; q <= n / 8; ++q) {
+    EXPECT_FALSE(isl.remove(Interval_t(q + 0.5, q + 0.75)));
+  }
+  EXPECT_EQ(0u, isl.page_statistics().writes);
+
+  // a batch larger than the list rebuilds it
+  std::vector<Interval_t> batch;
+  for (std::size_t k = 0; k < intervals.size() + 10; ++k) {
+    batch.push_back(random_interval(gen, n));
+  }
+  isl.insert(batch.begin(), batch.end());
+  intervals.insert(intervals.end(), batch.begin(), batch.end());
+  for (int step = 0; step < n / 2; ++step) {
+    std::size_t k = gen() % intervals.size();
+    EXPECT_TRUE(isl.remove(intervals[k]));
+    intervals.erase(intervals.begin() + k);
+  }
+  check();
+
+  isl.clear();
+  EXPECT_EQ(0, isl.size());
+  EXPECT_FALSE(isl.is_contained(0));
+}
+
+template <template <class> class Index>
+void check_buffered()
+{
+  Buffered_interval_index<Interval_t, Index> buffered;
+  std::mt19937 gen(seed);
+  int const n = 2000;
+  std::vector<Interval_t> intervals;
+  for (int step = 0; step < n; ++step) {
+    int op = gen() % 4;
+    if (intervals.empty() || op < 2) {
+      intervals.push_back(random_interval(gen, n));
+      buffered.insert(intervals.back());
+    } else if (op == 2) {
+      std::size_t k = gen() % intervals.size();
+      EXPECT_TRUE(buffered.remove(intervals[k]));
+      intervals.erase(intervals.begin() + k);
+    } else {
+      // a copy of a live interval, removed later either from the buffer or by a tombstone
+      intervals.push_back(intervals[gen() % intervals.size()]);
+      buffered.insert(intervals.back());
+    }
+    if (step % 300 == 150) {
+      buffered.merge();
+      EXPECT_EQ(0u, buffered.pending());
+    }
+    if (step % 100 != 99) {
+      continue;
+    }
+    EXPECT_EQ(static_cast<int>(intervals.size()), buffered.size());
+    EXPECT_FALSE(buffered.remove(Interval_t(n, n + 1)));
+    for (int q = -n / 8 - 1; q <= n / 4 + 1; q += 3) {
+      expect_stab(buffered, q, intervals);
+    }
+  }
+}
+
+TEST(BufferedISLTest, ReadsItsWrites) {
+  check_buffered<Interval_skip_list>();
+  check_buffered<Interval_cartesian_tree>();
+}
+
+template <template <class> class Index>
+void check_map()
+{
+  Interval_skip_list_map<Interval_t, int, Index> map;
+  std::mt19937 gen(seed);
+  int const n = 2000;
+  std::uniform_int_distribution<int> uniform(-n / 8, n / 8);
+  std::vector<std::pair<Interval_t, int>> entries;
+  for (int step = 0; step < n; ++step) {
+    int op = gen() % 4;
+    if (entries.empty() || op < 2) {
+      int inf = uniform(gen);
+      Interval_t i(inf, inf + static_cast<int>(gen() % 10), gen() & 1, gen() & 1);
+      if (op == 1 && !entries.empty()) {
+        // a copy of a stored interval with a value of its own
+        i = entries[gen() % entries.size()].first;
+      }
+      entries.emplace_back(i, step);
+      map.emplace(i, step);
+    } else if (op == 2) {
+      std::size_t k = gen() % entries.size();
+      int v = entries[k].second;
+      EXPECT_TRUE(map.remove_if(entries[k].first, [v](int x) { return x == v; }));
+      entries.erase(entries.begin() + k);
+    } else {
+      Interval_t i = entries[gen() % entries.size()].first;
+      EXPECT_TRUE(map.remove(i));
+      // the value inserted last for i goes
+      auto last = std::find_if(entries.rbegin(), entries.rend(), [&](const std::pair<Interval_t, int>& e) {
+        return e.first == i;
+      });
+      entries.erase(std::next(last).base());
+    }
+    if (step % 100 != 99) {
+      continue;
+    }
+    EXPECT_EQ(static_cast<int>(entries.size()), map.size());
+    for (int q = -n / 8 - 1; q <= n / 8 + 11; q += 3) {
+      std::vector<std::pair<Interval_t, int>> expected, found;
+      std::copy_if(entries.begin(), entries.end(), std::back_inserter(expected), [&](const std::pair<Interval_t, int>& e) {
+        return e.first.contains(q);
+      });
+      map.find_intervals(q, std::back_inserter(found));
+      auto by_value = [](const std::pair<Interval_t, int>& a, const std::pair<Interval_t, int>& b) {
+        return a.second < b.second;
+      };
+      std::sort(expected.begin(), expected.end(), by_value);
+      std::sort(found.begin(), found.end(), by_value);
+      EXPECT_EQ(expected, found);
+      EXPECT_EQ(expected.size(), map.count_intervals(q));
+    }
+  }
+  // values are updated in place through the query results
+  map.for_each_interval(0, [](const Interval_t&, int& v) { v = -1; return true; });
+  EXPECT_TRUE(map.for_each_interval(0, [](const Interval_t&, int v) { return v == -1; }));
+  map.clear();
+  EXPECT_EQ(0, map.size());
+  EXPECT_FALSE(map.remove(Interval_t(0, 1)));
+}
+
+TEST(IntervalMapTest, ValuesFollowIntervals) {
+  check_map<Interval_skip_list>();
+  check_map<Interval_cartesian_tree>();
+}
+
+template <template <class> class Index, class Bounded_interval>
+void check_bounds()
+{
+  Index<Bounded_interval> index;
+  std::mt19937 gen(seed);
+  int const n = 1000;
+  std::uniform_int_distribution<int> uniform(-n / 8, n / 8);
+  std::vector<Bounded_interval> intervals;
+  for (int i = 0; i < n; ++i) {
+    int inf = uniform(gen);
+    intervals.emplace_back(inf, inf + static_cast<int>(gen() % 20));
+    index.insert(intervals.back());
+  }
+  for (int i = 0; i < n / 4; ++i) {
+    std::size_t k = gen() % intervals.size();
+    EXPECT_TRUE(index.remove(intervals[k]));
+    intervals.erase(intervals.begin() + k);
+  }
+  for (int q = -n / 8 - 1; q <= n / 8 + 21; ++q) {
+    expect_stab(index, q, intervals);
+  }
+}
+
+TEST(BoundsTest, FixedClosedness) {
+  typedef Interval_skip_list_interval<double, Closed_bounds> Closed_t;
+  typedef Interval_skip_list_interval<double, Half_open_bounds> Half_open_t;
+  static_assert(sizeof(Closed_t) == 2 * sizeof(double), "fixed closedness takes no space");
+  static_assert(sizeof(Half_open_t) == 2 * sizeof(double), "fixed closedness takes no space");
+  static_assert(std::is_trivially_copyable<Closed_t>::value, "intervals are copied as raw memory");
+
+  Half_open_t h(1, 3);
+  EXPECT_TRUE(h.inf_closed());
+  EXPECT_FALSE(h.sup_closed());
+  EXPECT_TRUE(h.contains(1));
+  EXPECT_FALSE(h.contains(3));
+  EXPECT_TRUE(h.contains_or_inf(1));
+  EXPECT_FALSE(Half_open_t(2, 2).contains(2));
+  EXPECT_TRUE(Closed_t(2, 2).contains(2));
+  EXPECT_EQ(Interval_t(1, 3, true, false), Interval_t(1, 3, Half_open_t::Bounds::inf_default,
+                                                     Half_open_t::Bounds::sup_default));
+
+  check_bounds<Interval_skip_list, Closed_t>();
+  check_bounds<Interval_cartesian_tree, Closed_t>();
+  check_bounds<Interval_skip_list, Half_open_t>();
+  check_bounds<Interval_cartesian_tree, Half_open_t>();
+}
+
+TEST(MigrationISLTest, BoundedMatchesBruteForce) {
+  Interval_skip_list<Interval_t> isl;
+  isl.seed(isl_seed);
+  isl.set_migration_budget(4);
+  std::mt19937 gen(seed);
+  int const n = 2000;
+  // long intervals over few keys make indexes far larger than the budget
+  std::uniform_int_distribution<int> uniform(0, n / 20);
+  std::vector<Interval_t> intervals;
+  std::vector<Interval_skip_list<Interval_t>::Interval_handle> handles;
+  bool deferred = false;
+  auto check = [&]() {
+    std::vector<double> queries;
+    for (int q = -1; q <= n / 10 + 1; ++q) {
+      for (double x : {q - 0.5, static_cast<double>(q)}) {
+        expect_stab(isl, x, intervals);
+        queries.push_back(x);
+      }
+    }
+    for (int l = -1; l <= n / 10; l += 7) {
+      std::size_t expected = std::count_if(intervals.begin(), intervals.end(), [&](Interval_t const& interval) {
+        return interval.overlaps(l, l + 5, true, false);
+      });
+      std::vector<Interval_t> found;
+      isl.find_overlapping(l, l + 5, true, false, std::back_inserter(found));
+      EXPECT_EQ(expected, found.size());
+      EXPECT_EQ(expected, isl.count_overlapping(l, l + 5, true, false));
+    }
+    std::size_t stabs = 0;
+    for (double x : queries) {
+      stabs += isl.count_intervals(x);
+    }
+    std::vector<std::pair<std::size_t, Interval_t>> sorted, batch;
+    isl.find_intervals_sorted(queries.begin(), queries.end(), std::back_inserter(sorted));
+    isl.find_intervals_batch(queries.begin(), queries.end(), std::back_inserter(batch));
+    EXPECT_EQ(stabs, sorted.size());
+    EXPECT_EQ(stabs, batch.size());
+  };
+  // the oracle is updated only by the steps below, equal intervals keep one handle
+  auto insert = [&](const Interval_t& interval) {
+    auto ih = isl.insert(interval);
+    auto equal = std::find(intervals.begin(), intervals.end(), interval);
+    if (equal != intervals.end()) {
+      EXPECT_EQ(handles[equal - intervals.begin()], ih);
+    }
+    intervals.push_back(interval);
+    handles.push_back(ih);
+  };
+  bool copied_pending = false;
+  for (int step = 0; step < n; ++step) {
+    if (intervals.empty() || gen() % 3 != 0) {
+      int inf = uniform(gen);
+      int sup = inf + static_cast<int>(gen() % (n / 20));
+      insert(Interval_t(inf, sup, gen() & 1, gen() & 1));
+    } else if (gen() % 2) {
+      std::size_t k = gen() % intervals.size();
+      isl.remove(handles[k]);
+      intervals.erase(intervals.begin() + k);
+      handles.erase(handles.begin() + k);
+    } else {
+      std::size_t k = gen() % intervals.size();
+      EXPECT_TRUE(isl.contains(intervals[k]));
+      EXPECT_TRUE(isl.remove(intervals[k]));
+      intervals.erase(intervals.begin() + k);
+      handles.erase(handles.begin() + k);
+    }
+    if (!intervals.empty() && isl.pending_intervals() > 0 && gen() % 2) {
+      // most intervals wait in pending nodes now, a copy of one of them must join it there
+      insert(intervals[gen() % intervals.size()]);
+      copied_pending = true;
+    }
+    deferred |= isl.pending_intervals() > 0;
+    if (step % 200 == 0) {
+      check();
+    }
+  }
+  EXPECT_TRUE(deferred);
+  EXPECT_TRUE(copied_pending);
+  check();
+  EXPECT_EQ(0u, isl.maintain(std::size_t(-1)));
+  check();
+  isl.clear();
+  EXPECT_EQ(0, isl.size());
+  EXPECT_EQ(0u, isl.pending_intervals());
+}
+
 int main(int argc, char **argv) {
   testing::InitGoogleTest(&argc, argv);
   std::cout << "isl_seed: " << isl_seed << std::endl <<
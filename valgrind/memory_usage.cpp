@@ -3,6 +3,7 @@
 #include "../include/Interval_skip_list_interval.h"
 #include "../include/Interval_skip_list.h"
 #include "../include/Interval_cartesian_tree.h"
+#include "../include/Unrolled_interval_skip_list.h"
 
 #include <CGAL/Interval_skip_list.h>
 #include <CGAL/Interval_skip_list_interval.h>
@@ -14,6 +15,7 @@
 const char OPTIMIZED_ISL_NAME[] = "Optimized";
 const char CGAL_ISL_NAME[] = "CGAL";
 const char CARTESIAN_TREE_NAME[] = "Cartesian";
+const char UNROLLED_ISL_NAME[] = "Unrolled";
 
 const char SPARSE_DATA_NAME[] = "Sparse";
 const char DENSE_DATA_NAME[] = "Dense";
@@ -51,6 +53,8 @@ static void choose_data_structure(char** name) {
     choose_data_type<CGAL::Interval_skip_list_interval<double>, CGAL::Interval_skip_list>(name + 1);
   } else if (strcmp(*name, CARTESIAN_TREE_NAME) == 0) {
     choose_data_type<Interval_skip_list_interval<double>, Interval_cartesian_tree>(name + 1);
+  } else if (strcmp(*name, UNROLLED_ISL_NAME) == 0) {
+    choose_data_type<Interval_skip_list_interval<double>, Unrolled_interval_skip_list>(name + 1);
   } else {
     std::cerr << "unknown data structure: " << *name << std::endl;
     throw std::runtime_error("");
@@ -78,4 +78,5 @@ cmake --build "$BIN" --target memory_usage -j 6
 
 compare_structures Optimized CGAL cgal_cmp
 compare_structures Optimized Cartesian cartesian_cmp
+compare_structures Optimized Unrolled unrolled_cmp
 